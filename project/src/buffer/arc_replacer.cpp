@@ -0,0 +1,265 @@
+/**
+ * ARC implementation
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "buffer/arc_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ARCReplacer<T>::ARCReplacer(size_t capacity, size_t correlated_period)
+    : capacity_(capacity), correlated_period_(correlated_period),
+      current_timestamp_(0), target_(0), size_(0), ghost_hits_(0),
+      adapted_page_id_(INVALID_PAGE_ID), adapted_in_b2_(false) {
+  assert(capacity_ > 0);
+}
+
+template <typename T> ARCReplacer<T>::~ARCReplacer() = default;
+
+/*
+ * Make value evictable. A value the replacer never saw an access of goes to
+ * T1 like a first access
+ */
+template <typename T> void ARCReplacer<T>::Insert(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = frames_.find(value);
+  if (it == frames_.end()) {
+    entry &e = frames_[value];
+    e.pos = t1_.insert(t1_.end(), value);
+    it = frames_.find(value);
+  }
+  if (!it->second.evictable) {
+    it->second.evictable = true;
+    ++size_;
+  }
+}
+
+/*
+ * Evict from T1 while it is larger than its target p, otherwise from T2. If
+ * every frame of the chosen list is pinned, try the other one. The page id of
+ * the victim is remembered in the ghost list matching its list
+ */
+template <typename T> bool ARCReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (size_ == 0) {
+    return false;
+  }
+  bool from_t2 = t1_.size() <= target_;
+  return Evict(from_t2, value) || Evict(!from_t2, value);
+}
+
+/*
+ * ARC's REPLACE for a miss of page_id: a ghost hit adapts p first, then
+ * evict from T1 if it is larger than p, or as large as p and page_id was in
+ * B2, otherwise from T2. If every frame of the chosen list is pinned, try the
+ * other one
+ */
+template <typename T>
+bool ARCReplacer<T>::VictimFor(T &value, page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (size_ == 0) {
+    return false;
+  }
+  // the buffer pool asks again if the victim got pinned meanwhile
+  auto ghost_it = ghosts_.find(page_id);
+  if (ghost_it != ghosts_.end()) {
+    adapted_in_b2_ = GhostHit(ghost_it);
+    adapted_page_id_ = page_id;
+  }
+  bool in_b2 = page_id != INVALID_PAGE_ID && page_id == adapted_page_id_ &&
+               adapted_in_b2_;
+  bool from_t1 = !t1_.empty() && (t1_.size() > target_ ||
+                                  (in_b2 && t1_.size() == target_));
+  return Evict(!from_t1, value) || Evict(from_t1, value);
+}
+
+/*
+ * Make value not evictable, it stays in its list. return false if value is
+ * not evictable
+ */
+template <typename T> bool ARCReplacer<T>::Erase(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = frames_.find(value);
+  if (it == frames_.end() || !it->second.evictable) {
+    return false;
+  }
+  it->second.evictable = false;
+  --size_;
+  return true;
+}
+
+template <typename T> size_t ARCReplacer<T>::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+/*
+ * evictable frames of the list Victim prefers from its LRU end, then the
+ * other list
+ */
+template <typename T>
+void ARCReplacer<T>::Candidates(std::vector<T> &values, size_t n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  bool from_t2 = t1_.size() <= target_;
+  for (auto *list : {from_t2 ? &t2_ : &t1_, from_t2 ? &t1_ : &t2_}) {
+    for (auto pos = list->begin(); pos != list->end() && values.size() < n;
+         ++pos) {
+      if (frames_[*pos].evictable) {
+        values.push_back(*pos);
+      }
+    }
+  }
+}
+
+/*
+ * A frame already holding page_id is a hit and moves to the MRU end of T2,
+ * or of T1 if the access is correlated with the previous one. Otherwise
+ * page_id was just read into the frame: a ghost hit adapts p and brings the
+ * page back into T2, a real miss puts it into T1
+ */
+template <typename T>
+void ARCReplacer<T>::RecordAccess(const T &value, page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  size_t now = current_timestamp_++;
+  auto it = frames_.find(value);
+  if (it != frames_.end() && it->second.page_id == page_id) {
+    entry &e = it->second;
+    (e.in_t2 ? t2_ : t1_).erase(e.pos);
+    e.in_t2 = e.in_t2 || now - e.last_access >= correlated_period_;
+    std::list<T> &list = e.in_t2 ? t2_ : t1_;
+    e.pos = list.insert(list.end(), value);
+    e.last_access = now;
+    return;
+  }
+
+  // the frame was handed out without being evicted (free list), drop it
+  bool evictable = false;
+  if (it != frames_.end()) {
+    evictable = it->second.evictable;
+    (it->second.in_t2 ? t2_ : t1_).erase(it->second.pos);
+    frames_.erase(it);
+  }
+
+  entry &e = frames_[value];
+  e.page_id = page_id;
+  e.evictable = evictable;
+  e.last_access = now;
+
+  auto ghost_it = ghosts_.find(page_id);
+  if (page_id == adapted_page_id_ || ghost_it != ghosts_.end()) {
+    if (page_id == adapted_page_id_) {
+      adapted_page_id_ = INVALID_PAGE_ID;
+    } else {
+      GhostHit(ghost_it);
+    }
+    e.in_t2 = true;
+    e.pos = t2_.insert(t2_.end(), value);
+  } else {
+    e.in_t2 = false;
+    e.pos = t1_.insert(t1_.end(), value);
+  }
+  TrimGhosts();
+}
+
+/*
+ * the target and the ghost lists follow the new cache size c
+ */
+template <typename T> void ARCReplacer<T>::SetCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(capacity > 0);
+  capacity_ = capacity;
+  target_ = std::min(target_, capacity_);
+  TrimGhosts();
+}
+
+template <typename T> size_t ARCReplacer<T>::GetTarget() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return target_;
+}
+
+template <typename T> size_t ARCReplacer<T>::GetGhostHitCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ghost_hits_;
+}
+
+/*
+ * evict the least recently used evictable frame of T1 or T2
+ * should be called when holding the lock
+ */
+template <typename T> bool ARCReplacer<T>::Evict(bool from_t2, T &value) {
+  std::list<T> &list = from_t2 ? t2_ : t1_;
+  for (auto pos = list.begin(); pos != list.end(); ++pos) {
+    auto it = frames_.find(*pos);
+    if (!it->second.evictable) {
+      continue;
+    }
+    value = *pos;
+    page_id_t page_id = it->second.page_id;
+    list.erase(pos);
+    frames_.erase(it);
+    --size_;
+
+    if (page_id != INVALID_PAGE_ID) {
+      std::list<page_id_t> &ghost_list = from_t2 ? b2_ : b1_;
+      ghosts_[page_id] = {from_t2,
+                          ghost_list.insert(ghost_list.end(), page_id)};
+      TrimGhosts();
+    }
+    return true;
+  }
+  return false;
+}
+
+/*
+ * should be called when holding the lock
+ */
+template <typename T>
+bool ARCReplacer<T>::GhostHit(
+    typename std::unordered_map<page_id_t, ghost>::iterator it) {
+  ++ghost_hits_;
+  bool in_b2 = it->second.in_b2;
+  if (!in_b2) {
+    // recency would have kept it, grow T1
+    size_t delta = std::max<size_t>(1, b2_.size() / b1_.size());
+    target_ = std::min(capacity_, target_ + delta);
+    b1_.erase(it->second.pos);
+  } else {
+    // frequency would have kept it, grow T2
+    size_t delta = std::max<size_t>(1, b1_.size() / b2_.size());
+    target_ = target_ > delta ? target_ - delta : 0;
+    b2_.erase(it->second.pos);
+  }
+  ghosts_.erase(it);
+  return in_b2;
+}
+
+/*
+ * keep |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+ * should be called when holding the lock
+ */
+template <typename T> void ARCReplacer<T>::TrimGhosts() {
+  while (t1_.size() + b1_.size() > capacity_ && !b1_.empty()) {
+    ghosts_.erase(b1_.front());
+    b1_.pop_front();
+  }
+  while (t1_.size() + t2_.size() + b1_.size() + b2_.size() > 2 * capacity_ &&
+         !b2_.empty()) {
+    ghosts_.erase(b2_.front());
+    b2_.pop_front();
+  }
+}
+
+template class ARCReplacer<Page *>;
+// test only
+template class ARCReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,1157 @@
+/*
+ * buffer_pool_instance.cpp
+ *
+ * Functionality: One independent shard of the buffer pool. Each instance owns
+ * its own frames, page table, replacer, free list and latch, so operations on
+ * pages that hash to different instances never contend with each other.
+ */
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <future>
+#include <new>
+#include <vector>
+
+#include "buffer/buffer_pool_instance.h"
+#include "common/logger.h"
+
+namespace cmudb {
+
+/*
+ * BufferPoolInstance Constructor
+ * When log_manager is nullptr, logging is disabled (for test purpose)
+ * Frames up to max_pool_size are reserved for Resize, their metadata is
+ * allocated, their page data is only address space until they are used
+ * compressed_cache_size bytes of compressed clean victims are kept if not 0
+ */
+BufferPoolInstance::BufferPoolInstance(size_t pool_size,
+                                       DiskManager *disk_manager,
+                                       LogManager *log_manager,
+                                       ReplacerType replacer_type,
+                                       size_t max_pool_size,
+                                       size_t compressed_cache_size)
+    : pool_size_(pool_size),
+      capacity_(std::max(pool_size, max_pool_size)),
+      page_size_(disk_manager->GetPageSize()),
+      disk_manager_(disk_manager), log_manager_(log_manager),
+      compressed_cache_(nullptr), prefetches_in_flight_(0) {
+
+  // a consecutive memory space for buffer pool
+  pages_ = new Page[capacity_];
+  free_list_ = new std::list<Page *>;
+
+  // page data lives apart from the metadata, in one page aligned arena.
+  // Large arenas are aligned to huge pages, so THP can back all of them
+  arena_size_ = capacity_ * page_size_;
+  size_t alignment = arena_size_ >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : 0;
+  char *map = static_cast<char *>(
+      mmap(nullptr, arena_size_ + alignment, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+  if (map == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  arena_ = map;
+  if (alignment != 0) {
+    size_t head = (alignment - reinterpret_cast<uintptr_t>(map) % alignment) %
+                  alignment;
+    arena_ = map + head;
+    if (head != 0) {
+      munmap(map, head);
+    }
+    munmap(arena_ + arena_size_, alignment - head);
+    madvise(arena_, arena_size_, MADV_HUGEPAGE);
+  }
+  for (size_t i = 0; i < capacity_; ++i) {
+    pages_[i].data_ = arena_ + i * page_size_;
+  }
+
+  if (replacer_type == ReplacerType::CLOCK) {
+    replacer_ = new ClockReplacer<Page *>(capacity_, pages_);
+  } else if (replacer_type == ReplacerType::LRU_K) {
+    replacer_ = new LRUKReplacer<Page *>;
+  } else if (replacer_type == ReplacerType::ARC) {
+    replacer_ = new ARCReplacer<Page *>(pool_size_);
+  } else {
+    replacer_ = new LRUReplacer<Page *>;
+  }
+  page_table_ = new ConcurrentHash<page_id_t, Page *>(pool_size_);
+
+  pending_ = new std::atomic<Page *>[capacity_];
+  for (size_t i = 0; i < capacity_; ++i) {
+    pending_[i].store(nullptr, std::memory_order_relaxed);
+  }
+  pending_tail_ = 0;
+  pending_head_ = 0;
+
+  // put all the pages into free list, the reserved ones are retired
+  for (size_t i = 0; i < pool_size_; ++i) {
+    free_list_->push_back(&pages_[i]);
+  }
+  for (size_t i = capacity_; i > pool_size_; --i) {
+    retired_.push_back(&pages_[i - 1]);
+  }
+
+  if (compressed_cache_size != 0) {
+    compressed_cache_ = new CompressedCache(compressed_cache_size);
+  }
+}
+
+/*
+ * BufferPoolInstance Destructor
+ */
+BufferPoolInstance::~BufferPoolInstance() {
+  // reads in flight complete into frames of this instance
+  WaitForPrefetches();
+  delete[] pages_;
+  munmap(arena_, arena_size_);
+  delete page_table_;
+  delete replacer_;
+  delete free_list_;
+  delete[] pending_;
+  delete compressed_cache_;
+}
+
+/**
+ * 1. search hash table without the latch, pin a resident page with an atomic
+ *    increment and return it (after waiting for it if another thread is still
+ *    reading it from disk). The replacer hears of the access later.
+ * 2. otherwise take the latch and search again.
+ *  2.1 if exist, pin the page and return (after waiting, as above)
+ *  2.2 if no exist, find a replacement entry from either free list or lru
+ *      replacer. (NOTE: always find from free list first)
+ * 3. Delete the entry for the old page from the hash table and insert an
+ * entry for the new page, so concurrent fetches of it wait on the frame.
+ * 4. Release the latch, write back the old page if dirty and read the new one
+ * from disk, fetches of other pages go on meanwhile.
+ * 5. Mark the frame ready and return page pointer
+ */
+Page *BufferPoolInstance::FetchPage(page_id_t page_id, BufferRing *ring) {
+  assert(page_id != INVALID_PAGE_ID);
+
+  Page *res = nullptr;
+  if (page_table_->Find(page_id, res) && TryPin(res, page_id)) {
+    ++hit_count_;
+    if (res->state_ != FrameState::READY) {
+      // pinned, the frame can not be reused while waiting
+      std::unique_lock<std::mutex> lock(latch_);
+      io_cv_.wait(lock, [res]() { return res->state_ == FrameState::READY; });
+    }
+    return res;
+  }
+
+  std::unique_lock<std::mutex> lock(latch_);
+  auto start = std::chrono::steady_clock::now();
+  page_id_t dirty_page_id, clean_page_id;
+  lsn_t wal_lsn;
+  while (true) {
+    if (page_table_->Find(page_id, res)) {
+      // mark the Page as pinned, frames in the page table are not taken
+      // over while the latch is held
+      ++res->pin_count_;
+      // remove its entry from LRUReplacer
+      replacer_->Erase(res);
+      replacer_->RecordAccess(res, page_id);
+      ++hit_count_;
+      // pinned, the frame can not be reused while waiting
+      io_cv_.wait(lock, [res]() { return res->state_ == FrameState::READY; });
+      return res;
+    }
+    // old copy still being written, wait until disk is up to date
+    if (writing_.count(page_id) != 0) {
+      io_cv_.wait(lock);
+      continue;
+    }
+    res = ClaimFrame(page_id, dirty_page_id, clean_page_id, ring, wal_lsn);
+    // a victim newer than the log, look again once the log caught up
+    if (res != nullptr || !WaitForLog(wal_lsn, lock)) {
+      break;
+    }
+  }
+  ++miss_count_;
+  if (res == nullptr) {
+    ++pin_failures_;
+    return nullptr;
+  }
+  replacer_->RecordAccess(res, page_id);
+
+  lock.unlock();
+  WriteBack(res, dirty_page_id);
+  StashPage(res, clean_page_id);
+  ReadPage(page_id, res->GetData());
+  lock.lock();
+
+  res->state_ = FrameState::READY;
+  io_cv_.notify_all();
+  fetch_miss_latency_.RecordSince(start);
+  return res;
+}
+
+/*
+ * FetchPage split in two, so that the pages missing from several instances
+ * are read from disk together. Pages found in the compressed cache are read
+ * from there right away.
+ * return nullptr if all the pages in this instance are pinned
+ */
+Page *BufferPoolInstance::PinPage(page_id_t page_id, bool &read,
+                                  BufferRing *ring) {
+  assert(page_id != INVALID_PAGE_ID);
+  read = false;
+
+  Page *res = nullptr;
+  if (page_table_->Find(page_id, res) && TryPin(res, page_id)) {
+    ++hit_count_;
+    return res;
+  }
+
+  std::unique_lock<std::mutex> lock(latch_);
+  page_id_t dirty_page_id, clean_page_id;
+  lsn_t wal_lsn;
+  while (true) {
+    if (page_table_->Find(page_id, res)) {
+      ++res->pin_count_;
+      replacer_->Erase(res);
+      replacer_->RecordAccess(res, page_id);
+      ++hit_count_;
+      return res;
+    }
+    // old copy still being written, wait until disk is up to date
+    if (writing_.count(page_id) != 0) {
+      io_cv_.wait(lock);
+      continue;
+    }
+    res = ClaimFrame(page_id, dirty_page_id, clean_page_id, ring, wal_lsn);
+    // a victim newer than the log, look again once the log caught up
+    if (res != nullptr || !WaitForLog(wal_lsn, lock)) {
+      break;
+    }
+  }
+  ++miss_count_;
+  if (res == nullptr) {
+    ++pin_failures_;
+    return nullptr;
+  }
+  replacer_->RecordAccess(res, page_id);
+
+  lock.unlock();
+  WriteBack(res, dirty_page_id);
+  StashPage(res, clean_page_id);
+  if (compressed_cache_ != nullptr &&
+      compressed_cache_->Remove(page_id, res->GetData(), page_size_)) {
+    ++compressed_hits_;
+    FinishRead(res);
+    return res;
+  }
+  ++disk_reads_;
+  read = true;
+  return res;
+}
+
+void BufferPoolInstance::FinishRead(Page *page) {
+  std::lock_guard<std::mutex> lock(latch_);
+  page->state_ = FrameState::READY;
+  io_cv_.notify_all();
+}
+
+void BufferPoolInstance::WaitForPage(Page *page) {
+  if (page->state_ == FrameState::READY) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  io_cv_.wait(lock, [page]() { return page->state_ == FrameState::READY; });
+}
+
+/*
+ * Read page_id into a frame and leave it unpinned, for readahead. Unlike
+ * FetchPage it is not an access, the replacer only learns about the page when
+ * it is fetched. Nothing to do if the page is resident or being written.
+ * The disk read is asynchronous, the frame stays pinned and not ready until
+ * it completes, so the caller can keep many reads in flight.
+ * return false if the page was not read
+ */
+bool BufferPoolInstance::PrefetchPage(page_id_t page_id, BufferRing *ring) {
+  assert(page_id != INVALID_PAGE_ID);
+  std::unique_lock<std::mutex> lock(latch_);
+
+  Page *res;
+  if (page_table_->Find(page_id, res) || writing_.count(page_id) != 0) {
+    return false;
+  }
+  // readahead does not wait for the log to evict a page newer than it
+  page_id_t dirty_page_id, clean_page_id;
+  lsn_t wal_lsn;
+  res = ClaimFrame(page_id, dirty_page_id, clean_page_id, ring, wal_lsn, true);
+  if (res == nullptr) {
+    return false;
+  }
+
+  ++prefetches_in_flight_;
+
+  lock.unlock();
+  WriteBack(res, dirty_page_id);
+  StashPage(res, clean_page_id);
+  ++prefetch_count_;
+  if (compressed_cache_ != nullptr &&
+      compressed_cache_->Remove(page_id, res->GetData(), page_size_)) {
+    ++compressed_hits_;
+    FinishPrefetch(res, true);
+    return true;
+  }
+  ++disk_reads_;
+  // runs on an I/O thread
+  disk_manager_->ReadPageAsync(
+      page_id, res->GetData(),
+      [this, res](bool ok) { FinishPrefetch(res, ok); });
+  return true;
+}
+
+void BufferPoolInstance::WaitForPrefetches() {
+  std::unique_lock<std::mutex> lock(latch_);
+  io_cv_.wait(lock, [this]() { return prefetches_in_flight_ == 0; });
+}
+
+/*
+ * The read of a prefetched page is done, hand the frame to the replacer. If
+ * the read failed, the frame goes back to the free list, the page is read
+ * again by the next fetch. Fetches already waiting on the frame hold pins
+ * and keep it, it is read again synchronously for them
+ */
+void BufferPoolInstance::FinishPrefetch(Page *page, bool ok) {
+  std::unique_lock<std::mutex> lock(latch_);
+  int prefetch_pin = 1;
+  if (!ok && page->pin_count_.compare_exchange_strong(prefetch_pin, -1)) {
+    // taken over, lock-free pins fail until the frame is free
+    page_table_->Remove(page->page_id_);
+    page->page_id_ = INVALID_PAGE_ID;
+    page->is_dirty_ = false;
+    page->state_ = FrameState::FREE;
+    page->pin_count_ = 0;
+    free_list_->push_back(page);
+    --prefetches_in_flight_;
+    io_cv_.notify_all();
+    return;
+  }
+  if (!ok) {
+    lock.unlock();
+    disk_manager_->ReadPage(page->page_id_, page->GetData());
+    lock.lock();
+  }
+  page->state_ = FrameState::READY;
+  if (--page->pin_count_ == 0) {
+    replacer_->Insert(page);
+  }
+  --prefetches_in_flight_;
+  io_cv_.notify_all();
+}
+
+/*
+ * Implementation of unpin page, without the latch
+ * if pin_count>0, decrement it and if it becomes zero, queue it for the
+ * replacer. if pin_count<=0 before this call, return false. is_dirty: set the
+ * dirty flag of this page
+ */
+bool BufferPoolInstance::UnpinPage(page_id_t page_id, bool is_dirty) {
+  assert(page_id != INVALID_PAGE_ID);
+
+  Page *page;
+  if (page_table_->Find(page_id, page)) {
+    return UnpinFrame(page, is_dirty);
+  }
+  return false;
+}
+
+/*
+ * Same as above for a frame the caller still holds, e.g. a page guard, which
+ * saves the page table lookup
+ */
+bool BufferPoolInstance::UnpinPage(Page *page, bool is_dirty) {
+  assert(page >= pages_ && page < pages_ + capacity_);
+  return UnpinFrame(page, is_dirty);
+}
+
+/*
+ * lock-free, the dirty flag is set before the pin is released, whoever takes
+ * the frame over next sees it
+ */
+bool BufferPoolInstance::UnpinFrame(Page *page, bool is_dirty) {
+  int pin_count = page->pin_count_;
+  if (pin_count <= 0) {
+    return false;
+  }
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+  while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+    if (pin_count <= 0) {
+      return false;
+    }
+  }
+  if (pin_count == 1) {
+    MarkPending(page);
+  }
+  return true;
+}
+
+/*
+ * lock-free pin of a frame found in the page table, which may have been
+ * given to another page meanwhile: the pin only sticks if the frame is not
+ * being taken over and still holds page_id afterwards
+ */
+bool BufferPoolInstance::TryPin(Page *page, page_id_t page_id) {
+  int pin_count = page->pin_count_;
+  do {
+    if (pin_count < 0) {
+      return false;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1));
+  // the replacer may have this frame as unpinned, it must hear of the pin
+  MarkPending(page);
+  if (page->page_id_ != page_id) {
+    UnpinFrame(page, false);
+    return false;
+  }
+  if (!page->accessed_.load(std::memory_order_relaxed)) {
+    page->accessed_ = true;
+  }
+  return true;
+}
+
+/*
+ * Queue page for SyncReplacer. A frame already queued is not queued again,
+ * at most capacity_ frames are waiting, so the slot taken is free; a slot
+ * just handed back may still look taken for a moment
+ */
+void BufferPoolInstance::MarkPending(Page *page) {
+  if (page->queued_.load() || page->queued_.exchange(true)) {
+    return;
+  }
+  std::atomic<Page *> &slot = pending_[pending_tail_++ % capacity_];
+  Page *empty = nullptr;
+  while (!slot.compare_exchange_weak(empty, page)) {
+    empty = nullptr;
+  }
+}
+
+/*
+ * Tell the replacer about the frames queued since the last call: accesses
+ * are recorded, pinned frames are not evictable, unpinned ones are. The queue
+ * flag is cleared before the pin count is read, a pin racing with this is
+ * either seen here or queues the frame again. Frames not holding a ready page
+ * are left to whoever owns them.
+ * should be called when holding the latch
+ */
+void BufferPoolInstance::SyncReplacer() {
+  size_t tail = pending_tail_;
+  for (; pending_head_ != tail; ++pending_head_) {
+    std::atomic<Page *> &slot = pending_[pending_head_ % capacity_];
+    Page *page;
+    // the slot is taken, its frame is being stored
+    while ((page = slot.load()) == nullptr) {
+    }
+    slot = nullptr;
+    page->queued_ = false;
+    if (page->state_ != FrameState::READY) {
+      continue;
+    }
+    if (page->accessed_.exchange(false)) {
+      replacer_->RecordAccess(page, page->page_id_);
+    }
+    if (page->pin_count_ > 0) {
+      replacer_->Erase(page);
+    } else {
+      replacer_->Insert(page);
+    }
+  }
+}
+
+size_t BufferPoolInstance::GetReplacerSize() {
+  std::lock_guard<std::mutex> lock(latch_);
+  SyncReplacer();
+  return replacer_->Size();
+}
+
+/*
+ * Used to flush a particular page of the buffer pool to disk. Should call the
+ * write_page method of the disk manager
+ * if page is not found in page table, or its write failed, return false
+ * NOTE: make sure page_id != INVALID_PAGE_ID
+ */
+bool BufferPoolInstance::FlushPage(page_id_t page_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  std::unique_lock<std::mutex> lock(latch_);
+  // an older copy in flight must not land after this one, a page still
+  // being read has nothing to flush yet
+  Page *page;
+  io_cv_.wait(lock, [&]() {
+    return writing_.count(page_id) == 0 &&
+           (!page_table_->Find(page_id, page) ||
+            page->state_ == FrameState::READY);
+  });
+
+  if (page_table_->Find(page_id, page)) {
+    return WritePage(page_id, page->GetData());
+  }
+  return false;
+}
+
+/**
+ * Remove the page from page table, reset its metadata and add it back to free
+ * list, then call disk manager's DeallocatePage() method to delete from disk
+ * file, resident or not. If the page is found within page table, but
+ * pin_count != 0, return false
+ */
+bool BufferPoolInstance::DeletePage(page_id_t page_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  std::unique_lock<std::mutex> lock(latch_);
+  // a copy in flight must land before the id can be allocated again
+  io_cv_.wait(lock, [&]() { return writing_.count(page_id) == 0; });
+  if (!Discard(page_id)) {
+    return false;
+  }
+  disk_manager_->DeallocatePage(page_id);
+  return true;
+}
+
+/**
+ * Take over the resident frames of page_ids, so lock-free pins of them fail.
+ * If one of them is pinned, the frames taken so far are put back
+ * should be called when holding the latch
+ */
+bool BufferPoolInstance::TakeOverPages(const std::vector<page_id_t> &page_ids) {
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    Page *page;
+    if (page_table_->Find(page_ids[i], page) && !TakeOver(page)) {
+      PutBackPages(std::vector<page_id_t>(page_ids.begin(),
+                                          page_ids.begin() + i));
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Undo TakeOverPages, the pages stay as they were, dirty ones included
+ * should be called when holding the latch
+ */
+void BufferPoolInstance::PutBackPages(const std::vector<page_id_t> &page_ids) {
+  for (page_id_t page_id : page_ids) {
+    Page *page;
+    if (page_table_->Find(page_id, page)) {
+      assert(page->pin_count_ == -1);
+      page->pin_count_ = 0;
+    }
+  }
+}
+
+/**
+ * Forget the pages taken over by TakeOverPages without writing them back
+ * should be called when holding the latch
+ */
+void BufferPoolInstance::DiscardPages(const std::vector<page_id_t> &page_ids) {
+  for (page_id_t page_id : page_ids) {
+    if (compressed_cache_ != nullptr) {
+      compressed_cache_->Erase(page_id);
+    }
+    Page *page;
+    if (page_table_->Find(page_id, page)) {
+      assert(page->pin_count_ == -1);
+      FreeFrame(page);
+    }
+  }
+}
+
+/**
+ * Private helper function to forget the page: out of the compressed cache,
+ * its frame back to the free list. false if it is pinned
+ * should be called when holding the latch
+ */
+bool BufferPoolInstance::Discard(page_id_t page_id) {
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->Erase(page_id);
+  }
+
+  Page *page;
+  if (page_table_->Find(page_id, page)) {
+    if (!TakeOver(page)) {
+      return false;
+    }
+    FreeFrame(page);
+  }
+  return true;
+}
+
+/**
+ * Private helper function to take a frame out of the page table and the
+ * replacer, the frame is taken over, its page is dropped
+ * should be called when holding the latch
+ */
+void BufferPoolInstance::FreeFrame(Page *page) {
+  page_table_->Remove(page->page_id_);
+  replacer_->Erase(page);
+
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->state_ = FrameState::FREE;
+  page->pin_count_ = 0;
+  free_list_->push_back(page);
+}
+
+/**
+ * Install a page id freshly allocated by disk manager into this instance.
+ * Choose a victim page either from free list or lru replacer(NOTE: always
+ * choose from free list first), update new page's metadata, zero out memory
+ * and add corresponding entry into page table. return nullptr if all the pages
+ * in this instance are pinned
+ */
+Page *BufferPoolInstance::NewPage(page_id_t page_id, BufferRing *ring) {
+  assert(page_id != INVALID_PAGE_ID);
+  std::unique_lock<std::mutex> lock(latch_);
+  // DeletePage waits for the writes of the id before freeing it
+  assert(writing_.count(page_id) == 0);
+
+  Page *res;
+  page_id_t dirty_page_id, clean_page_id;
+  lsn_t wal_lsn;
+  while (true) {
+    // readahead may have prefetched the id between its allocation and now,
+    // the frame it read into becomes the new page
+    if (page_table_->Find(page_id, res)) {
+      io_cv_.wait(lock, [res]() { return res->state_ == FrameState::READY; });
+      ++res->pin_count_;
+      replacer_->Erase(res);
+      replacer_->RecordAccess(res, page_id);
+      ++new_pages_;
+      res->ResetMemory(page_size_);
+      return res;
+    }
+    res = ClaimFrame(page_id, dirty_page_id, clean_page_id, ring, wal_lsn);
+    // a victim newer than the log, look again once the log caught up
+    if (res != nullptr || !WaitForLog(wal_lsn, lock)) {
+      break;
+    }
+  }
+  if (res == nullptr) {
+    ++pin_failures_;
+    return nullptr;
+  }
+  replacer_->RecordAccess(res, page_id);
+  ++new_pages_;
+  // a stale copy of a deallocated page with the same id
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->Erase(page_id);
+  }
+
+  if (dirty_page_id != INVALID_PAGE_ID || clean_page_id != INVALID_PAGE_ID) {
+    lock.unlock();
+    WriteBack(res, dirty_page_id);
+    StashPage(res, clean_page_id);
+    lock.lock();
+  }
+  res->ResetMemory(page_size_);
+
+  res->state_ = FrameState::READY;
+  io_cv_.notify_all();
+  return res;
+}
+
+/**
+ * Grow or shrink this instance to pool_size frames, at most its capacity.
+ * Growing hands retired frames to the free list. Shrinking retires free
+ * frames first, then evicts unpinned pages like a miss would, writing dirty
+ * ones back, and gives the memory of retired frames back to the OS. Pinned
+ * pages are never drained, the instance stays larger if there are too many.
+ * @return: number of frames in use afterwards
+ */
+size_t BufferPoolInstance::Resize(size_t pool_size) {
+  std::unique_lock<std::mutex> lock(latch_);
+
+  pool_size = std::min(pool_size, capacity_);
+  while (pool_size_ < pool_size) {
+    free_list_->push_back(retired_.back());
+    retired_.pop_back();
+    ++pool_size_;
+  }
+
+  while (pool_size_ > pool_size) {
+    lsn_t wal_lsn;
+    Page *page = GetVictimPage(INVALID_PAGE_ID, wal_lsn);
+    if (page == nullptr) {
+      // a victim newer than the log, look again once the log caught up
+      if (WaitForLog(wal_lsn, lock)) {
+        continue;
+      }
+      break;
+    }
+    assert(page->pin_count_ == -1);
+    if (page->page_id_ != INVALID_PAGE_ID) {
+      page_id_t page_id = page->page_id_;
+      page_table_->Remove(page_id);
+      if (page->is_dirty_) {
+        // concurrent fetches of page_id wait until disk is up to date
+        ++dirty_evictions_;
+        writing_.insert(page_id);
+        page->state_ = FrameState::WRITING;
+        lock.unlock();
+        WriteBack(page, page_id);
+        lock.lock();
+      } else {
+        ++clean_evictions_;
+      }
+    }
+    page->page_id_ = INVALID_PAGE_ID;
+    page->is_dirty_ = false;
+    page->state_ = FrameState::FREE;
+    page->pin_count_ = 0;
+    madvise(page->GetData(), page_size_, MADV_DONTNEED);
+    retired_.push_back(page);
+    --pool_size_;
+  }
+
+  auto arc = dynamic_cast<ARCReplacer<Page *> *>(replacer_);
+  if (arc != nullptr) {
+    arc->SetCapacity(pool_size_);
+  }
+  return pool_size_;
+}
+
+/**
+ * Background write back, called by the cleaner thread of buffer pool manager.
+ * Dirty pages among the next n victims are copied under the latch and
+ * written without it, so eviction finds clean frames and does not stall the
+ * instance on disk. Pages whose log records are not persistent yet (WAL) are
+ * left for the next round. Pages whose write failed stay dirty.
+ * @return: number of pages written
+ */
+size_t BufferPoolInstance::CleanPages(size_t n) {
+  std::vector<Page *> candidates;
+  std::vector<page_id_t> page_ids;
+  std::vector<char> buffer(n * page_size_);
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    SyncReplacer();
+    replacer_->Candidates(candidates, n);
+    for (auto *page : candidates) {
+      if (!page->is_dirty_ || writing_.count(page->page_id_) != 0) {
+        continue;
+      }
+      if (ENABLE_LOGGING &&
+          page->GetLSN() > log_manager_->GetPersistentLSN()) {
+        continue;
+      }
+      // taken over, nobody can pin and modify the page while copying
+      if (!TakeOver(page)) {
+        continue;
+      }
+      memcpy(&buffer[page_ids.size() * page_size_], page->GetData(),
+             page_size_);
+      page->is_dirty_ = false;
+      page_ids.push_back(page->page_id_);
+      writing_.insert(page->page_id_);
+      page->pin_count_ = 0;
+    }
+  }
+
+  // all of them in flight at once
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::future<bool>> writes;
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    writes.push_back(
+        disk_manager_->WritePagesAsync(page_ids[i], &buffer[i * page_size_], 1));
+  }
+  size_t written = 0;
+  for (size_t i = 0; i < writes.size(); ++i) {
+    bool ok = writes[i].get();
+    write_latency_.RecordSince(start);
+    if (ok) {
+      ++written;
+    } else {
+      WriteFailed(page_ids[i], &buffer[i * page_size_]);
+    }
+  }
+  background_writes_ += written;
+
+  if (!page_ids.empty()) {
+    std::lock_guard<std::mutex> lock(latch_);
+    for (auto page_id : page_ids) {
+      writing_.erase(page_id);
+    }
+    io_cv_.notify_all();
+  }
+  return written;
+}
+
+/*
+ * The write of a copy of page_id, taken when the page was marked clean,
+ * failed. The page is dirty again if it is still resident. Otherwise it was
+ * evicted as clean meanwhile and data is its only up to date copy, which is
+ * written again synchronously, like a write back on eviction. The log is
+ * durable up to data already, copies only get here once written. Fetches of
+ * the page wait for that, page_id is still in writing_.
+ * should be called without holding the latch
+ */
+void BufferPoolInstance::WriteFailed(page_id_t page_id, const char *data) {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    Page *page;
+    if (page_table_->Find(page_id, page)) {
+      page->is_dirty_ = true;
+      return;
+    }
+  }
+  WritePage(page_id, data);
+}
+
+/*
+ * ids of the dirty resident pages, in frame order
+ */
+void BufferPoolInstance::GetDirtyPages(std::vector<page_id_t> &page_ids) {
+  std::lock_guard<std::mutex> lock(latch_);
+  for (size_t i = 0; i < capacity_; ++i) {
+    Page *page = &pages_[i];
+    if (page->state_ == FrameState::READY && page->is_dirty_ &&
+        page->page_id_ != INVALID_PAGE_ID) {
+      page_ids.push_back(page->page_id_);
+    }
+  }
+}
+
+/*
+ * Copy page_id to data under its read latch and mark it clean, a change made
+ * afterwards dirties it again. The pin does not go through the replacer, a
+ * victim pick racing with it drops the frame, which the unpin in
+ * BeginPageWrite queues again.
+ * return the pinned frame, nullptr if the page is no longer resident and
+ * dirty or an older copy is still in flight
+ */
+Page *BufferPoolInstance::CopyDirtyPage(page_id_t page_id, char *data) {
+  Page *page;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (!page_table_->Find(page_id, page) ||
+        page->state_ != FrameState::READY || !page->is_dirty_ ||
+        writing_.count(page_id) != 0) {
+      return nullptr;
+    }
+    // frames in the page table are not taken over while the latch is held
+    ++page->pin_count_;
+  }
+
+  page->RLatch();
+  page->is_dirty_ = false;
+  memcpy(data, page->GetData(), page_size_);
+  page->RUnlatch();
+  return page;
+}
+
+void BufferPoolInstance::BeginPageWrite(Page *page) {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    writing_.insert(page->page_id_);
+  }
+  UnpinFrame(page, false);
+}
+
+void BufferPoolInstance::EndPageWrite(page_id_t page_id, const char *data,
+                                      bool ok) {
+  if (!ok) {
+    WriteFailed(page_id, data);
+  }
+  std::lock_guard<std::mutex> lock(latch_);
+  writing_.erase(page_id);
+  io_cv_.notify_all();
+}
+
+/*
+ * The replacer ranks the evictable frames only, frames holding a ready page
+ * which it does not know of are pinned
+ */
+void BufferPoolInstance::GetResidentPages(std::vector<page_id_t> &page_ids) {
+  std::lock_guard<std::mutex> lock(latch_);
+  SyncReplacer();
+
+  std::vector<Page *> victims;
+  replacer_->Candidates(victims, replacer_->Size());
+  std::unordered_set<Page *> evictable(victims.begin(), victims.end());
+  for (size_t i = 0; i < capacity_; ++i) {
+    Page *page = &pages_[i];
+    if (page->state_ == FrameState::READY && evictable.count(page) == 0 &&
+        page->page_id_ != INVALID_PAGE_ID) {
+      page_ids.push_back(page->page_id_);
+    }
+  }
+  for (auto it = victims.rbegin(); it != victims.rend(); ++it) {
+    page_ids.push_back((*it)->page_id_);
+  }
+}
+
+/*
+ * The frame returned is taken over, its pin count is -1
+ * should be called when holding the latch
+ * @return: nullptr if all the pages are pinned
+ */
+Page *BufferPoolInstance::GetVictimPage(page_id_t page_id, lsn_t &wal_lsn) {
+  SyncReplacer();
+  wal_lsn = INVALID_LSN;
+
+  Page *res = nullptr;
+  if (!free_list_->empty()) {
+    res = free_list_->front();
+    free_list_->pop_front();
+    // a stale lock-free pin may hold the free frame for a moment
+    while (!TakeOver(res)) {
+    }
+    return res;
+  }
+
+  // a page dirtied again while the cleaner writes an older copy can not be
+  // written back now, skip it, it goes back to the replacer. A frame pinned
+  // since the last SyncReplacer is dropped, the pin queued it again. A page
+  // newer than the log goes back too, the caller waits for the log, and
+  // gives up if it failed: the page must not be lost nor reach disk
+  std::vector<Page *> skipped;
+  bool found;
+  while ((found = replacer_->VictimFor(res, page_id))) {
+    if (!TakeOver(res)) {
+      continue;
+    }
+    if (IsAheadOfLog(res, wal_lsn)) {
+      res->pin_count_ = 0;
+      skipped.push_back(res);
+      found = false;
+      break;
+    }
+    if (!res->is_dirty_ || writing_.count(res->page_id_) == 0) {
+      break;
+    }
+    res->pin_count_ = 0;
+    skipped.push_back(res);
+  }
+  for (auto *page : skipped) {
+    replacer_->Insert(page);
+  }
+  return found ? res : nullptr;
+}
+
+/*
+ * Victim for a page read or created through ring: the frame of the next slot
+ * of this instance if it can be recycled, otherwise a regular victim, which
+ * the slot keeps from now on. A ring full of other instances' frames only
+ * yields regular victims.
+ * should be called when holding the latch
+ */
+Page *BufferPoolInstance::GetVictimPage(BufferRing *ring, page_id_t page_id,
+                                        lsn_t &wal_lsn, bool readahead) {
+  page_id_t victim_for = readahead ? INVALID_PAGE_ID : page_id;
+  std::lock_guard<std::mutex> lock(ring->latch_);
+
+  size_t size = ring->slots_.size();
+  for (size_t i = 0; i < size; ++i) {
+    BufferRing::Slot &slot = ring->slots_[(ring->next_ + i) % size];
+    Page *res = slot.frame;
+    if (res != nullptr && (res < pages_ || res >= pages_ + capacity_)) {
+      continue;
+    }
+    ring->next_ = (ring->next_ + i + 1) % size;
+
+    // a pinned frame can not be taken over. a page dirtied again while the
+    // cleaner writes an older copy, or newer than the log, can not be
+    // written back now
+    if (res != nullptr && res->page_id_ == slot.page_id && TakeOver(res)) {
+      if (res->page_id_ == slot.page_id && !IsAheadOfLog(res, wal_lsn) &&
+          (!res->is_dirty_ || writing_.count(res->page_id_) == 0)) {
+        replacer_->Erase(res);
+        ++ring->recycle_count_;
+        slot.page_id = page_id;
+        return res;
+      }
+      res->pin_count_ = 0;
+    }
+    if ((res = GetVictimPage(victim_for, wal_lsn)) == nullptr) {
+      return nullptr;
+    }
+    slot.frame = res;
+    slot.page_id = page_id;
+    return res;
+  }
+  return GetVictimPage(victim_for, wal_lsn);
+}
+
+/*
+ * Find a victim frame, recycled from ring if not nullptr, and map page_id to
+ * it, pinned and not ready, so that concurrent fetches of page_id wait on the
+ * frame. If the victim is dirty, dirty_page_id is set to its page id, which
+ * stays in writing_ until the caller wrote it back, otherwise it is
+ * INVALID_PAGE_ID. Likewise clean_page_id is set to the page id of a clean
+ * victim the caller has to stash into the compressed cache, if enabled.
+ * A readahead frame is not an access to page_id: the victim is picked as if
+ * for no page, a ghost entry of page_id stays for the fetch to come.
+ * should be called when holding the latch
+ * @return: nullptr if all the pages are pinned
+ */
+Page *BufferPoolInstance::ClaimFrame(page_id_t page_id,
+                                     page_id_t &dirty_page_id,
+                                     page_id_t &clean_page_id,
+                                     BufferRing *ring, lsn_t &wal_lsn,
+                                     bool readahead) {
+  Page *res = ring == nullptr
+                  ? GetVictimPage(readahead ? INVALID_PAGE_ID : page_id,
+                                  wal_lsn)
+                  : GetVictimPage(ring, page_id, wal_lsn, readahead);
+  if (res == nullptr) {
+    return nullptr;
+  }
+
+  assert(res->pin_count_ == -1);
+  dirty_page_id = INVALID_PAGE_ID;
+  clean_page_id = INVALID_PAGE_ID;
+  if (res->is_dirty_) {
+    dirty_page_id = res->page_id_;
+    writing_.insert(dirty_page_id);
+    ++dirty_evictions_;
+  } else if (res->page_id_ != INVALID_PAGE_ID) {
+    ++clean_evictions_;
+    // until stashed, a fetch of the page must not read disk and then see
+    // this copy stashed after a newer one was written. pages of a scan going
+    // through a ring are not worth keeping
+    if (compressed_cache_ != nullptr && ring == nullptr) {
+      clean_page_id = res->page_id_;
+      writing_.insert(clean_page_id);
+    }
+  }
+  // delete the entry for old page.
+  page_table_->Remove(res->page_id_);
+
+  // insert an entry for the new page.
+  page_table_->Insert(page_id, res);
+
+  // initial meta data, the pin count last: lock-free pins of the frame
+  // must see its new page id
+  res->page_id_ = page_id;
+  res->is_dirty_ = false;
+  res->accessed_ = false;
+  res->state_ = dirty_page_id != INVALID_PAGE_ID ||
+                        clean_page_id != INVALID_PAGE_ID
+                    ? FrameState::WRITING
+                    : FrameState::LOADING;
+  res->pin_count_ = 1;
+  return res;
+}
+
+/*
+ * should be called when holding the latch
+ */
+bool BufferPoolInstance::IsAheadOfLog(Page *page, lsn_t &lsn) {
+  if (!ENABLE_LOGGING || log_manager_ == nullptr || !page->is_dirty_) {
+    return false;
+  }
+  // pages without an lsn field, like the header page, may look newer than
+  // any log record
+  lsn = std::min(page->GetLSN(), log_manager_->GetNextLSN() - 1);
+  return lsn > log_manager_->GetPersistentLSN();
+}
+
+/*
+ * Flush the log up to lsn without the latch, the caller looks for its page
+ * and a victim again afterwards. A page newer than a failed log never
+ * reaches disk, recovery would not know its changes
+ */
+bool BufferPoolInstance::WaitForLog(lsn_t lsn,
+                                    std::unique_lock<std::mutex> &lock) {
+  if (lsn == INVALID_LSN) {
+    return false;
+  }
+  ++wal_flushes_;
+  lock.unlock();
+  bool ok = true;
+  while (ok && lsn > log_manager_->GetPersistentLSN()) {
+    std::promise<void> promise;
+    ok = log_manager_->WakeupFlushThread(&promise);
+  }
+  lock.lock();
+  if (!ok) {
+    LOG_DEBUG("log failed, no page newer than it is evicted");
+  }
+  return ok;
+}
+
+/*
+ * Write back the previous content of a claimed frame, its log records are
+ * persistent (WAL), see GetVictimPage. Must be called without holding the
+ * latch, nothing to do if page_id is INVALID_PAGE_ID
+ */
+void BufferPoolInstance::WriteBack(Page *page, page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  WritePage(page_id, page->GetData());
+
+  std::lock_guard<std::mutex> lock(latch_);
+  page->state_ = FrameState::LOADING;
+  writing_.erase(page_id);
+  io_cv_.notify_all();
+}
+
+/*
+ * Compress the previous content of a claimed frame into the compressed cache,
+ * nothing to do if page_id is INVALID_PAGE_ID. A page that does not compress
+ * is simply dropped, disk has it
+ */
+void BufferPoolInstance::StashPage(Page *page, page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  if (compressed_cache_->Insert(page_id, page->GetData(), page_size_)) {
+    ++compressed_stashes_;
+  }
+
+  std::lock_guard<std::mutex> lock(latch_);
+  page->state_ = FrameState::LOADING;
+  writing_.erase(page_id);
+  io_cv_.notify_all();
+}
+
+/*
+ * A page found in the compressed cache leaves it, the frame is its only copy
+ * in memory from now on
+ */
+void BufferPoolInstance::ReadPage(page_id_t page_id, char *data) {
+  if (compressed_cache_ != nullptr &&
+      compressed_cache_->Remove(page_id, data, page_size_)) {
+    ++compressed_hits_;
+    return;
+  }
+  ++disk_reads_;
+  disk_manager_->ReadPage(page_id, data);
+}
+
+bool BufferPoolInstance::WritePage(page_id_t page_id, const char *data) {
+  auto start = std::chrono::steady_clock::now();
+  bool ok = disk_manager_->WritePage(page_id, data);
+  write_latency_.RecordSince(start);
+  return ok;
+}
+
+BufferPoolStats BufferPoolInstance::GetStats() const {
+  BufferPoolStats stats;
+  stats.fetch_hits = hit_count_;
+  stats.fetch_misses = miss_count_;
+  stats.new_pages = new_pages_;
+  stats.pin_failures = pin_failures_;
+  stats.clean_evictions = clean_evictions_;
+  stats.dirty_evictions = dirty_evictions_;
+  stats.wal_flushes = wal_flushes_;
+  stats.prefetches = prefetch_count_;
+  stats.background_writes = background_writes_;
+  stats.disk_reads = disk_reads_;
+  stats.compressed_hits = compressed_hits_;
+  stats.compressed_stashes = compressed_stashes_;
+  if (compressed_cache_ != nullptr) {
+    stats.compressed_pages = compressed_cache_->GetNumPages();
+    stats.compressed_bytes = compressed_cache_->GetSize();
+  }
+  fetch_miss_latency_.Snapshot(stats.fetch_miss_latency);
+  write_latency_.Snapshot(stats.write_latency);
+  return stats;
+}
+
+} // namespace cmudb
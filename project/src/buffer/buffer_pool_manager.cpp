@@ -6,220 +6,622 @@
  * it, also to unpin a page in the buffer pool.
  */
 
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <future>
+
 #include "buffer/buffer_pool_manager.h"
 
 namespace cmudb {
 
+static constexpr uint32_t PAGE_SET_MAGIC = 0x54455350; // "PSET"
+
+/*
+ * Read the page ids of a page set file, false if it is missing or truncated
+ */
+static bool ReadPageSet(const std::string &file,
+                        std::vector<page_id_t> &page_ids) {
+  std::ifstream in(file, std::ios::binary | std::ios::in);
+  uint32_t magic = 0, count = 0;
+  in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char *>(&count), sizeof(count));
+  if (!in || magic != PAGE_SET_MAGIC) {
+    return false;
+  }
+  page_ids.resize(count);
+  in.read(reinterpret_cast<char *>(page_ids.data()),
+          count * sizeof(page_id_t));
+  return static_cast<bool>(in);
+}
+
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * pool_size frames are split as evenly as possible among num_instances
+ * replacer_type chooses the replacement policy of every instance
+ * max_pool_size bounds Resize, 0 means pool_size
+ * compressed_cache_size bytes, split among the instances, hold compressed
+ * clean victims, 0 disables the compressed cache
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                      DiskManager *disk_manager,
-                                     LogManager *log_manager)
+                                     LogManager *log_manager,
+                                     size_t num_instances,
+                                     ReplacerType replacer_type,
+                                     size_t max_pool_size,
+                                     size_t compressed_cache_size)
     : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager) {
-
-  // a consecutive memory space for buffer pool
-  pages_ = new Page[pool_size_];
-  free_list_ = new std::list<Page *>;
+      log_manager_(log_manager), disk_manager_closed_(false),
+      readahead_window_(READAHEAD_WINDOW), prefetch_running_(false),
+      prefetch_thread_(nullptr), cleaner_running_(false),
+      cleaner_thread_(nullptr), warm_up_running_(false),
+      warm_up_thread_(nullptr), dump_running_(false), dump_thread_(nullptr) {
+  assert(num_instances > 0 && num_instances <= pool_size);
 
-  replacer_ = new LRUReplacer<Page *>;
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-
-  // put all the pages into free list
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_->push_back(&pages_[i]);
+  max_pool_size = std::max(pool_size, max_pool_size);
+  for (size_t i = 0; i < num_instances; ++i) {
+    size_t size = pool_size / num_instances + (i < pool_size % num_instances);
+    size_t max_size =
+        max_pool_size / num_instances + (i < max_pool_size % num_instances);
+    size_t compressed_size = compressed_cache_size / num_instances;
+    instances_.push_back(new BufferPoolInstance(size, disk_manager,
+                                                log_manager, replacer_type,
+                                                max_size, compressed_size));
   }
+  close_hook_id_ = disk_manager_->AddCloseHook([this]() {
+    disk_manager_closed_ = true;
+    StopThreads();
+  });
 }
 
 /*
  * BufferPoolManager Destructor
- * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager() {
-  delete[] pages_;
-  delete page_table_;
-  delete replacer_;
-  delete free_list_;
+  if (!disk_manager_closed_) {
+    disk_manager_->RemoveCloseHook(close_hook_id_);
+  }
+  StopThreads();
+  for (auto *instance : instances_) {
+    delete instance;
+  }
 }
 
-/**
- * 1. search hash table.
- *  1.1 if exist, pin the page and return immediately
- *  1.2 if no exist, find a replacement entry from either free list or lru
- *      replacer. (NOTE: always find from free list first)
- * 2. If the entry chosen for replacement is dirty, write it back to disk.
- * 3. Delete the entry for the old page from the hash table and insert an
- * entry for the new page.
- * 4. Update page metadata, read page content from disk file and return page
- * pointer
- */
-Page *BufferPoolManager::FetchPage(page_id_t page_id) {
+/*
+ * Join the warm up, page set dump, cleaner and prefetch threads, nothing to
+ * do for threads not running
+ */
+void BufferPoolManager::StopThreads() {
+  if (warm_up_thread_ != nullptr) {
+    warm_up_running_ = false;
+    warm_up_thread_->join();
+    delete warm_up_thread_;
+    warm_up_thread_ = nullptr;
+  }
+  StopPageSetDumpThread();
+  StopCleanerThread();
+  StopPrefetchThread();
+}
+
+Page *BufferPoolManager::FetchPage(page_id_t page_id, BufferRing *ring) {
   assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+  return GetInstance(page_id)->FetchPage(page_id, ring);
+}
 
-  Page *res = nullptr;
-  if (page_table_->Find(page_id, res)) {
-    // mark the Page as pinned
-    ++res->pin_count_;
-    // remove its entry from LRUReplacer
-    replacer_->Erase(res);
-    return res;
-  } else {
-    if (!free_list_->empty()) {
-      res = free_list_->front();
-      free_list_->pop_front();
-    } else {
-      if (!replacer_->Victim(res)) {
-        return nullptr;
-      }
+/*
+ * Pin every page first, claiming frames for the misses across all the
+ * instances, then read the misses in page id order with scatter/gather I/O
+ * and only then wait for frames other fetches are still reading
+ */
+size_t BufferPoolManager::FetchPages(const std::vector<page_id_t> &page_ids,
+                                     std::vector<Page *> &pages,
+                                     BufferRing *ring) {
+  pages.assign(page_ids.size(), nullptr);
+  std::vector<size_t> misses;
+  size_t count = 0;
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    assert(page_ids[i] != INVALID_PAGE_ID);
+    bool read;
+    pages[i] = GetInstance(page_ids[i])->PinPage(page_ids[i], read, ring);
+    if (pages[i] != nullptr) {
+      ++count;
+    }
+    if (read) {
+      misses.push_back(i);
     }
   }
 
-  assert(res->pin_count_ == 0);
-  // dirty? write back
-  if (res->is_dirty_) {
-    if (ENABLE_LOGGING) {
-      while (res->GetLSN() > log_manager_->GetPersistentLSN()) {
-        std::promise<void> promise;
-        log_manager_->WakeupFlushThread(&promise);
+  if (!misses.empty()) {
+    std::sort(misses.begin(), misses.end(), [&](size_t a, size_t b) {
+      return page_ids[a] < page_ids[b];
+    });
+    std::vector<page_id_t> read_ids;
+    std::vector<char *> read_data;
+    for (size_t i : misses) {
+      read_ids.push_back(page_ids[i]);
+      read_data.push_back(pages[i]->GetData());
+    }
+    disk_manager_->ReadPages(read_ids, read_data.data());
+    for (size_t i : misses) {
+      GetInstance(page_ids[i])->FinishRead(pages[i]);
+    }
+  }
+  for (size_t i = 0; i < pages.size(); ++i) {
+    if (pages[i] != nullptr) {
+      GetInstance(page_ids[i])->WaitForPage(pages[i]);
+    }
+  }
+  return count;
+}
+
+bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
+  assert(page_id != INVALID_PAGE_ID);
+  return GetInstance(page_id)->UnpinPage(page_id, is_dirty);
+}
+
+bool BufferPoolManager::UnpinPage(Page *page, bool is_dirty) {
+  return GetInstance(page->GetPageId())->UnpinPage(page, is_dirty);
+}
+
+bool BufferPoolManager::FlushPage(page_id_t page_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  return GetInstance(page_id)->FlushPage(page_id);
+}
+
+bool BufferPoolManager::DeletePage(page_id_t page_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  return GetInstance(page_id)->DeletePage(page_id);
+}
+
+/**
+ * Drop a whole object at once: its pages are not written back or freed one
+ * by one, its files are unlinked. Every page is checked with the latch of
+ * every instance held before any is discarded, so a pinned page leaves the
+ * tablespace and all its pages as they were
+ */
+bool BufferPoolManager::DropTablespace(tablespace_id_t tablespace_id) {
+  std::vector<std::vector<page_id_t>> page_ids(instances_.size());
+  for (page_id_t page_id : disk_manager_->GetTablespacePages(tablespace_id)) {
+    page_ids[page_id % instances_.size()].push_back(page_id);
+  }
+
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (auto *instance : instances_) {
+    locks.push_back(instance->Lock());
+  }
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    if (!instances_[i]->TakeOverPages(page_ids[i])) {
+      while (i-- > 0) {
+        instances_[i]->PutBackPages(page_ids[i]);
       }
+      return false;
     }
-    disk_manager_->WritePage(res->page_id_, res->GetData());
   }
-  // delete the entry for old page.
-  page_table_->Remove(res->page_id_);
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->DiscardPages(page_ids[i]);
+  }
+  // fetches of the pages wait for the latches until the files are gone
+  return disk_manager_->DropTablespace(tablespace_id);
+}
 
-  // insert an entry for the new page.
-  page_table_->Insert(page_id, res);
+ReadPageGuard BufferPoolManager::FetchPageRead(page_id_t page_id,
+                                               BufferRing *ring) {
+  Page *page = FetchPage(page_id, ring);
+  if (page == nullptr) {
+    return ReadPageGuard();
+  }
+  page->RLatch();
+  return ReadPageGuard(this, page);
+}
 
-  // initial meta data
-  res->page_id_ = page_id;
-  res->is_dirty_ = false;
-  res->pin_count_ = 1;
-  disk_manager_->ReadPage(page_id, res->GetData());
+WritePageGuard BufferPoolManager::FetchPageWrite(page_id_t page_id) {
+  Page *page = FetchPage(page_id);
+  if (page == nullptr) {
+    return WritePageGuard();
+  }
+  page->WLatch();
+  return WritePageGuard(this, page);
+}
 
-  return res;
+WritePageGuard BufferPoolManager::NewPageGuarded(page_id_t &page_id,
+                                                 BufferRing *ring,
+                                                 ExtentHint *hint) {
+  Page *page = NewPage(page_id, ring, hint);
+  if (page == nullptr) {
+    return WritePageGuard();
+  }
+  page->WLatch();
+  return WritePageGuard(this, page);
 }
 
 /*
- * Implementation of unpin page
- * if pin_count>0, decrement it and if it becomes zero, put it back to
- * replacer if pin_count<=0 before this call, return false. is_dirty: set the
- * dirty flag of this page
+ * Dirty pages are written in page id order, FLUSH_BATCH_SIZE at a time: a
+ * batch is copied, so the pages can be used and modified while it is
+ * written, runs of consecutive page ids go out as a single write, all the
+ * writes of a batch in flight at once, and the file is synced once at the
+ * end. Pages dirtied during the flush may or may
+ * not be written. Pages whose write failed stay dirty, the pages written
+ * are still synced.
+ * num_pages: set to the number of pages written if not nullptr
+ * return false if a write or the sync failed
  */
-bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-  assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+bool BufferPoolManager::FlushAllPages(size_t *num_pages) {
+  std::vector<page_id_t> page_ids;
+  for (auto *instance : instances_) {
+    instance->GetDirtyPages(page_ids);
+  }
+  std::sort(page_ids.begin(), page_ids.end());
 
-  Page *page;
-  if (page_table_->Find(page_id, page)) {
-    if (page->pin_count_ <= 0) {
-      return false;
+  size_t page_size = GetPageSize();
+  std::vector<char> buffer(FLUSH_BATCH_SIZE * page_size);
+  std::vector<page_id_t> batch;
+  size_t count = 0;
+  bool ok = true;
+  for (size_t next = 0; next < page_ids.size();) {
+    batch.clear();
+    std::vector<Page *> pages;
+    lsn_t max_lsn = INVALID_LSN;
+    // copies are registered as in flight only once all of them are taken: a
+    // fetch waiting on one may hold the latch of a page still to be copied
+    for (; next < page_ids.size() && batch.size() < FLUSH_BATCH_SIZE; ++next) {
+      char *data = &buffer[batch.size() * page_size];
+      Page *page = GetInstance(page_ids[next])->CopyDirtyPage(page_ids[next],
+                                                              data);
+      if (page != nullptr) {
+        batch.push_back(page_ids[next]);
+        pages.push_back(page);
+        max_lsn = std::max(max_lsn, page->GetLSN());
+      }
     }
-    if (--page->pin_count_ == 0) {
-      replacer_->Insert(page);
+
+    // WAL: the log must be durable up to the newest change being written.
+    // pages without an lsn field, like the header page, may look newer than
+    // any log record. The batch stays pinned meanwhile, none of its pages,
+    // clean now, can be evicted and written back before the log
+    bool wal = true;
+    if (ENABLE_LOGGING && log_manager_ != nullptr) {
+      max_lsn = std::min(max_lsn, log_manager_->GetNextLSN() - 1);
+      while (wal && max_lsn > log_manager_->GetPersistentLSN()) {
+        std::promise<void> promise;
+        wal = log_manager_->WakeupFlushThread(&promise);
+      }
     }
-    if (is_dirty) {
-      page->is_dirty_ = true;
+    // the log failed, the batch is dirty again and nothing is written
+    if (!wal) {
+      for (size_t i = 0; i < batch.size(); ++i) {
+        GetInstance(batch[i])->UnpinPage(pages[i], true);
+      }
+      ok = false;
+      continue;
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      GetInstance(batch[i])->BeginPageWrite(pages[i]);
     }
-    return true;
+    // first page of each run and its write
+    std::vector<std::pair<size_t, std::future<bool>>> writes;
+    for (size_t begin = 0, end = 1; begin < batch.size(); begin = end++) {
+      while (end < batch.size() && batch[end] == batch[end - 1] + 1) {
+        ++end;
+      }
+      writes.emplace_back(begin, disk_manager_->WritePagesAsync(
+                                     batch[begin], &buffer[begin * page_size],
+                                     end - begin));
+    }
+    for (size_t run = 0; run < writes.size(); ++run) {
+      bool written = writes[run].second.get();
+      size_t end = run + 1 < writes.size() ? writes[run + 1].first
+                                           : batch.size();
+      for (size_t i = writes[run].first; i < end; ++i) {
+        GetInstance(batch[i])->EndPageWrite(batch[i], &buffer[i * page_size],
+                                            written);
+      }
+      if (written) {
+        count += end - writes[run].first;
+      } else {
+        ok = false;
+      }
+    }
+  }
+
+  // the pages written are not durable if the sync failed
+  ok = disk_manager_->SyncPages() && ok;
+  if (num_pages != nullptr) {
+    *num_pages = count;
   }
-  return false;
+  return ok;
+}
+
+/**
+ * User should call this method if needs to create a new page. The page id is
+ * allocated from disk manager first, since it decides which instance will
+ * hold the page. If all the pages of that instance are pinned, further page
+ * ids are taken until one maps to an instance with room: disk manager would
+ * hand the same free id out again if it were given back at once. The ids
+ * which did not fit are handed back at the end. return nullptr if every
+ * instance is full
+ */
+Page *BufferPoolManager::NewPage(page_id_t &page_id, BufferRing *ring,
+                                 ExtentHint *hint) {
+  std::vector<page_id_t> held;
+  std::vector<bool> full(instances_.size(), false);
+  size_t num_full = 0;
+  Page *res = nullptr;
+  while (res == nullptr && num_full < instances_.size()) {
+    page_id_t new_page_id = disk_manager_->AllocatePage(hint);
+    size_t index = new_page_id % instances_.size();
+    if (!full[index]) {
+      res = instances_[index]->NewPage(new_page_id, ring);
+    }
+    if (res != nullptr) {
+      page_id = new_page_id;
+    } else {
+      held.push_back(new_page_id);
+      if (!full[index]) {
+        full[index] = true;
+        ++num_full;
+      }
+    }
+  }
+  for (auto held_page_id : held) {
+    disk_manager_->DeallocatePage(held_page_id);
+  }
+  return res;
 }
 
 /*
- * Used to flush a particular page of the buffer pool to disk. Should call the
- * write_page method of the disk manager
- * if page is not found in page table, return false
- * NOTE: make sure page_id != INVALID_PAGE_ID
+ * Split pool_size among the instances like the constructor does and resize
+ * each of them. An instance does not go beyond the frames reserved for it,
+ * nor below its pinned pages
  */
-bool BufferPoolManager::FlushPage(page_id_t page_id) {
+size_t BufferPoolManager::Resize(size_t pool_size) {
+  assert(pool_size >= instances_.size());
+  size_t num_instances = instances_.size();
+  size_t total = 0;
+  for (size_t i = 0; i < num_instances; ++i) {
+    size_t size = pool_size / num_instances + (i < pool_size % num_instances);
+    total += instances_[i]->Resize(size);
+  }
+  pool_size_ = total;
+  return total;
+}
+
+/*
+ * Queue page_id for the prefetch thread, which reads it into a frame of its
+ * instance and leaves it unpinned. Requests for pages not allocated, for
+ * resident pages or beyond PREFETCH_QUEUE_SIZE pending ones are dropped.
+ * The page is read into a frame of ring if not nullptr
+ */
+void BufferPoolManager::Prefetch(page_id_t page_id,
+                                 std::shared_ptr<BufferRing> ring) {
   assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+  std::lock_guard<std::mutex> lock(prefetch_latch_);
+  if (prefetch_queue_.size() >= PREFETCH_QUEUE_SIZE) {
+    return;
+  }
+  prefetch_queue_.emplace_back(page_id, std::move(ring));
 
-  Page *page;
-  if (page_table_->Find(page_id, page)) {
-    disk_manager_->WritePage(page_id, page->GetData());
-    return true;
+  if (!prefetch_running_) {
+    prefetch_running_ = true;
+
+    prefetch_thread_ = new std::thread([this]() {
+      std::unique_lock<std::mutex> lock(prefetch_latch_);
+      while (true) {
+        prefetch_cv_.wait(lock, [this]() {
+          return !prefetch_running_ || !prefetch_queue_.empty();
+        });
+        if (!prefetch_running_) {
+          break;
+        }
+        page_id_t page_id = prefetch_queue_.front().first;
+        std::shared_ptr<BufferRing> ring =
+            std::move(prefetch_queue_.front().second);
+        prefetch_queue_.pop_front();
+
+        lock.unlock();
+        // pages of tablespaces live beyond the end of the db file
+        if (disk_manager_->IsAllocated(page_id)) {
+          GetInstance(page_id)->PrefetchPage(page_id, ring.get());
+        }
+        ring.reset();
+        lock.lock();
+      }
+    });
   }
-  return false;
+  prefetch_cv_.notify_one();
 }
 
-/**
- * User should call this method for deleting a page. This routine will call
- * disk manager to deallocate the page. First, if page is found within page
- * table, buffer pool manager should be responsible for removing this entry out
- * of page table, resetting page metadata and adding back to free list. Second,
- * call disk manager's DeallocatePage() method to delete from disk file. If
- * the page is found within page table, but pin_count != 0, return false
+/*
+ * Stop and join the prefetch thread, pending requests are dropped
  */
-bool BufferPoolManager::DeletePage(page_id_t page_id) {
-  assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+void BufferPoolManager::StopPrefetchThread() {
+  {
+    std::lock_guard<std::mutex> lock(prefetch_latch_);
+    if (!prefetch_running_) {
+      return;
+    }
+    prefetch_running_ = false;
+    prefetch_queue_.clear();
+  }
+  prefetch_cv_.notify_one();
 
-  Page *page;
-  if (page_table_->Find(page_id, page) && page->pin_count_ == 0) {
-    page_table_->Remove(page_id);
-    replacer_->Erase(page);
-    disk_manager_->DeallocatePage(page_id);
+  prefetch_thread_->join();
+  delete prefetch_thread_;
+  prefetch_thread_ = nullptr;
+}
 
-    page->page_id_ = INVALID_PAGE_ID;
-    page->is_dirty_ = false;
-    free_list_->push_back(page);
+/*
+ * Start a separate thread to write back dirty pages ahead of eviction. Every
+ * interval it looks at the next low_watermark victims of each instance and
+ * writes back the dirty ones, so FetchPage/NewPage almost always find a
+ * clean frame instead of writing one back while holding the latch
+ */
+void BufferPoolManager::RunCleanerThread(std::chrono::milliseconds interval,
+                                         size_t low_watermark) {
+  if (!cleaner_running_) {
+    cleaner_running_ = true;
+
+    cleaner_thread_ = new std::thread([this, interval, low_watermark]() {
+      while (cleaner_running_) {
+        for (auto *instance : instances_) {
+          instance->CleanPages(low_watermark);
+        }
+        std::unique_lock<std::mutex> lock(cleaner_latch_);
+        cleaner_cv_.wait_for(lock, interval,
+                             [this]() { return !cleaner_running_; });
+      }
+    });
   }
-  return false;
 }
 
-/**
- * User should call this method if needs to create a new page. This routine
- * will call disk manager to allocate a page.
- * Buffer pool manager should be responsible to choose a victim page either
- * from free list or lru replacer(NOTE: always choose from free list first),
- * update new page's metadata, zero out memory and add corresponding entry
- * into page table. return nullptr if all the pages in pool are pinned
+/*
+ * Stop and join the cleaner thread
  */
-Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-  std::lock_guard<std::mutex> lock(latch_);
+void BufferPoolManager::StopCleanerThread() {
+  if (cleaner_running_) {
+    {
+      std::lock_guard<std::mutex> lock(cleaner_latch_);
+      cleaner_running_ = false;
+    }
+    cleaner_cv_.notify_one();
 
-  Page *res = nullptr;
-  if (!free_list_->empty()) {
-    res = free_list_->front();
-    free_list_->pop_front();
-  } else {
-    if (!replacer_->Victim(res)) {
-      return nullptr;
+    cleaner_thread_->join();
+    delete cleaner_thread_;
+    cleaner_thread_ = nullptr;
+  }
+}
+
+/*
+ * The page set file holds a magic number, the number of pages and their ids.
+ * The instances' lists are interleaved, so a smaller pool warming up from a
+ * prefix of the file still gets the hottest pages of every instance. The file
+ * is replaced atomically, a crash while dumping leaves the previous one
+ */
+bool BufferPoolManager::DumpPageSet(const std::string &file) {
+  std::vector<std::vector<page_id_t>> lists(instances_.size());
+  size_t count = 0;
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->GetResidentPages(lists[i]);
+    count += lists[i].size();
+  }
+  std::vector<page_id_t> page_ids;
+  page_ids.reserve(count);
+  for (size_t rank = 0; page_ids.size() < count; ++rank) {
+    for (auto &list : lists) {
+      if (rank < list.size()) {
+        page_ids.push_back(list[rank]);
+      }
     }
   }
 
-  assert(res->pin_count_ == 0);
-  page_id = disk_manager_->AllocatePage();
+  std::string tmp_file = file + ".tmp";
+  {
+    std::ofstream out(tmp_file,
+                      std::ios::binary | std::ios::out | std::ios::trunc);
+    uint32_t magic = PAGE_SET_MAGIC;
+    uint32_t size = static_cast<uint32_t>(page_ids.size());
+    out.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char *>(page_ids.data()),
+              page_ids.size() * sizeof(page_id_t));
+    out.flush();
+    if (!out) {
+      std::remove(tmp_file.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmp_file.c_str(), file.c_str()) == 0;
+}
 
-  // dirty? write back
-  if (res->is_dirty_) {
-    if (ENABLE_LOGGING) {
-      while (res->GetLSN() > log_manager_->GetPersistentLSN()) {
-        std::promise<void> promise;
-        log_manager_->WakeupFlushThread(&promise);
-      }
+size_t BufferPoolManager::WarmUp(const std::string &file) {
+  return WarmUp(file, nullptr);
+}
+
+/*
+ * Warm up while the pool already serves requests, pages the workload brings
+ * in first are simply skipped
+ */
+void BufferPoolManager::WarmUpInBackground(const std::string &file) {
+  if (warm_up_thread_ != nullptr) {
+    return;
+  }
+  warm_up_running_ = true;
+  warm_up_thread_ =
+      new std::thread([this, file]() { WarmUp(file, &warm_up_running_); });
+}
+
+/*
+ * Only as many pages as the pool holds are read, the hottest ones. They are
+ * read in page id order, so the disk sees one forward sweep over the file
+ * instead of the random order the workload touched them in. Pages no longer
+ * allocated, e.g. of a dump newer than the db, are skipped.
+ * Stop early once running turns false, if not nullptr
+ */
+size_t BufferPoolManager::WarmUp(const std::string &file,
+                                 const std::atomic<bool> *running) {
+  std::vector<page_id_t> page_ids;
+  if (!ReadPageSet(file, page_ids)) {
+    return 0;
+  }
+  if (page_ids.size() > pool_size_) {
+    page_ids.resize(pool_size_);
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+
+  size_t count = 0;
+  for (page_id_t page_id : page_ids) {
+    if (running != nullptr && !*running) {
+      break;
     }
-    disk_manager_->WritePage(res->page_id_, res->GetData());
+    if (disk_manager_->IsAllocated(page_id) &&
+        GetInstance(page_id)->PrefetchPage(page_id)) {
+      ++count;
+    }
+  }
+  // the reads go on in the background until here
+  for (auto *instance : instances_) {
+    instance->WaitForPrefetches();
   }
-  // delete the entry for old page.
-  page_table_->Remove(res->page_id_);
+  return count;
+}
 
-  // insert an entry for the new page.
-  page_table_->Insert(page_id, res);
+/*
+ * Start a separate thread dumping the page set every interval, so a crash
+ * loses at most an interval's worth of changes to it
+ */
+void BufferPoolManager::RunPageSetDumpThread(
+    const std::string &file, std::chrono::milliseconds interval) {
+  if (!dump_running_) {
+    dump_running_ = true;
+    dump_file_ = file;
 
-  // initial meta data
-  res->page_id_ = page_id;
-  res->is_dirty_ = false;
-  res->pin_count_ = 1;
-  res->ResetMemory();
+    dump_thread_ = new std::thread([this, interval]() {
+      std::unique_lock<std::mutex> lock(dump_latch_);
+      while (!dump_cv_.wait_for(lock, interval,
+                                [this]() { return !dump_running_; })) {
+        DumpPageSet(dump_file_);
+      }
+    });
+  }
+}
 
-  return res;
+/*
+ * Stop and join the dump thread, then dump the page set at shutdown
+ */
+void BufferPoolManager::StopPageSetDumpThread() {
+  if (dump_running_) {
+    {
+      std::lock_guard<std::mutex> lock(dump_latch_);
+      dump_running_ = false;
+    }
+    dump_cv_.notify_one();
+
+    dump_thread_->join();
+    delete dump_thread_;
+    dump_thread_ = nullptr;
+    DumpPageSet(dump_file_);
+  }
 }
 
 } // namespace cmudb
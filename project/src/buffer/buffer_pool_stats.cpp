@@ -0,0 +1,120 @@
+/**
+ * buffer_pool_stats.cpp
+ */
+#include <sstream>
+
+#include "buffer/buffer_pool_stats.h"
+
+namespace cmudb {
+
+double LatencyStats::MeanMicros() const {
+  return count == 0 ? 0 : sum_ns / 1000.0 / count;
+}
+
+uint64_t LatencyStats::PercentileNanos(double p) const {
+  uint64_t rank = static_cast<uint64_t>(count * p / 100.0 + 0.5);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    seen += buckets[i];
+    if (seen >= rank && seen != 0) {
+      return (uint64_t(2) << i) - 1;
+    }
+  }
+  return 0;
+}
+
+LatencyStats &LatencyStats::operator+=(const LatencyStats &that) {
+  count += that.count;
+  sum_ns += that.sum_ns;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    buckets[i] += that.buckets[i];
+  }
+  return *this;
+}
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_ns_(0) {
+  for (auto &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  uint64_t ns = latency.count() > 0 ? latency.count() : 0;
+  size_t bucket = 63 - __builtin_clzll(ns | 1);
+  if (bucket >= HISTOGRAM_BUCKETS) {
+    bucket = HISTOGRAM_BUCKETS - 1;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * concurrent records may be partially included, count and buckets may be off
+ * by the records in flight
+ */
+void LatencyHistogram::Snapshot(LatencyStats &stats) const {
+  stats.count = count_.load(std::memory_order_relaxed);
+  stats.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    stats.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+}
+
+double BufferPoolStats::HitRatio() const {
+  uint64_t fetches = fetch_hits + fetch_misses;
+  return fetches == 0 ? 0 : 100.0 * fetch_hits / fetches;
+}
+
+double BufferPoolStats::CompressedHitRatio() const {
+  uint64_t reads = compressed_hits + disk_reads;
+  return reads == 0 ? 0 : 100.0 * compressed_hits / reads;
+}
+
+BufferPoolStats &BufferPoolStats::operator+=(const BufferPoolStats &that) {
+  fetch_hits += that.fetch_hits;
+  fetch_misses += that.fetch_misses;
+  new_pages += that.new_pages;
+  pin_failures += that.pin_failures;
+  clean_evictions += that.clean_evictions;
+  dirty_evictions += that.dirty_evictions;
+  wal_flushes += that.wal_flushes;
+  prefetches += that.prefetches;
+  background_writes += that.background_writes;
+  disk_reads += that.disk_reads;
+  compressed_hits += that.compressed_hits;
+  compressed_stashes += that.compressed_stashes;
+  compressed_pages += that.compressed_pages;
+  compressed_bytes += that.compressed_bytes;
+  fetch_miss_latency += that.fetch_miss_latency;
+  write_latency += that.write_latency;
+  return *this;
+}
+
+std::string BufferPoolStats::ToString() const {
+  std::ostringstream os;
+  os << "hits: " << fetch_hits << " misses: " << fetch_misses
+     << " hit ratio: " << HitRatio() << "%"
+     << " new: " << new_pages << " pin failures: " << pin_failures
+     << " evictions: " << clean_evictions << " clean, " << dirty_evictions
+     << " dirty (" << wal_flushes << " waited for log)"
+     << " prefetches: " << prefetches
+     << " background writes: " << background_writes << std::endl;
+  if (compressed_stashes != 0) {
+    os << "compressed cache: hits: " << compressed_hits
+       << " disk reads: " << disk_reads << " hit ratio: "
+       << CompressedHitRatio() << "% stashed: " << compressed_stashes
+       << " pages: " << compressed_pages << " bytes: " << compressed_bytes
+       << std::endl;
+  }
+  for (auto item : {std::make_pair("fetch miss", &fetch_miss_latency),
+                    std::make_pair("write", &write_latency)}) {
+    os << item.first << " latency: count " << item.second->count << " mean "
+       << item.second->MeanMicros() << "us p50 "
+       << item.second->PercentileNanos(50) / 1000.0 << "us p99 "
+       << item.second->PercentileNanos(99) / 1000.0 << "us" << std::endl;
+  }
+  return os.str();
+}
+
+} // namespace cmudb
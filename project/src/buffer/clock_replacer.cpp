@@ -0,0 +1,108 @@
+/**
+ * CLOCK implementation
+ */
+#include <cassert>
+
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ClockReplacer<T>::ClockReplacer(size_t num_frames, T base)
+    : num_frames_(num_frames), base_(base),
+      in_replacer_(new std::atomic<bool>[num_frames]),
+      referenced_(new std::atomic<bool>[num_frames]), size_(0), hand_(0) {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    in_replacer_[i] = false;
+    referenced_[i] = false;
+  }
+}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() = default;
+
+/*
+ * Insert value into replacer, a value already inside only gets its reference
+ * bit set again (second chance)
+ */
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+  size_t idx = Index(value);
+  referenced_[idx] = true;
+  if (!in_replacer_[idx].exchange(true)) {
+    ++size_;
+  }
+}
+
+/*
+ * Sweep the clock hand: a referenced frame loses its reference bit and is
+ * skipped, the first unreferenced one is evicted. return false if the
+ * replacer is empty
+ */
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  while (size_ > 0) {
+    size_t idx = hand_;
+    hand_ = (hand_ + 1) % num_frames_;
+
+    if (!in_replacer_[idx]) {
+      continue;
+    }
+    if (referenced_[idx].exchange(false)) {
+      continue;
+    }
+    // may race with Erase, whoever clears the bit owns the frame
+    if (in_replacer_[idx].exchange(false)) {
+      --size_;
+      value = base_ + idx;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Remove value from replacer. If removal is successful, return true,
+ * otherwise return false
+ */
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+  size_t idx = Index(value);
+  if (in_replacer_[idx].exchange(false)) {
+    --size_;
+    return true;
+  }
+  return false;
+}
+
+template <typename T> size_t ClockReplacer<T>::Size() { return size_; }
+
+/*
+ * frames ahead of the hand without reference bit first, then the referenced
+ * ones in the order the second sweep would meet them
+ */
+template <typename T>
+void ClockReplacer<T>::Candidates(std::vector<T> &values, size_t n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (int referenced = 0; referenced < 2; ++referenced) {
+    for (size_t i = 0; i < num_frames_ && values.size() < n; ++i) {
+      size_t idx = (hand_ + i) % num_frames_;
+      if (in_replacer_[idx] && referenced_[idx] == (referenced == 1)) {
+        values.push_back(base_ + idx);
+      }
+    }
+  }
+}
+
+template <typename T>
+inline size_t ClockReplacer<T>::Index(const T &value) const {
+  size_t idx = static_cast<size_t>(value - base_);
+  assert(idx < num_frames_);
+  return idx;
+}
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,282 @@
+/**
+ * compressed_cache.cpp
+ */
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "buffer/compressed_cache.h"
+
+namespace cmudb {
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+
+inline uint32_t Read32(const char *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t Hash(uint32_t value) {
+  return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// a length beyond what fits in its token nibble continues in bytes of 255,
+// ended by a byte below 255
+inline bool PutLength(size_t length, char *dst, size_t &pos,
+                      size_t capacity) {
+  for (; length >= 255; length -= 255) {
+    if (pos == capacity) {
+      return false;
+    }
+    dst[pos++] = static_cast<char>(255);
+  }
+  if (pos == capacity) {
+    return false;
+  }
+  dst[pos++] = static_cast<char>(length);
+  return true;
+}
+
+inline bool GetLength(const unsigned char *src, size_t size, size_t &pos,
+                      size_t &length) {
+  unsigned char byte;
+  do {
+    if (pos == size) {
+      return false;
+    }
+    byte = src[pos++];
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// one sequence: literals, then a match of match_length bytes offset bytes
+// back, or no match at the end of the block (match_length 0)
+bool PutSequence(const char *literals, size_t literal_length, size_t offset,
+                 size_t match_length, char *dst, size_t &pos,
+                 size_t capacity) {
+  size_t token_pos = pos;
+  if (pos == capacity) {
+    return false;
+  }
+  ++pos;
+  unsigned char token = 0;
+  if (literal_length >= 15) {
+    token = 15 << 4;
+    if (!PutLength(literal_length - 15, dst, pos, capacity)) {
+      return false;
+    }
+  } else {
+    token = static_cast<unsigned char>(literal_length << 4);
+  }
+  if (capacity - pos < literal_length) {
+    return false;
+  }
+  memcpy(dst + pos, literals, literal_length);
+  pos += literal_length;
+
+  if (match_length != 0) {
+    if (capacity - pos < 2) {
+      return false;
+    }
+    dst[pos++] = static_cast<char>(offset & 0xff);
+    dst[pos++] = static_cast<char>(offset >> 8);
+    size_t length = match_length - MIN_MATCH;
+    if (length >= 15) {
+      token |= 15;
+      if (!PutLength(length - 15, dst, pos, capacity)) {
+        return false;
+      }
+    } else {
+      token |= static_cast<unsigned char>(length);
+    }
+  }
+  dst[token_pos] = static_cast<char>(token);
+  return true;
+}
+
+} // namespace
+
+CompressedCache::CompressedCache(size_t capacity)
+    : capacity_(capacity), size_(0) {}
+
+/*
+ * Compress outside the latch, concurrent instances of the pool share nothing
+ * but the entry list
+ */
+bool CompressedCache::Insert(page_id_t page_id, const char *data,
+                             size_t page_size) {
+  std::vector<char> buffer(page_size);
+  size_t size = Compress(data, page_size, buffer.data(), page_size - 1);
+  if (size == 0 || size > capacity_) {
+    Erase(page_id);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(latch_);
+  auto it = index_.find(page_id);
+  if (it != index_.end()) {
+    EraseEntry(it->second);
+  }
+  MakeRoom(size);
+  entries_.push_front(Entry{page_id, std::string(buffer.data(), size)});
+  index_[page_id] = entries_.begin();
+  size_ += size;
+  return true;
+}
+
+bool CompressedCache::Remove(page_id_t page_id, char *data,
+                             size_t page_size) {
+  std::string compressed;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    auto it = index_.find(page_id);
+    if (it == index_.end()) {
+      return false;
+    }
+    auto entry = it->second;
+    size_ -= entry->data.size();
+    compressed.swap(entry->data);
+    index_.erase(it);
+    entries_.erase(entry);
+  }
+  return Decompress(compressed.data(), compressed.size(), data, page_size);
+}
+
+void CompressedCache::Erase(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  auto it = index_.find(page_id);
+  if (it != index_.end()) {
+    EraseEntry(it->second);
+  }
+}
+
+size_t CompressedCache::GetSize() {
+  std::lock_guard<std::mutex> lock(latch_);
+  return size_;
+}
+
+size_t CompressedCache::GetNumPages() {
+  std::lock_guard<std::mutex> lock(latch_);
+  return entries_.size();
+}
+
+void CompressedCache::MakeRoom(size_t bytes) {
+  while (size_ + bytes > capacity_ && !entries_.empty()) {
+    EraseEntry(std::prev(entries_.end()));
+  }
+}
+
+void CompressedCache::EraseEntry(std::list<Entry>::iterator it) {
+  size_ -= it->data.size();
+  index_.erase(it->page_id);
+  entries_.erase(it);
+}
+
+/*
+ * Greedy parse: at every position look up the last position with the same 4
+ * byte prefix and take the match if it is real and close enough. Positions
+ * skipped inside a match are not hashed. The longer no match is found, the
+ * larger the steps, so incompressible data is given up on quickly
+ */
+size_t CompressedCache::Compress(const char *src, size_t size, char *dst,
+                                 size_t capacity) {
+  // positions + 1, 0 is empty
+  std::vector<uint32_t> table(1 << HASH_BITS, 0);
+  size_t pos = 0, anchor = 0, ip = 0;
+  while (ip + MIN_MATCH <= size) {
+    uint32_t prefix = Read32(src + ip);
+    uint32_t &slot = table[Hash(prefix)];
+    size_t candidate = slot;
+    slot = static_cast<uint32_t>(ip + 1);
+    if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET ||
+        Read32(src + candidate - 1) != prefix) {
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+    --candidate;
+    // a word at a time, runs of zeros are long
+    size_t length = MIN_MATCH;
+    while (ip + length + 8 <= size &&
+           memcmp(src + candidate + length, src + ip + length, 8) == 0) {
+      length += 8;
+    }
+    while (ip + length < size && src[candidate + length] == src[ip + length]) {
+      ++length;
+    }
+    if (!PutSequence(src + anchor, ip - anchor, ip - candidate, length, dst,
+                     pos, capacity)) {
+      return 0;
+    }
+    ip += length;
+    anchor = ip;
+  }
+  // trailing literals, if any. an empty input still takes a token
+  if ((anchor < size || pos == 0) &&
+      !PutSequence(src + anchor, size - anchor, 0, 0, dst, pos, capacity)) {
+    return 0;
+  }
+  return pos;
+}
+
+/*
+ * Every length and offset is checked against both buffers, a corrupted block
+ * is reported instead of read or written out of bounds
+ */
+bool CompressedCache::Decompress(const char *src, size_t size, char *dst,
+                                 size_t dst_size) {
+  auto in = reinterpret_cast<const unsigned char *>(src);
+  size_t ip = 0, op = 0;
+  while (ip < size) {
+    unsigned char token = in[ip++];
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !GetLength(in, size, ip, literal_length)) {
+      return false;
+    }
+    if (size - ip < literal_length || dst_size - op < literal_length) {
+      return false;
+    }
+    memcpy(dst + op, src + ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    // the last sequence may have no match
+    if (ip == size) {
+      break;
+    }
+
+    if (size - ip < 2) {
+      return false;
+    }
+    size_t offset = in[ip] | (in[ip + 1] << 8);
+    ip += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !GetLength(in, size, ip, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > op || dst_size - op < match_length) {
+      return false;
+    }
+    // the match may overlap the bytes it produces, copy a period at a time
+    if (offset == 1) {
+      memset(dst + op, dst[op - 1], match_length);
+      op += match_length;
+      continue;
+    }
+    while (match_length > 0) {
+      size_t length = std::min(offset, match_length);
+      memcpy(dst + op, dst + op - offset, length);
+      op += length;
+      match_length -= length;
+    }
+  }
+  return op == dst_size;
+}
+
+} // namespace cmudb
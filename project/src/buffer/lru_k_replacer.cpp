@@ -0,0 +1,118 @@
+/**
+ * LRU-K implementation
+ */
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t k, size_t correlated_period)
+    : k_(k), correlated_period_(correlated_period), current_timestamp_(0) {
+  assert(k_ > 0);
+}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() = default;
+
+/*
+ * Make value evictable. A value never accessed before counts the insertion as
+ * its first access
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  history &h = frames_[value];
+  if (h.accesses.empty()) {
+    h.accesses.push_back(current_timestamp_++);
+  }
+  if (!h.evictable) {
+    h.evictable = true;
+    evictable_.emplace(Key(h), value);
+  }
+}
+
+/*
+ * Evict the frame with the largest backward k-distance and forget its history.
+ * return false if no frame is evictable
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (evictable_.empty()) {
+    return false;
+  }
+  auto it = evictable_.begin();
+  value = it->second;
+  evictable_.erase(it);
+  frames_.erase(value);
+  return true;
+}
+
+/*
+ * Make value not evictable, its history is kept. return false if value is not
+ * evictable
+ */
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = frames_.find(value);
+  if (it == frames_.end() || !it->second.evictable) {
+    return false;
+  }
+  evictable_.erase(Key(it->second));
+  it->second.evictable = false;
+  return true;
+}
+
+template <typename T> size_t LRUKReplacer<T>::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return evictable_.size();
+}
+
+template <typename T>
+void LRUKReplacer<T>::Candidates(std::vector<T> &values, size_t n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto it = evictable_.begin();
+       it != evictable_.end() && values.size() < n; ++it) {
+    values.push_back(it->second);
+  }
+}
+
+/*
+ * Append an access to value's history, a correlated access only moves the last
+ * one. The history restarts if value now holds another page
+ */
+template <typename T>
+void LRUKReplacer<T>::RecordAccess(const T &value, page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  history &h = frames_[value];
+  if (h.evictable) {
+    evictable_.erase(Key(h));
+  }
+  if (h.page_id != page_id) {
+    h.page_id = page_id;
+    h.accesses.clear();
+  }
+  if (!h.accesses.empty() &&
+      current_timestamp_ - h.accesses.back() < correlated_period_) {
+    h.accesses.back() = current_timestamp_++;
+  } else {
+    h.accesses.push_back(current_timestamp_++);
+    if (h.accesses.size() > k_) {
+      h.accesses.pop_front();
+    }
+  }
+  if (h.evictable) {
+    evictable_.emplace(Key(h), value);
+  }
+}
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
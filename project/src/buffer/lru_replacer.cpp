@@ -103,6 +103,16 @@ template <typename T> size_t LRUReplacer<T>::Size() {
   return size_;
 }
 
+template <typename T>
+void LRUReplacer<T>::Candidates(std::vector<T> &values, size_t n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (node *pointer = head_->next.get(); pointer && values.size() < n;
+       pointer = pointer->next.get()) {
+    values.push_back(pointer->data);
+  }
+}
+
 // for debug: should be called when holding the lock
 template <typename T> void LRUReplacer<T>::check() {
   node *pointer = head_.get();
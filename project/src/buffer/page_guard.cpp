@@ -0,0 +1,71 @@
+/**
+ * page_guard.cpp
+ */
+#include "buffer/page_guard.h"
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+ReadPageGuard::ReadPageGuard(BufferPoolManager *buffer_pool_manager,
+                             Page *page)
+    : buffer_pool_manager_(buffer_pool_manager), page_(page) {}
+
+ReadPageGuard::ReadPageGuard(ReadPageGuard &&that) noexcept
+    : buffer_pool_manager_(that.buffer_pool_manager_), page_(that.page_) {
+  that.page_ = nullptr;
+}
+
+/*
+ * Release the page held so far, then take over the one of that
+ */
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    buffer_pool_manager_ = that.buffer_pool_manager_;
+    page_ = that.page_;
+    that.page_ = nullptr;
+  }
+  return *this;
+}
+
+void ReadPageGuard::Drop() {
+  if (page_ != nullptr) {
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_, false);
+    page_ = nullptr;
+  }
+}
+
+WritePageGuard::WritePageGuard(BufferPoolManager *buffer_pool_manager,
+                               Page *page)
+    : buffer_pool_manager_(buffer_pool_manager), page_(page) {}
+
+WritePageGuard::WritePageGuard(WritePageGuard &&that) noexcept
+    : buffer_pool_manager_(that.buffer_pool_manager_), page_(that.page_),
+      is_dirty_(that.is_dirty_) {
+  that.page_ = nullptr;
+}
+
+/*
+ * Release the page held so far, then take over the one of that
+ */
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    buffer_pool_manager_ = that.buffer_pool_manager_;
+    page_ = that.page_;
+    is_dirty_ = that.is_dirty_;
+    that.page_ = nullptr;
+  }
+  return *this;
+}
+
+void WritePageGuard::Drop() {
+  if (page_ != nullptr) {
+    page_->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_, is_dirty_);
+    page_ = nullptr;
+  }
+}
+
+} // namespace cmudb
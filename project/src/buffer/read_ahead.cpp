@@ -0,0 +1,50 @@
+/**
+ * read_ahead.cpp
+ */
+#include <algorithm>
+
+#include "buffer/read_ahead.h"
+
+namespace cmudb {
+
+ReadAhead::ReadAhead(BufferPoolManager *buffer_pool_manager,
+                     std::shared_ptr<BufferRing> ring)
+    : buffer_pool_manager_(buffer_pool_manager), ring_(std::move(ring)),
+      last_page_id_(INVALID_PAGE_ID), issued_until_(INVALID_PAGE_ID),
+      window_(1) {}
+
+/*
+ * Prefetch next_page_id, and while the scan is sequential the pages following
+ * it up to the window, skipping ids a previous call already issued. Nothing to
+ * do if the scan is still on the same page
+ */
+void ReadAhead::OnPage(page_id_t page_id, page_id_t next_page_id) {
+  if (page_id == last_page_id_) {
+    return;
+  }
+  size_t max_window = buffer_pool_manager_->GetReadAheadWindow();
+  bool sequential =
+      last_page_id_ != INVALID_PAGE_ID && page_id == last_page_id_ + 1;
+  last_page_id_ = page_id;
+  if (max_window == 0 || next_page_id == INVALID_PAGE_ID) {
+    return;
+  }
+
+  if (sequential && next_page_id == page_id + 1) {
+    window_ = std::min(window_ * 2, max_window);
+  } else {
+    window_ = 1;
+    issued_until_ = INVALID_PAGE_ID;
+  }
+
+  page_id_t from = std::max(next_page_id, issued_until_ + 1);
+  page_id_t until = next_page_id + static_cast<page_id_t>(window_) - 1;
+  for (page_id_t id = from; id <= until; ++id) {
+    buffer_pool_manager_->Prefetch(id, ring_);
+  }
+  if (window_ > 1) {
+    issued_until_ = std::max(issued_until_, until);
+  }
+}
+
+} // namespace cmudb
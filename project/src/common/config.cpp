@@ -4,4 +4,10 @@ namespace cmudb {
   std::atomic<bool> ENABLE_LOGGING(false);  // for virtual table
   std::chrono::duration<long long int> LOG_TIMEOUT =
    std::chrono::seconds(1);
+  std::chrono::milliseconds CLEANER_INTERVAL =
+   std::chrono::milliseconds(10);
+  std::chrono::milliseconds PAGE_SET_DUMP_INTERVAL =
+   std::chrono::seconds(60);
+  std::chrono::milliseconds SYNC_INTERVAL =
+   std::chrono::seconds(1);
 }
@@ -21,7 +21,7 @@ Transaction *TransactionManager::Begin() {
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
+bool TransactionManager::Commit(Transaction *txn) {
   txn->SetState(TransactionState::COMMITTED);
   // truly delete before commit
   auto write_set = txn->GetWriteSet();
@@ -36,12 +36,17 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  bool durable = true;
   if (ENABLE_LOGGING) {
     LogRecord log(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
     txn->SetPrevLSN(log_manager_->AppendLogRecord(log));
 
     // make sure log persist, pre lsn is the last one
     while (txn->GetPrevLSN() > log_manager_->GetPersistentLSN()) {
+      if (log_manager_->HasFailed()) {
+        durable = false;
+        break;
+      }
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
       //LOG_DEBUG("Commit(): spin....\n");
     }
@@ -58,6 +63,7 @@ void TransactionManager::Commit(Transaction *txn) {
   for (auto locked_rid : lock_set) {
     lock_manager_->Unlock(txn, locked_rid);
   }
+  return durable;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
@@ -86,7 +92,8 @@ void TransactionManager::Abort(Transaction *txn) {
     txn->SetPrevLSN(log_manager_->AppendLogRecord(log));
 
     // make sure log persist, pre lsn is the last one
-    while (txn->GetPrevLSN() > log_manager_->GetPersistentLSN()) {
+    while (txn->GetPrevLSN() > log_manager_->GetPersistentLSN() &&
+           !log_manager_->HasFailed()) {
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
       //LOG_DEBUG("Abort(): spin....\n");
     }
@@ -7,112 +7,452 @@
  * system.
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <thread>
+#include <unistd.h>
+#include <vector>
 
+#include "common/exception.h"
 #include "common/logger.h"
 #include "disk/disk_manager.h"
 
 namespace cmudb {
 
-static char *buffer_used = nullptr;
+namespace {
+
+// O_DIRECT needs aligned buffers. Frames of the buffer pool arena are page
+// aligned, other callers (tests, recovery) go through a bounce buffer
+class AlignedBuffer {
+public:
+  AlignedBuffer(const char *data, size_t size)
+      : data_(const_cast<char *>(data)), bounce_(nullptr) {
+    if (reinterpret_cast<uintptr_t>(data) % MIN_PAGE_SIZE != 0) {
+      bounce_ = static_cast<char *>(aligned_alloc(MIN_PAGE_SIZE, size));
+      data_ = bounce_;
+    }
+  }
+  ~AlignedBuffer() { free(bounce_); }
+
+  inline char *Get() const { return data_; }
+
+private:
+  char *data_;
+  char *bounce_;
+};
+
+// first bytes of the header block of a db file, the rest is zeros
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t page_size;
+};
+
+const char FILE_MAGIC[8] = {'l', 'e', 'n', 'g', 'i', 'n', 'e', '\0'};
+// 0: no header, PAGE_SIZE pages from offset 0
+// 1: pages behind the header
+// 2: pages in groups behind bitmap blocks
+const uint32_t FILE_VERSION = 2;
+
+// first bytes of the header block of a tablespace file
+struct TablespaceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t page_size;
+  int32_t tablespace_id;
+};
+
+const char TABLESPACE_MAGIC[8] = {'l', 'e', 'n', 'g', 't', 'b', 's', '\0'};
+const uint32_t TABLESPACE_VERSION = 1;
+
+inline bool IsValidPageSize(size_t page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+// version 0 files have nothing to tell them by but their size and the record
+// count of the header page at page 0, see HeaderPage. Only a hint, zeros or
+// an unrelated file pass it as well
+inline bool IsVersion0File(const char *first_page, off_t file_size) {
+  int32_t record_count;
+  memcpy(&record_count, first_page, sizeof(record_count));
+  return file_size > 0 && file_size % PAGE_SIZE == 0 && record_count >= 0 &&
+         record_count <= (PAGE_SIZE - 4) / 36;
+}
+
+// make a rename in the directory of path durable
+inline bool SyncDirectory(const std::string &path) {
+  std::string::size_type n = path.rfind('/');
+  std::string dir = n == std::string::npos ? "." : path.substr(0, n + 1);
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd == -1) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  return close(fd) == 0 && ok;
+}
+
+inline void FillFileHeader(char *block, size_t page_size) {
+  FileHeader header;
+  memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+  header.version = FILE_VERSION;
+  header.page_size = static_cast<uint32_t>(page_size);
+  memcpy(block, &header, sizeof(header));
+}
+
+} // namespace
 
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input direct_io: open the database file with O_DIRECT, falls back to
+ * buffered I/O if the file system does not support it
+ * @input page_size: page size of a new database file, a power of two between
+ * MIN_PAGE_SIZE and MAX_PAGE_SIZE
+ * @input data_sync, log_sync: when writes to the database file/log file
+ * become durable
+ * throw an exception if the page size is not supported or an existing file
+ * does not start with a valid file header. Files of version 0 must be
+ * upgraded with UpgradeVersion0File first
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
-      flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, bool direct_io,
+                         size_t page_size, IOEngineType io_engine,
+                         SyncMode data_sync, SyncMode log_sync)
+    : log_fd_(-1), log_size_(0), log_allocated_(0), log_end_found_(false),
+      file_name_(db_file),
+      db_fd_(-1), direct_io_(false), file_size_(0), page_size_(page_size),
+      io_engine_type_(io_engine), io_engine_(nullptr), data_sync_(data_sync),
+      log_sync_(log_sync), data_unsynced_(false), log_unsynced_(false),
+      sync_thread_(nullptr), sync_running_(false), bitmap_dirty_(false),
+      next_page_id_(0),
+      free_hint_(0), db_allocated_(0), has_tablespaces_(false),
+      next_hook_id_(0), num_flushes_(0), flush_log_(false),
+      flush_log_f_(nullptr), buffer_used_(nullptr) {
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  catalog_name_ = file_name_.substr(0, n) + ".tablespaces";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
+  struct stat stat_buf;
+  log_fd_ = open(log_name_.c_str(),
+                 O_RDWR | O_CREAT | (log_sync == SyncMode::DSYNC ? O_DSYNC : 0),
+                 0644);
+  if (log_fd_ == -1 || fstat(log_fd_, &stat_buf) != 0) {
+    LOG_DEBUG("can not open log file");
+  } else {
+    log_size_ = stat_buf.st_size;
+    log_allocated_ = stat_buf.st_size;
   }
 
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  int flags = O_RDWR | O_CREAT | (data_sync == SyncMode::DSYNC ? O_DSYNC : 0);
+  if (direct_io) {
+    db_fd_ = open(db_file.c_str(), flags | O_DIRECT, 0644);
+    direct_io_ = db_fd_ != -1;
+    if (db_fd_ == -1) {
+      LOG_DEBUG("O_DIRECT not supported, use buffered I/O");
+    }
+  }
+  if (db_fd_ == -1) {
+    db_fd_ = open(db_file.c_str(), flags, 0644);
+  }
+  if (db_fd_ == -1 || fstat(db_fd_, &stat_buf) != 0) {
+    LOG_DEBUG("can not open db file");
+  } else {
+    file_size_ = stat_buf.st_size;
+  }
+
+  try {
+    InitFileHeader(page_size);
+    LoadBitmap();
+    db_allocated_ = file_size_;
+    LoadTablespaces();
+  } catch (...) {
+    // the destructor does not run
+    CloseTablespaces();
+    if (db_fd_ != -1) {
+      close(db_fd_);
+    }
+    if (log_fd_ != -1) {
+      close(log_fd_);
+    }
+    throw;
+  }
+
+  if (data_sync == SyncMode::PERIODIC || log_sync == SyncMode::PERIODIC) {
+    sync_running_ = true;
+    sync_thread_ = new std::thread([this]() {
+      std::unique_lock<std::mutex> lock(sync_latch_);
+      bool running = true;
+      // one last round when stopping
+      while (running) {
+        running = !sync_cv_.wait_for(lock, SYNC_INTERVAL,
+                                     [this]() { return !sync_running_; });
+        if (data_unsynced_.exchange(false)) {
+          SyncDataFiles();
+        }
+        if (log_unsynced_.exchange(false) && fdatasync(log_fd_) != 0) {
+          LOG_DEBUG("I/O error while syncing log");
+        }
+      }
+    });
   }
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  // users stop submitting I/O first, e.g. a buffer pool destroyed after us
+  std::map<size_t, std::function<void()>> hooks;
+  {
+    std::lock_guard<std::mutex> lock(hooks_latch_);
+    hooks.swap(close_hooks_);
+  }
+  for (auto &hook : hooks) {
+    hook.second();
+  }
+  // waits for the I/O in flight
+  delete io_engine_;
+  FlushBitmap();
+  // reservations go away with us, hints outliving us have nothing to release
+  for (ExtentHint *hint : hints_) {
+    hint->disk_manager = nullptr;
+  }
+  if (sync_thread_ != nullptr) {
+    {
+      std::lock_guard<std::mutex> lock(sync_latch_);
+      sync_running_ = false;
+    }
+    sync_cv_.notify_one();
+    sync_thread_->join();
+    delete sync_thread_;
+  }
+  CloseTablespaces();
+  if (db_fd_ != -1) {
+    close(db_fd_);
+  }
+  if (log_fd_ != -1) {
+    close(log_fd_);
+  }
 }
 
 /**
  * Write the contents of the specified page into disk file
+ * @return: false if the page or its bitmap block was not written
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id*PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
+bool DiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  bool ok = FlushBitmap();
+  int fd;
+  off_t offset;
+  Locate(page_id, 1, fd, offset);
+  return WriteAt(fd, page_data, page_size_, offset) && ok;
+}
+
+/**
+ * Write the contents of num_pages pages, laid out one after the other in
+ * pages_data, to page_id and the pages following it
+ */
+bool DiskManager::WritePages(page_id_t page_id, const char *pages_data,
+                             size_t num_pages) {
+  bool ok = FlushBitmap();
+  // a bitmap block sits between groups, extents may live in tablespaces
+  while (num_pages > 0) {
+    int fd;
+    off_t offset;
+    size_t count = Locate(page_id, num_pages, fd, offset);
+    ok = WriteAt(fd, pages_data, count * page_size_, offset) && ok;
+    page_id += count;
+    pages_data += count * page_size_;
+    num_pages -= count;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  return ok;
+}
+
+/**
+ * Vectored I/O of num_pages pages, page_id and the pages following it, page i
+ * in pages_data[i]. Frames of the buffer pool need not be adjacent in memory
+ */
+void DiskManager::ReadPages(page_id_t page_id, size_t num_pages,
+                            char *const *pages_data) {
+  PagesAt(false, page_id, num_pages, pages_data);
+}
+
+bool DiskManager::WritePages(page_id_t page_id, size_t num_pages,
+                             const char *const *pages_data) {
+  bool ok = FlushBitmap();
+  return PagesAt(true, page_id, num_pages,
+                 const_cast<char *const *>(pages_data)) &&
+         ok;
+}
+
+/**
+ * Scatter/gather I/O of the pages listed in page_ids, page page_ids[i] in
+ * pages_data[i]. Each run of consecutive ids takes one request, so the list
+ * should be sorted, an unsorted one only takes more requests
+ */
+void DiskManager::ReadPages(const std::vector<page_id_t> &page_ids,
+                            char *const *pages_data) {
+  size_t last;
+  for (size_t first = 0; first < page_ids.size(); first = last) {
+    for (last = first + 1;
+         last < page_ids.size() && page_ids[last] == page_ids[last - 1] + 1;
+         ++last) {
+    }
+    PagesAt(false, page_ids[first], last - first, pages_data + first);
+  }
+}
+
+bool DiskManager::WritePages(const std::vector<page_id_t> &page_ids,
+                             const char *const *pages_data) {
+  bool ok = FlushBitmap();
+  size_t last;
+  for (size_t first = 0; first < page_ids.size(); first = last) {
+    for (last = first + 1;
+         last < page_ids.size() && page_ids[last] == page_ids[last - 1] + 1;
+         ++last) {
+    }
+    ok = PagesAt(true, page_ids[first], last - first,
+                 const_cast<char *const *>(pages_data) + first) &&
+         ok;
+  }
+  return ok;
+}
+
+/**
+ * Flush the db file to stable storage. WritePage/WritePages only hand the
+ * data to the OS. Frees since the last page write reach the bitmap here
+ * @return: false if a bitmap block was not written or a sync failed, the
+ * pages written since the last successful sync may not be durable
+ */
+bool DiskManager::SyncPages() {
+  bool ok = FlushBitmap();
+  data_unsynced_ = false;
+  return SyncDataFiles() && ok;
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id*PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
-    }
+  int fd;
+  off_t offset;
+  Locate(page_id, 1, fd, offset);
+  ReadAt(fd, page_data, page_size_, offset);
+}
+
+void DiskManager::ReadPageAsync(page_id_t page_id, char *page_data,
+                                std::function<void(bool)> callback) {
+  int fd;
+  off_t offset;
+  Locate(page_id, 1, fd, offset);
+  SubmitAt(false, fd, page_data, page_size_, offset, std::move(callback));
+}
+
+void DiskManager::WritePagesAsync(page_id_t page_id, const char *pages_data,
+                                  size_t num_pages,
+                                  std::function<void(bool)> callback) {
+  // a page on disk always has its bit on disk
+  if (!FlushBitmap()) {
+    callback(false);
+    return;
+  }
+  // a bitmap block sits between groups, extents may live in tablespaces: one
+  // write per piece and the callback after the last one
+  struct Piece {
+    int fd;
+    off_t offset;
+    size_t count;
+  };
+  std::vector<Piece> pieces;
+  for (size_t done = 0; done < num_pages;) {
+    Piece piece;
+    piece.count = Locate(page_id + static_cast<page_id_t>(done),
+                         num_pages - done, piece.fd, piece.offset);
+    pieces.push_back(piece);
+    done += piece.count;
+  }
+  if (pieces.size() == 1) {
+    SubmitAt(true, pieces[0].fd, const_cast<char *>(pages_data),
+             num_pages * page_size_, pieces[0].offset, std::move(callback));
+    return;
+  }
+  struct Writes {
+    std::atomic<size_t> remaining;
+    std::atomic<bool> ok;
+    std::function<void(bool)> callback;
+  };
+  auto writes = std::make_shared<Writes>();
+  writes->remaining = pieces.size();
+  writes->ok = true;
+  writes->callback = std::move(callback);
+  for (auto &piece : pieces) {
+    SubmitAt(true, piece.fd, const_cast<char *>(pages_data),
+             piece.count * page_size_, piece.offset, [writes](bool ok) {
+               if (!ok) {
+                 writes->ok = false;
+               }
+               if (--writes->remaining == 0) {
+                 writes->callback(writes->ok);
+               }
+             });
+    pages_data += piece.count * page_size_;
   }
 }
 
+std::future<bool> DiskManager::ReadPageAsync(page_id_t page_id,
+                                             char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  ReadPageAsync(page_id, page_data,
+                [promise](bool ok) { promise->set_value(ok); });
+  return promise->get_future();
+}
+
+std::future<bool> DiskManager::WritePagesAsync(page_id_t page_id,
+                                               const char *pages_data,
+                                               size_t num_pages) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  WritePagesAsync(page_id, pages_data, num_pages,
+                  [promise](bool ok) { promise->set_value(ok); });
+  return promise->get_future();
+}
+
+const char *DiskManager::GetIOEngineName() { return GetIOEngine()->GetName(); }
+
+size_t DiskManager::AddCloseHook(std::function<void()> hook) {
+  std::lock_guard<std::mutex> lock(hooks_latch_);
+  close_hooks_[next_hook_id_] = std::move(hook);
+  return next_hook_id_++;
+}
+
+void DiskManager::RemoveCloseHook(size_t hook_id) {
+  std::lock_guard<std::mutex> lock(hooks_latch_);
+  close_hooks_.erase(hook_id);
+}
+
 /**
  * Write the contents of the log into disk file
- * Only return when sync is done, and only perform sequence write
+ * Only perform sequence write, durable on return unless the log sync mode is
+ * NONE or PERIODIC. The log file is preallocated ahead of the write. The
+ * first write after opening the file looks for the end of the log, the
+ * flushes are all of its size
  */
-void DiskManager::WriteLog(char *log_data, int size) {
+bool DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+  assert(log_data != buffer_used_);
+  buffer_used_ = log_data;
 
   if (size == 0) // no effect on num_flushes_ if log buffer is empty
-    return;
+    return true;
 
   flush_log_ = true;
 
@@ -122,17 +462,24 @@ void DiskManager::WriteLog(char *log_data, int size) {
         std::future_status::ready);
 
   num_flushes_ += 1;
+  if (!log_end_found_) {
+    log_size_ = FindLogEnd(size);
+    log_end_found_ = true;
+  }
+  off_t offset = log_size_;
+  if (offset + size > log_allocated_ && !PreallocateLog(offset + size)) {
+    LOG_DEBUG("can not preallocate the log file");
+  }
   // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
+  if (pwrite(log_fd_, log_data, size, offset) != size) {
     LOG_DEBUG("I/O error while writing log");
-    return;
+    flush_log_ = false;
+    return false;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
+  log_size_ = offset + size;
+  bool ok = AfterWrite(log_fd_, log_sync_, log_unsynced_);
   flush_log_ = false;
+  return ok;
 }
 
 /**
@@ -141,35 +488,334 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * @return: false means already reach the end
  */
 bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+  // the zeros preallocated after the log hold no record, recovery stops on
+  // them before the end of the file
+  if (offset >= log_size_) {
     LOG_DEBUG("end of log file");
-    LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+    LOG_DEBUG("file size is %d", static_cast<int>(log_size_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  ssize_t read_count = pread(log_fd_, log_data, size, offset);
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading log");
+    read_count = 0;
+  }
   // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
   if (read_count < size) {
-    log_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+void DiskManager::SyncLog() {
+  log_unsynced_ = false;
+  if (fdatasync(log_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing log");
+  }
+}
+
+/**
+ * Private helper function to find the end of the log after opening its file:
+ * every flush starts with a record, whose size is not zero, the zeros
+ * preallocated after the last flush do not
+ */
+off_t DiskManager::FindLogEnd(int flush_size) {
+  off_t end = 0;
+  int32_t record_size;
+  while (end < log_allocated_ &&
+         pread(log_fd_, &record_size, sizeof(record_size), end) ==
+             sizeof(record_size) &&
+         record_size != 0) {
+    end += flush_size;
+  }
+  return end;
+}
+
+/**
+ * Private helper function to grow the log file by LOG_PREALLOC_SIZE at a
+ * time, up to end at least. The blocks are written with zeros and synced
+ * once here: appends then neither allocate blocks nor change the size, their
+ * fdatasync has no metadata to write
+ */
+bool DiskManager::PreallocateLog(off_t end) {
+  off_t length = (end - log_allocated_ + LOG_PREALLOC_SIZE - 1) /
+                 LOG_PREALLOC_SIZE * LOG_PREALLOC_SIZE;
+  std::vector<char> zeros(std::min<off_t>(length, 1 << 20));
+  for (off_t done = 0; done < length;) {
+    ssize_t count =
+        pwrite(log_fd_, zeros.data(),
+               std::min<off_t>(length - done, zeros.size()),
+               log_allocated_ + done);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    done += count;
+  }
+  if (fdatasync(log_fd_) != 0) {
+    return false;
+  }
+  log_allocated_ += length;
+  return true;
+}
+
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * The lowest free page id is reused, the file only grows when there is none.
+ * With a hint the page comes from the extent of the hint instead, pages of
+ * extents reserved for hints are skipped otherwise. The bitmap block is
+ * written before the page is, not here
+ * throw an exception if the tablespace of hint does not exist or is full
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage(ExtentHint *hint) {
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  page_id_t page_id = next_page_id_;
+  if (hint != nullptr) {
+    // pages of the extent taken meanwhile, e.g. a hint from before a restart
+    while (hint->next != INVALID_PAGE_ID && hint->next < hint->end &&
+           IsSet(bitmap_, hint->next)) {
+      ++hint->next;
+    }
+    if (hint->next == INVALID_PAGE_ID || hint->next >= hint->end) {
+      ReserveExtent(hint);
+    }
+    page_id = hint->next++;
+    // pages of a tablespace stay reserved, first fit never takes them
+    if (hint->tablespace_id == DB_TABLESPACE_ID) {
+      reserved_[page_id / 64] &= ~(uint64_t(1) << (page_id % 64));
+    } else {
+      --tablespaces_[hint->tablespace_id].num_free_pages;
+    }
+  } else {
+    for (size_t word = free_hint_ / 64;
+         word * 64 < static_cast<size_t>(next_page_id_); ++word) {
+      uint64_t used = bitmap_[word] | reserved_[word];
+      if (used != ~uint64_t(0)) {
+        page_id_t free_page_id = word * 64 + __builtin_ctzll(~used);
+        page_id = std::min(page_id, free_page_id);
+        break;
+      }
+    }
+    // extents reserved beyond the last allocated page
+    while (IsSet(reserved_, page_id)) {
+      ++page_id;
+    }
+    free_hint_ = page_id + 1;
+  }
+
+  GrowBitmap(page_id);
+  bitmap_[page_id / 64] |= uint64_t(1) << (page_id % 64);
+  next_page_id_ = std::max(next_page_id_, page_id + 1);
+  dirty_groups_.insert(page_id / PagesPerGroup());
+  bitmap_dirty_ = true;
+  // extents of tablespaces are preallocated in their files already
+  if (hint == nullptr || hint->tablespace_id == DB_TABLESPACE_ID) {
+    Preallocate(page_id, page_id);
+  }
+  return page_id;
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * The page id is free for AllocatePage again. Freeing a page which is not
+ * allocated does nothing
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  if (page_id < 0 || page_id >= next_page_id_ ||
+      (bitmap_[page_id / 64] & (uint64_t(1) << (page_id % 64))) == 0) {
+    LOG_DEBUG("page %d is not allocated", page_id);
+    return;
+  }
+  bitmap_[page_id / 64] &= ~(uint64_t(1) << (page_id % 64));
+  free_hint_ = std::min(free_hint_, page_id);
+  dirty_groups_.insert(page_id / PagesPerGroup());
+  bitmap_dirty_ = true;
+  tablespace_id_t tablespace_id = GetTablespaceId(page_id);
+  if (tablespace_id != DB_TABLESPACE_ID) {
+    ++tablespaces_[tablespace_id].num_free_pages;
+    return;
+  }
+  PunchFreeExtent(page_id);
+}
+
+/**
+ * The pages of the extent not allocated yet are free for first fit, the hint
+ * is empty afterwards. Pages of a tablespace stay in it
+ */
+void DiskManager::ReleaseExtent(ExtentHint *hint) {
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  hints_.erase(hint);
+  hint->disk_manager = nullptr;
+  if (hint->next == INVALID_PAGE_ID) {
+    return;
+  }
+  if (hint->tablespace_id == DB_TABLESPACE_ID) {
+    for (page_id_t page_id = hint->next; page_id < hint->end; ++page_id) {
+      reserved_[page_id / 64] &= ~(uint64_t(1) << (page_id % 64));
+    }
+    free_hint_ = std::min(free_hint_, hint->next);
+  }
+  hint->next = hint->end = INVALID_PAGE_ID;
+}
+
+ExtentHint::~ExtentHint() {
+  if (disk_manager != nullptr) {
+    disk_manager->ReleaseExtent(this);
+  }
+}
+
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  return page_id >= 0 && page_id < next_page_id_ && IsSet(bitmap_, page_id);
+}
+
+/**
+ * Create a tablespace: a file name.<i>.tbs with an empty extent map in each
+ * of dirs, recorded in the catalog
+ * @return: the id objects of the tablespace pass in their extent hints
+ */
+tablespace_id_t
+DiskManager::CreateTablespace(const std::string &name,
+                              const std::vector<std::string> &dirs) {
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  tablespace_id_t tablespace_id =
+      tablespaces_.empty() ? 1 : tablespaces_.rbegin()->first + 1;
+  std::vector<std::string> directories = dirs;
+  if (directories.empty()) {
+    std::string::size_type n = file_name_.rfind('/');
+    directories.push_back(n == std::string::npos ? "."
+                                                 : file_name_.substr(0, n));
+  }
+
+  Tablespace tablespace;
+  try {
+    for (size_t i = 0; i < directories.size(); ++i) {
+      tablespace.files.push_back(OpenTablespaceFile(
+          directories[i] + "/" + name + "." + std::to_string(i) + ".tbs",
+          tablespace_id, true));
+    }
+  } catch (...) {
+    for (auto &file : tablespace.files) {
+      close(file.fd);
+      unlink(file.path.c_str());
+    }
+    throw;
+  }
+  {
+    std::lock_guard<std::mutex> map_lock(map_latch_);
+    for (auto &file : tablespace.files) {
+      tablespace_fds_.push_back(file.fd);
+    }
+  }
+  tablespaces_[tablespace_id] = std::move(tablespace);
+  WriteCatalog();
+  return tablespace_id;
+}
+
+/**
+ * Drop a tablespace: it leaves the catalog first, then its pages are freed
+ * and its files unlinked. A crash in between leaks pages, it never hands out
+ * pages still in a tablespace
+ */
+bool DiskManager::DropTablespace(tablespace_id_t tablespace_id) {
+  std::vector<TablespaceFile> files;
+  {
+    std::lock_guard<std::mutex> lock(alloc_latch_);
+    auto it = tablespaces_.find(tablespace_id);
+    if (it == tablespaces_.end()) {
+      return false;
+    }
+    files = std::move(it->second.files);
+    tablespaces_.erase(it);
+    WriteCatalog();
+
+    std::vector<size_t> groups;
+    {
+      std::lock_guard<std::mutex> map_lock(map_latch_);
+      for (auto &file : files) {
+        for (size_t slot = 0; slot < file.num_extents; ++slot) {
+          page_id_t first = static_cast<page_id_t>(
+              (file.extent_map[slot] - 1) * ExtentPages());
+          extent_map_.erase(first / ExtentPages());
+          for (page_id_t page_id = first;
+               page_id < first + static_cast<page_id_t>(ExtentPages());
+               ++page_id) {
+            bitmap_[page_id / 64] &= ~(uint64_t(1) << (page_id % 64));
+            reserved_[page_id / 64] &= ~(uint64_t(1) << (page_id % 64));
+          }
+          free_hint_ = std::min(free_hint_, first);
+          groups.push_back(first / PagesPerGroup());
+        }
+        tablespace_fds_.erase(std::find(tablespace_fds_.begin(),
+                                        tablespace_fds_.end(), file.fd));
+      }
+      has_tablespaces_ = !extent_map_.empty();
+    }
+    dirty_groups_.insert(groups.begin(), groups.end());
+    bitmap_dirty_ = !dirty_groups_.empty();
+  }
+
+  for (auto &file : files) {
+    close(file.fd);
+    if (unlink(file.path.c_str()) != 0) {
+      LOG_DEBUG("can not unlink tablespace file %s", file.path.c_str());
+    }
+  }
+  return true;
+}
+
+tablespace_id_t DiskManager::GetTablespaceId(page_id_t page_id) {
+  if (!has_tablespaces_) {
+    return DB_TABLESPACE_ID;
+  }
+  std::lock_guard<std::mutex> lock(map_latch_);
+  auto it = extent_map_.find(page_id / static_cast<page_id_t>(ExtentPages()));
+  return it == extent_map_.end() ? DB_TABLESPACE_ID : it->second.tablespace_id;
+}
+
+std::vector<page_id_t>
+DiskManager::GetTablespacePages(tablespace_id_t tablespace_id) {
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  std::vector<page_id_t> page_ids;
+  auto it = tablespaces_.find(tablespace_id);
+  if (it == tablespaces_.end()) {
+    return page_ids;
+  }
+  for (auto &file : it->second.files) {
+    for (size_t slot = 0; slot < file.num_extents; ++slot) {
+      page_id_t first =
+          static_cast<page_id_t>((file.extent_map[slot] - 1) * ExtentPages());
+      for (page_id_t page_id = first;
+           page_id < first + static_cast<page_id_t>(ExtentPages());
+           ++page_id) {
+        if (IsSet(bitmap_, page_id)) {
+          page_ids.push_back(page_id);
+        }
+      }
+    }
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+  return page_ids;
+}
+
+/**
+ * Returns number of pages in the db file, pages allocated but never written
+ * are not counted
+ */
+int DiskManager::GetNumPages() {
+  size_t num_blocks = file_size_ / page_size_;
+  // neither the file header nor bitmap blocks are pages
+  if (num_blocks <= 2) {
+    return 0;
+  }
+  size_t group_blocks = PagesPerGroup() + 1;
+  size_t rest = (num_blocks - 1) % group_blocks;
+  return static_cast<int>((num_blocks - 1) / group_blocks * PagesPerGroup() +
+                          (rest > 0 ? rest - 1 : 0));
 }
 
 /**
@@ -183,12 +829,795 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
 /**
- * Private helper function to get disk file size
+ * Private helper function to set up the file header. An empty file is new,
+ * its header records page_size. Otherwise the page size recorded in the
+ * header is used
+ */
+void DiskManager::InitFileHeader(size_t page_size) {
+  if (!IsValidPageSize(page_size)) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "unsupported page size " + std::to_string(page_size));
+  }
+  if (file_size_ == 0) {
+    std::vector<char> block(page_size, 0);
+    FillFileHeader(block.data(), page_size);
+    WriteAt(db_fd_, block.data(), page_size, 0);
+    return;
+  }
+
+  // the smallest page size is enough to hold the header of any file
+  std::vector<char> block(MIN_PAGE_SIZE);
+  ReadAt(db_fd_, block.data(), MIN_PAGE_SIZE, 0);
+  FileHeader header;
+  memcpy(&header, block.data(), sizeof(header));
+  if (memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    file_name_ + " is not a database file" +
+                        (IsVersion0File(block.data(), file_size_)
+                             ? ", or a version 0 file to upgrade first"
+                             : ""));
+  }
+  if (header.version != FILE_VERSION) {
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    "unsupported file version " +
+                        std::to_string(header.version) + " of " + file_name_ +
+                        ", versions up to " + std::to_string(FILE_VERSION) +
+                        " are supported");
+  }
+  if (!IsValidPageSize(header.page_size)) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "corrupted file header, page size " +
+                        std::to_string(header.page_size));
+  }
+  page_size_ = header.page_size;
+}
+
+/**
+ * Rewrite a db file of version 0 (no header, PAGE_SIZE pages from offset 0)
+ * in the current format, page ids stay the same and every page of the old
+ * file is allocated. Version 0 files can not be told from other files
+ * reliably, so this is never done on open, the caller must know what the
+ * file is. The new file is written next to the old one and moved over it once
+ * durable, a crash during the upgrade leaves the old file
+ * throw an exception if the file does not look like a version 0 file or the
+ * new file can not be written
+ */
+void DiskManager::UpgradeVersion0File(const std::string &db_file) {
+  int old_fd = open(db_file.c_str(), O_RDONLY);
+  struct stat stat_buf;
+  std::vector<char> block(PAGE_SIZE, 0);
+  bool is_version0 =
+      old_fd != -1 && fstat(old_fd, &stat_buf) == 0 &&
+      pread(old_fd, block.data(), PAGE_SIZE, 0) == PAGE_SIZE &&
+      memcmp(block.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 &&
+      IsVersion0File(block.data(), stat_buf.st_size);
+  if (!is_version0) {
+    if (old_fd != -1) {
+      close(old_fd);
+    }
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    db_file + " is not a version 0 database file");
+  }
+  size_t num_pages = static_cast<size_t>(stat_buf.st_size) / PAGE_SIZE;
+  LOG_INFO("upgrading %s from file version 0 to %u, %zu pages",
+           db_file.c_str(), FILE_VERSION, num_pages);
+
+  // the layout of BitmapOffset and PageOffset for PAGE_SIZE pages
+  const size_t group_pages = PAGE_SIZE * 8;
+  auto bitmap_offset = [&](size_t group) {
+    return static_cast<off_t>(1 + group * (group_pages + 1)) * PAGE_SIZE;
+  };
+  std::string tmp_file = db_file + ".upgrade";
+  int fd = open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool ok = fd != -1;
+  auto write_blocks = [&](const char *data, size_t size, off_t offset) {
+    ok = ok && pwrite(fd, data, size, offset) == static_cast<ssize_t>(size);
+  };
+  memset(block.data(), 0, PAGE_SIZE);
+  FillFileHeader(block.data(), PAGE_SIZE);
+  write_blocks(block.data(), PAGE_SIZE, 0);
+  size_t num_groups = (num_pages + group_pages - 1) / group_pages;
+  for (size_t group = 0; group < num_groups; ++group) {
+    std::vector<uint64_t> bits(group_pages / 64, 0);
+    size_t in_group = std::min(group_pages, num_pages - group * group_pages);
+    for (size_t i = 0; i < in_group; ++i) {
+      bits[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    write_blocks(reinterpret_cast<const char *>(bits.data()), PAGE_SIZE,
+                 bitmap_offset(group));
+  }
+  // runs of pages never cross a group
+  const size_t run_pages = 64;
+  std::vector<char> pages(run_pages * PAGE_SIZE);
+  for (size_t page_id = 0; ok && page_id < num_pages; page_id += run_pages) {
+    size_t count = std::min(run_pages, num_pages - page_id);
+    ssize_t size = static_cast<ssize_t>(count * PAGE_SIZE);
+    ok = pread(old_fd, pages.data(), size,
+               static_cast<off_t>(page_id * PAGE_SIZE)) == size;
+    write_blocks(pages.data(), count * PAGE_SIZE,
+                 bitmap_offset(page_id / group_pages) +
+                     static_cast<off_t>(1 + page_id % group_pages) *
+                         PAGE_SIZE);
+  }
+  close(old_fd);
+  ok = ok && fsync(fd) == 0;
+  if (fd != -1 && close(fd) != 0) {
+    ok = false;
+  }
+  if (!ok || std::rename(tmp_file.c_str(), db_file.c_str()) != 0) {
+    remove(tmp_file.c_str());
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    "can not upgrade " + db_file + " from file version 0");
+  }
+  // the rename itself must survive a crash, the old file is gone
+  if (!SyncDirectory(db_file)) {
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    "can not sync the directory of " + db_file +
+                        " after the upgrade");
+  }
+}
+
+/**
+ * Private helper function to read the bitmap blocks of the file, a group
+ * whose bitmap block was never written has no page allocated
+ */
+void DiskManager::LoadBitmap() {
+  size_t num_blocks = file_size_ / page_size_;
+  size_t group_blocks = PagesPerGroup() + 1;
+  size_t num_groups =
+      num_blocks <= 1 ? 0 : (num_blocks - 1 + group_blocks - 1) / group_blocks;
+  size_t words_per_group = PagesPerGroup() / 64;
+  bitmap_.assign(num_groups * words_per_group, 0);
+  reserved_.assign(num_groups * words_per_group, 0);
+  for (size_t group = 0; group < num_groups; ++group) {
+    ReadAt(db_fd_,
+           reinterpret_cast<char *>(&bitmap_[group * words_per_group]),
+           page_size_, BitmapOffset(group));
+  }
+  next_page_id_ = 0;
+  for (size_t word = bitmap_.size(); word > 0; --word) {
+    if (bitmap_[word - 1] != 0) {
+      next_page_id_ = static_cast<page_id_t>(
+          (word - 1) * 64 + 64 - __builtin_clzll(bitmap_[word - 1]));
+      break;
+    }
+  }
+  free_hint_ = 0;
+}
+
+/**
+ * Private helper function to make room in the bitmaps for the group of
+ * page_id
+ */
+void DiskManager::GrowBitmap(page_id_t page_id) {
+  size_t words = (page_id / PagesPerGroup() + 1) * (PagesPerGroup() / 64);
+  if (bitmap_.size() < words) {
+    bitmap_.resize(words, 0);
+    reserved_.resize(words, 0);
+  }
+}
+
+/**
+ * Private helper function, true if none of num_pages pages from first is
+ * allocated or reserved, a word at a time where possible
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+bool DiskManager::IsRunFree(page_id_t first, size_t num_pages) const {
+  page_id_t end = first + static_cast<page_id_t>(num_pages);
+  for (page_id_t page_id = first; page_id < end;) {
+    size_t word = page_id / 64;
+    if (word >= bitmap_.size()) {
+      return true;
+    }
+    if (page_id % 64 == 0 && end - page_id >= 64) {
+      if ((bitmap_[word] | reserved_[word]) != 0) {
+        return false;
+      }
+      page_id += 64;
+    } else {
+      if (IsSet(bitmap_, page_id) || IsSet(reserved_, page_id)) {
+        return false;
+      }
+      ++page_id;
+    }
+  }
+  return true;
+}
+
+/**
+ * Private helper function to reserve the first aligned extent without an
+ * allocated or reserved page for hint, and preallocate all of it. Extents do
+ * not cross groups, their pages are contiguous in the file. An object in a
+ * tablespace takes the free pages of the tablespace first, a new extent is
+ * moved to a file of the tablespace
+ */
+void DiskManager::ReserveExtent(ExtentHint *hint) {
+  if (hint->tablespace_id != DB_TABLESPACE_ID) {
+    auto it = tablespaces_.find(hint->tablespace_id);
+    if (it == tablespaces_.end()) {
+      throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                      "no tablespace " + std::to_string(hint->tablespace_id));
+    }
+    if (it->second.num_free_pages > 0 && FindTablespaceExtent(hint)) {
+      return;
+    }
+  }
+  page_id_t num_pages = static_cast<page_id_t>(ExtentPages());
+  page_id_t first = 0;
+  while (!IsRunFree(first, num_pages)) {
+    first += num_pages;
+  }
+  GrowBitmap(first + num_pages - 1);
+  for (page_id_t page_id = first; page_id < first + num_pages; ++page_id) {
+    reserved_[page_id / 64] |= uint64_t(1) << (page_id % 64);
+  }
+  hint->next = first;
+  hint->end = first + num_pages;
+  hint->disk_manager = this;
+  hints_.insert(hint);
+  if (hint->tablespace_id != DB_TABLESPACE_ID) {
+    MapExtent(hint->tablespace_id, first);
+  } else {
+    Preallocate(first, hint->end - 1);
+  }
+}
+
+/**
+ * Private helper function to reserve the blocks of the file from first up to
+ * the end of last, EXTENT_SIZE at a time, so the file grows in contiguous
+ * chunks instead of a page per write. Chunks skipped before the one of first,
+ * e.g. of extents moved to a tablespace, stay holes. The file size still
+ * follows the writes
+ */
+void DiskManager::Preallocate(page_id_t first, page_id_t last) {
+  off_t end = PageOffset(last) + static_cast<off_t>(page_size_);
+  if (end <= db_allocated_) {
+    return;
+  }
+  off_t start = std::max<off_t>(
+      db_allocated_, PageOffset(first) / EXTENT_SIZE * EXTENT_SIZE);
+  off_t length = (end - start + EXTENT_SIZE - 1) / EXTENT_SIZE * EXTENT_SIZE;
+  if (fallocate(db_fd_, FALLOC_FL_KEEP_SIZE, start, length) != 0) {
+    LOG_DEBUG("can not preallocate the db file");
+  }
+  db_allocated_ = start + length;
+}
+
+/**
+ * Private helper function to point hint at the first free page of an extent
+ * of its tablespace, pages freed in a tablespace are reused before it grows
+ */
+bool DiskManager::FindTablespaceExtent(ExtentHint *hint) {
+  for (auto &file : tablespaces_[hint->tablespace_id].files) {
+    for (size_t slot = 0; slot < file.num_extents; ++slot) {
+      page_id_t first =
+          static_cast<page_id_t>((file.extent_map[slot] - 1) * ExtentPages());
+      page_id_t end = first + static_cast<page_id_t>(ExtentPages());
+      for (page_id_t page_id = first; page_id < end; ++page_id) {
+        if (!IsSet(bitmap_, page_id)) {
+          hint->next = page_id;
+          hint->end = end;
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Private helper function to move the extent from first_page_id, reserved
+ * already, into the next file of a tablespace round robin. The extent map of
+ * the file records it before any of its pages is written, its slot is
+ * preallocated
+ */
+void DiskManager::MapExtent(tablespace_id_t tablespace_id,
+                            page_id_t first_page_id) {
+  Tablespace &tablespace = tablespaces_[tablespace_id];
+  TablespaceFile &file =
+      tablespace.files[tablespace.num_extents % tablespace.files.size()];
+  size_t slot = file.num_extents;
+  size_t entries_per_block = page_size_ / sizeof(uint32_t);
+  size_t block = slot / entries_per_block;
+  // the extent map ends where the first extent slot starts
+  if (static_cast<off_t>((2 + block) * page_size_) > SlotOffset(0)) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "tablespace file " + file.path + " is full");
+  }
+  if (file.extent_map.size() <= slot) {
+    file.extent_map.resize(file.extent_map.size() + entries_per_block, 0);
+  }
+  file.extent_map[slot] =
+      static_cast<uint32_t>(first_page_id / ExtentPages() + 1);
+  WriteAt(file.fd,
+          reinterpret_cast<const char *>(
+              &file.extent_map[block * entries_per_block]),
+          page_size_, static_cast<off_t>((1 + block) * page_size_));
+  if (fallocate(file.fd, FALLOC_FL_KEEP_SIZE, SlotOffset(slot),
+                ExtentPages() * page_size_) != 0) {
+    LOG_DEBUG("can not preallocate tablespace file %s", file.path.c_str());
+  }
+  ++file.num_extents;
+  ++tablespace.num_extents;
+  tablespace.num_free_pages += ExtentPages();
+
+  std::lock_guard<std::mutex> lock(map_latch_);
+  extent_map_[first_page_id / static_cast<page_id_t>(ExtentPages())] =
+      ExtentLocation{tablespace_id, file.fd, SlotOffset(slot)};
+  has_tablespaces_ = true;
+}
+
+/**
+ * Private helper function to open a tablespace file and read its extent
+ * map, or create it with a header block and an empty map. Tablespace files
+ * follow the db file in direct I/O and sync mode
+ * throw an exception if the file can not be opened, exists already when
+ * created, or its header does not match the db file
+ */
+DiskManager::TablespaceFile
+DiskManager::OpenTablespaceFile(const std::string &path,
+                                tablespace_id_t tablespace_id, bool create) {
   struct stat stat_buf;
-  int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? stat_buf.st_size : -1;
+  if (create && stat(path.c_str(), &stat_buf) == 0) {
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE, path + " exists already");
+  }
+  int flags = O_RDWR | (create ? O_CREAT : 0) |
+              (data_sync_ == SyncMode::DSYNC ? O_DSYNC : 0);
+  int fd = -1;
+  if (direct_io_) {
+    fd = open(path.c_str(), flags | O_DIRECT, 0644);
+  }
+  if (fd == -1) {
+    fd = open(path.c_str(), flags, 0644);
+  }
+  if (fd == -1) {
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    "can not open tablespace file " + path);
+  }
+  TablespaceFile file;
+  file.path = path;
+  file.fd = fd;
+
+  std::vector<char> block(page_size_, 0);
+  TablespaceHeader header;
+  if (create) {
+    memcpy(header.magic, TABLESPACE_MAGIC, sizeof(TABLESPACE_MAGIC));
+    header.version = TABLESPACE_VERSION;
+    header.page_size = static_cast<uint32_t>(page_size_);
+    header.tablespace_id = tablespace_id;
+    memcpy(block.data(), &header, sizeof(header));
+    WriteAt(fd, block.data(), page_size_, 0);
+    return file;
+  }
+
+  ReadAt(fd, block.data(), page_size_, 0);
+  memcpy(&header, block.data(), sizeof(header));
+  if (memcmp(header.magic, TABLESPACE_MAGIC, sizeof(TABLESPACE_MAGIC)) != 0 ||
+      header.version != TABLESPACE_VERSION ||
+      header.page_size != page_size_ ||
+      header.tablespace_id != tablespace_id) {
+    close(fd);
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    path + " is not a tablespace file of " + file_name_);
+  }
+  // a block of the map at a time, up to the first empty entry
+  size_t entries_per_block = page_size_ / sizeof(uint32_t);
+  for (off_t offset = page_size_; offset < SlotOffset(0);
+       offset += page_size_) {
+    file.extent_map.resize(file.extent_map.size() + entries_per_block);
+    ReadAt(fd,
+           reinterpret_cast<char *>(
+               &file.extent_map[file.extent_map.size() - entries_per_block]),
+           page_size_, offset);
+    while (file.num_extents < file.extent_map.size() &&
+           file.extent_map[file.num_extents] != 0) {
+      ++file.num_extents;
+    }
+    if (file.num_extents < file.extent_map.size()) {
+      break;
+    }
+  }
+  return file;
+}
+
+/**
+ * Private helper function to open the files listed in the catalog, one line
+ * of tablespace id and path per file, and map their extents. Pages of
+ * tablespaces are reserved, first fit never takes them
+ */
+void DiskManager::LoadTablespaces() {
+  std::ifstream in(catalog_name_);
+  tablespace_id_t tablespace_id;
+  std::string path;
+  while (in >> tablespace_id && in.get() == ' ' && std::getline(in, path)) {
+    Tablespace &tablespace = tablespaces_[tablespace_id];
+    tablespace.files.push_back(
+        OpenTablespaceFile(path, tablespace_id, false));
+    TablespaceFile &file = tablespace.files.back();
+    tablespace_fds_.push_back(file.fd);
+    for (size_t slot = 0; slot < file.num_extents; ++slot) {
+      page_id_t first =
+          static_cast<page_id_t>((file.extent_map[slot] - 1) * ExtentPages());
+      page_id_t end = first + static_cast<page_id_t>(ExtentPages());
+      GrowBitmap(end - 1);
+      for (page_id_t page_id = first; page_id < end; ++page_id) {
+        reserved_[page_id / 64] |= uint64_t(1) << (page_id % 64);
+        if (!IsSet(bitmap_, page_id)) {
+          ++tablespace.num_free_pages;
+        }
+      }
+      extent_map_[first / static_cast<page_id_t>(ExtentPages())] =
+          ExtentLocation{tablespace_id, file.fd, SlotOffset(slot)};
+    }
+    tablespace.num_extents += file.num_extents;
+  }
+  has_tablespaces_ = !extent_map_.empty();
+}
+
+/**
+ * Private helper function to write the catalog to a temporary file, make it
+ * durable and move it over the old one
+ */
+void DiskManager::WriteCatalog() {
+  std::string catalog;
+  for (auto &entry : tablespaces_) {
+    for (auto &file : entry.second.files) {
+      catalog += std::to_string(entry.first) + " " + file.path + "\n";
+    }
+  }
+  std::string tmp_file = catalog_name_ + ".tmp";
+  int fd = open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1 ||
+      write(fd, catalog.data(), catalog.size()) !=
+          static_cast<ssize_t>(catalog.size()) ||
+      fsync(fd) != 0 || close(fd) != 0 ||
+      std::rename(tmp_file.c_str(), catalog_name_.c_str()) != 0) {
+    LOG_DEBUG("can not write the tablespace catalog");
+  }
+}
+
+void DiskManager::CloseTablespaces() {
+  for (auto &entry : tablespaces_) {
+    for (auto &file : entry.second.files) {
+      close(file.fd);
+    }
+  }
+  tablespaces_.clear();
+}
+
+/**
+ * Private helper function to write the bitmap block of a group
+ */
+bool DiskManager::WriteBitmap(size_t group) {
+  return WriteAt(db_fd_,
+          reinterpret_cast<const char *>(
+              &bitmap_[group * (PagesPerGroup() / 64)]),
+          page_size_, BitmapOffset(group));
+}
+
+/**
+ * Private helper function to write the bitmap blocks changed since the last
+ * call, once for any number of allocations and frees in a group
+ */
+bool DiskManager::FlushBitmap() {
+  if (!bitmap_dirty_) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(alloc_latch_);
+  for (auto it = dirty_groups_.begin(); it != dirty_groups_.end();) {
+    if (WriteBitmap(*it)) {
+      it = dirty_groups_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  bitmap_dirty_ = !dirty_groups_.empty();
+  return !bitmap_dirty_;
+}
+
+/**
+ * Private helper function to give the space of the aligned run of
+ * FREE_EXTENT_PAGES pages around page_id back to the file system once all of
+ * them are free and unreserved. Reading them returns zeros afterwards
+ */
+void DiskManager::PunchFreeExtent(page_id_t page_id) {
+  size_t first = page_id / FREE_EXTENT_PAGES * FREE_EXTENT_PAGES;
+  // an extent reserved for an object keeps its blocks
+  if (!IsRunFree(static_cast<page_id_t>(first), FREE_EXTENT_PAGES)) {
+    return;
+  }
+  if (fallocate(db_fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                PageOffset(static_cast<page_id_t>(first)),
+                FREE_EXTENT_PAGES * page_size_) != 0) {
+    LOG_DEBUG("can not punch a hole into the db file");
+  }
+}
+
+/**
+ * Private helper function to write size bytes at offset of the db file or a
+ * tablespace file, the cached db file size follows writes beyond its end
+ */
+bool DiskManager::WriteAt(int fd, const char *data, size_t size,
+                          off_t offset) {
+  std::unique_ptr<AlignedBuffer> buffer;
+  if (direct_io_) {
+    buffer.reset(new AlignedBuffer(data, size));
+    if (buffer->Get() != data) {
+      memcpy(buffer->Get(), data, size);
+    }
+    data = buffer->Get();
+  }
+  size_t done = 0;
+  while (done < size) {
+    ssize_t count = pwrite(fd, data + done, size - done,
+                           offset + static_cast<off_t>(done));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      return false;
+    }
+    done += count;
+  }
+  if (fd == db_fd_) {
+    GrowFileSize(offset + static_cast<off_t>(size));
+  }
+  return AfterWrite(fd, data_sync_, data_unsynced_);
+}
+
+/**
+ * Private helper function to read size bytes at offset of the db file or a
+ * tablespace file
+ */
+void DiskManager::ReadAt(int fd, char *data, size_t size, off_t offset) {
+  std::unique_ptr<AlignedBuffer> buffer;
+  char *target = data;
+  if (direct_io_) {
+    buffer.reset(new AlignedBuffer(data, size));
+    target = buffer->Get();
+  }
+  size_t done = 0;
+  while (done < size) {
+    ssize_t count = pread(fd, target + done, size - done,
+                          offset + static_cast<off_t>(done));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      LOG_DEBUG("I/O error while reading");
+    }
+    if (count <= 0) {
+      break;
+    }
+    done += count;
+  }
+  if (target != data) {
+    memcpy(data, target, done);
+  }
+  // file ends before reading size bytes
+  memset(data + done, 0, size - done);
+}
+
+/**
+ * Private helper function for vectored I/O of num_pages pages at offset of
+ * fd, restarted on EINTR and continued after a short transfer. A read beyond
+ * the end of file fills the rest of the pages with zeros
+ */
+bool DiskManager::VectorAt(bool write, int fd, char *const *pages_data,
+                           size_t num_pages, off_t offset) {
+  std::vector<iovec> iov(num_pages);
+  for (size_t i = 0; i < num_pages; ++i) {
+    iov[i].iov_base = pages_data[i];
+    iov[i].iov_len = page_size_;
+  }
+  size_t size = num_pages * page_size_;
+  size_t done = 0, next = 0;
+  ssize_t count = 0;
+  while (next < num_pages) {
+    count = write ? pwritev(fd, &iov[next], num_pages - next,
+                            offset + static_cast<off_t>(done))
+                  : preadv(fd, &iov[next], num_pages - next,
+                           offset + static_cast<off_t>(done));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    done += count;
+    // skip the pages done, go on inside a page done in part
+    for (; next < num_pages && static_cast<size_t>(count) >= iov[next].iov_len;
+         ++next) {
+      count -= iov[next].iov_len;
+    }
+    if (next < num_pages) {
+      iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + count;
+      iov[next].iov_len -= count;
+    }
+  }
+
+  if (write) {
+    if (done != size) {
+      LOG_DEBUG("I/O error while writing");
+      return false;
+    }
+    if (fd == db_fd_) {
+      GrowFileSize(offset + static_cast<off_t>(size));
+    }
+    return AfterWrite(fd, data_sync_, data_unsynced_);
+  }
+  if (count < 0) {
+    LOG_DEBUG("I/O error while reading");
+  }
+  // file ends before reading size bytes
+  for (; next < num_pages; ++next) {
+    memset(iov[next].iov_base, 0, iov[next].iov_len);
+  }
+  return count >= 0;
+}
+
+/**
+ * Private helper function to move a run of pages in as few vectored requests
+ * as the layout allows: a bitmap block sits between groups, extents may live
+ * in tablespace files. With O_DIRECT, pages not in aligned buffers go one at
+ * a time through a bounce buffer
+ */
+bool DiskManager::PagesAt(bool write, page_id_t page_id, size_t num_pages,
+                          char *const *pages_data) {
+  bool ok = true;
+  if (direct_io_) {
+    bool aligned = true;
+    for (size_t i = 0; i < num_pages && aligned; ++i) {
+      aligned = reinterpret_cast<uintptr_t>(pages_data[i]) % MIN_PAGE_SIZE == 0;
+    }
+    if (!aligned) {
+      for (size_t i = 0; i < num_pages; ++i) {
+        int fd;
+        off_t offset;
+        Locate(page_id + static_cast<page_id_t>(i), 1, fd, offset);
+        if (write) {
+          ok = WriteAt(fd, pages_data[i], page_size_, offset) && ok;
+        } else {
+          ReadAt(fd, pages_data[i], page_size_, offset);
+        }
+      }
+      return ok;
+    }
+  }
+  while (num_pages > 0) {
+    int fd;
+    off_t offset;
+    size_t count = std::min(Locate(page_id, num_pages, fd, offset),
+                            static_cast<size_t>(IOV_MAX));
+    ok = VectorAt(write, fd, pages_data, count, offset) && ok;
+    page_id += count;
+    pages_data += count;
+    num_pages -= count;
+  }
+  return ok;
+}
+
+/**
+ * Private helper function to queue an I/O of size bytes at offset of fd.
+ * Like ReadAt and WriteAt, unaligned buffers go through a bounce buffer with
+ * O_DIRECT, which lives until the I/O is done
+ */
+void DiskManager::SubmitAt(bool write, int fd, char *data, size_t size,
+                           off_t offset, std::function<void(bool)> callback) {
+  char *bounce = nullptr;
+  if (direct_io_ && reinterpret_cast<uintptr_t>(data) % MIN_PAGE_SIZE != 0) {
+    bounce = static_cast<char *>(aligned_alloc(MIN_PAGE_SIZE, size));
+    if (write) {
+      memcpy(bounce, data, size);
+    }
+  }
+  IORequest request{write, fd, bounce != nullptr ? bounce : data, size,
+                    offset, nullptr};
+  request.callback = [this, write, fd, data, size, offset, bounce,
+                      callback](ssize_t count) {
+    bool ok = count >= 0;
+    if (write && count == static_cast<ssize_t>(size)) {
+      if (fd == db_fd_) {
+        GrowFileSize(offset + static_cast<off_t>(size));
+      }
+      ok = AfterWrite(fd, data_sync_, data_unsynced_);
+    } else if (write) {
+      ok = false;
+      LOG_DEBUG("I/O error while writing");
+    } else {
+      if (count < 0) {
+        LOG_DEBUG("I/O error while reading");
+      }
+      size_t read_count = count < 0 ? 0 : count;
+      if (bounce != nullptr) {
+        memcpy(data, bounce, read_count);
+      }
+      // file ends before reading size bytes
+      memset(data + read_count, 0, size - read_count);
+    }
+    free(bounce);
+    // a read beyond the end of file is not an error
+    callback(ok);
+  };
+  GetIOEngine()->Submit(std::move(request));
+}
+
+/**
+ * Private helper function to find where page_id lives. Runs stop at the end
+ * of a group, at the end of an extent of a tablespace, and in the db file
+ * before the next extent of a tablespace
+ */
+size_t DiskManager::Locate(page_id_t page_id, size_t num_pages, int &fd,
+                           off_t &offset) {
+  size_t count =
+      std::min(num_pages, PagesPerGroup() - page_id % PagesPerGroup());
+  fd = db_fd_;
+  offset = PageOffset(page_id);
+  if (!has_tablespaces_) {
+    return count;
+  }
+  std::lock_guard<std::mutex> lock(map_latch_);
+  page_id_t extent = page_id / static_cast<page_id_t>(ExtentPages());
+  size_t in_extent = ExtentPages() - page_id % ExtentPages();
+  auto it = extent_map_.find(extent);
+  if (it != extent_map_.end()) {
+    fd = it->second.fd;
+    offset = it->second.offset +
+             static_cast<off_t>(page_id % ExtentPages() * page_size_);
+    return std::min(count, in_extent);
+  }
+  while (in_extent < count && extent_map_.count(++extent) == 0) {
+    in_extent += ExtentPages();
+  }
+  return std::min(count, in_extent);
+}
+
+void DiskManager::GrowFileSize(off_t end) {
+  off_t file_size = file_size_;
+  while (file_size < end && !file_size_.compare_exchange_weak(file_size, end)) {
+  }
+}
+
+/**
+ * Private helper function to sync fd after a write if its mode says so, or
+ * leave it to the sync thread
+ * @return: false if the sync failed. It is not retried, the kernel may have
+ * dropped the dirty pages already
+ */
+bool DiskManager::AfterWrite(int fd, SyncMode mode,
+                             std::atomic<bool> &unsynced) {
+  if (mode == SyncMode::ALWAYS) {
+    if (fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing");
+      return false;
+    }
+  } else if (mode == SyncMode::PERIODIC) {
+    unsynced = true;
+  }
+  return true;
+}
+
+bool DiskManager::SyncDataFiles() {
+  bool ok = true;
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+    ok = false;
+  }
+  std::lock_guard<std::mutex> lock(map_latch_);
+  for (int fd : tablespace_fds_) {
+    if (fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing a tablespace file");
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+IOEngine *DiskManager::GetIOEngine() {
+  std::call_once(io_engine_once_, [this]() {
+    io_engine_ = IOEngine::Create(io_engine_type_, IO_QUEUE_DEPTH);
+  });
+  return io_engine_;
 }
 
 } // namespace cmudb
@@ -0,0 +1,340 @@
+/**
+ * io_engine.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "common/logger.h"
+#include "disk/io_engine.h"
+
+namespace cmudb {
+
+namespace {
+
+// the whole request, restarted on EINTR and continued after a short write
+ssize_t DoIO(const IORequest &request) {
+  size_t done = 0;
+  while (done < request.size) {
+    ssize_t count =
+        request.write
+            ? pwrite(request.fd, request.data + done, request.size - done,
+                     request.offset + done)
+            : pread(request.fd, request.data + done, request.size - done,
+                    request.offset + done);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      return -errno;
+    }
+    // end of file
+    if (count == 0) {
+      break;
+    }
+    done += count;
+  }
+  return done;
+}
+
+class ThreadPoolEngine : public IOEngine {
+public:
+  explicit ThreadPoolEngine(size_t num_threads)
+      : queue_depth_(num_threads), stopping_(false) {
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this]() { Work(); });
+    }
+  }
+
+  ~ThreadPoolEngine() {
+    {
+      std::lock_guard<std::mutex> lock(latch_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Submit(IORequest request) override {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this]() { return queue_.size() < queue_depth_; });
+    queue_.push_back(std::move(request));
+    cv_.notify_all();
+  }
+
+  const char *GetName() const override { return "threads"; }
+
+private:
+  // requests left when stopping are still done
+  void Work() {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (true) {
+      cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        break;
+      }
+      IORequest request = std::move(queue_.front());
+      queue_.pop_front();
+      cv_.notify_all();
+
+      lock.unlock();
+      request.callback(DoIO(request));
+      lock.lock();
+    }
+  }
+
+  const size_t queue_depth_;
+  bool stopping_;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::deque<IORequest> queue_;
+  std::vector<std::thread> threads_;
+};
+
+/*
+ * Vectored opcodes, supported since the first kernel with io_uring. Requests
+ * live on the heap until completion, the completion entry carries their
+ * address. user_data 0 is the wake up of a stopping completion thread
+ */
+class UringEngine : public IOEngine {
+public:
+  UringEngine()
+      : ring_fd_(-1), sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED),
+        sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)), sq_ring_size_(0),
+        cq_ring_size_(0), sqes_size_(0), queue_depth_(0), in_flight_(0),
+        stopping_(false) {}
+
+  ~UringEngine() {
+    if (completion_thread_.joinable()) {
+      {
+        std::unique_lock<std::mutex> lock(latch_);
+        cv_.wait(lock, [this]() { return in_flight_ == 0; });
+        stopping_ = true;
+        io_uring_sqe *sqe = NextEntry();
+        sqe->opcode = IORING_OP_NOP;
+        Enter();
+      }
+      completion_thread_.join();
+    }
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ != -1) {
+      close(ring_fd_);
+    }
+  }
+
+  // set up and map the rings, false if the kernel does not let us
+  bool Init(size_t queue_depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (ring_fd_ < 0) {
+      ring_fd_ = -1;
+      return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_,
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                  IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      return false;
+    }
+
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    // the completion queue is twice as large, it never overflows
+    queue_depth_ = params.sq_entries;
+    completion_thread_ = std::thread([this]() { Reap(); });
+    return true;
+  }
+
+  void Submit(IORequest request) override {
+    auto *pending = new Pending{std::move(request), {}};
+    pending->iov.iov_base = pending->request.data;
+    pending->iov.iov_len = pending->request.size;
+
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this]() { return in_flight_ < queue_depth_; });
+    io_uring_sqe *sqe = NextEntry();
+    sqe->opcode = pending->request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = pending->request.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&pending->iov);
+    sqe->len = 1;
+    sqe->off = pending->request.offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(pending);
+    int error = Enter();
+    if (error != 0) {
+      // the kernel did not take the entry, take it back
+      __atomic_store_n(sq_tail_, *sq_tail_ - 1, __ATOMIC_RELEASE);
+      lock.unlock();
+      pending->request.callback(-error);
+      delete pending;
+      return;
+    }
+    ++in_flight_;
+  }
+
+  const char *GetName() const override { return "io_uring"; }
+
+private:
+  struct Pending {
+    IORequest request;
+    iovec iov;
+  };
+
+  // the next free submission entry, cleared
+  // should be called when holding the latch
+  io_uring_sqe *NextEntry() {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+  }
+
+  // hand the entry filled last to the kernel, return 0 or errno
+  // should be called when holding the latch
+  int Enter() {
+    while (true) {
+      int ret = syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+      if (ret == 1) {
+        return 0;
+      }
+      if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        return errno;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // completion thread: run the callbacks of completed requests, wait in the
+  // kernel while there are none
+  void Reap() {
+    while (true) {
+      unsigned head = *cq_head_;
+      if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        {
+          std::lock_guard<std::mutex> lock(latch_);
+          if (stopping_ && in_flight_ == 0) {
+            break;
+          }
+        }
+        syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                nullptr, 0);
+        continue;
+      }
+      io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+      auto *pending = reinterpret_cast<Pending *>(cqe->user_data);
+      ssize_t result = cqe->res;
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      if (pending == nullptr) {
+        continue;
+      }
+
+      // finish a short transfer, io_uring does not promise whole requests
+      if (result >= 0 && static_cast<size_t>(result) < pending->request.size) {
+        IORequest rest = pending->request;
+        rest.data += result;
+        rest.size -= result;
+        rest.offset += result;
+        ssize_t count = DoIO(rest);
+        result = count < 0 ? count : result + count;
+      }
+      pending->request.callback(result);
+      delete pending;
+      {
+        std::lock_guard<std::mutex> lock(latch_);
+        --in_flight_;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  int ring_fd_;
+  void *sq_ring_;
+  void *cq_ring_;
+  io_uring_sqe *sqes_;
+  size_t sq_ring_size_;
+  size_t cq_ring_size_;
+  size_t sqes_size_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe *cqes_;
+
+  size_t queue_depth_;
+  size_t in_flight_;
+  bool stopping_;
+  std::mutex latch_;              // protect the submission queue and counts
+  std::condition_variable cv_;
+  std::thread completion_thread_;
+};
+
+} // namespace
+
+IOEngine *IOEngine::Create(IOEngineType type, size_t queue_depth) {
+  if (type == IOEngineType::URING) {
+    auto *engine = new UringEngine();
+    if (engine->Init(queue_depth)) {
+      return engine;
+    }
+    LOG_DEBUG("io_uring not available, use a thread pool");
+    delete engine;
+  }
+  return new ThreadPoolEngine(queue_depth);
+}
+
+} // namespace cmudb
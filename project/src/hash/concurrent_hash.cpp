@@ -0,0 +1,308 @@
+/**
+ * concurrent_hash.cpp
+ */
+#include <cassert>
+#include <functional>
+
+#include "hash/concurrent_hash.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+ConcurrentHash<K, V>::Table::Table(size_t num_groups)
+    : mask(num_groups - 1), groups(new Group[num_groups]) {
+  assert((num_groups & mask) == 0);
+  for (size_t g = 0; g < num_groups; ++g) {
+    groups[g].seq.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      groups[g].full[i].store(false, std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename K, typename V>
+ConcurrentHash<K, V>::ConcurrentHash(size_t capacity)
+    : table_(nullptr), shift_seq_(0), size_(0) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Rehash(capacity);
+}
+
+template <typename K, typename V>
+ConcurrentHash<K, V>::~ConcurrentHash() = default;
+
+/*
+ * Lookup function to find value associate with input key, without locking.
+ * A key inserted or removed concurrently may or may not be seen, a key
+ * present during the whole call always is: a miss is only reported if no
+ * entry was shifted back meanwhile
+ */
+template <typename K, typename V>
+bool ConcurrentHash<K, V>::Find(const K &key, V &value) {
+  while (true) {
+    uint32_t shift_seq = shift_seq_.load(std::memory_order_acquire);
+    Table *table = table_.load(std::memory_order_acquire);
+    size_t g = HomeGroup(table, key);
+    for (size_t n = 0; n <= table->mask; ++n, g = (g + 1) & table->mask) {
+      bool has_empty;
+      if (ReadGroup(table->groups[g], key, value, has_empty)) {
+        return true;
+      }
+      if (has_empty) {
+        break;
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((shift_seq & 1) == 0 &&
+        shift_seq_.load(std::memory_order_relaxed) == shift_seq) {
+      return false;
+    }
+  }
+}
+
+/*
+ * delete <key,value> entry in hash table
+ */
+template <typename K, typename V>
+bool ConcurrentHash<K, V>::Remove(const K &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Table *table = table_.load(std::memory_order_relaxed);
+  size_t g = HomeGroup(table, key);
+  for (size_t n = 0; n <= table->mask; ++n, g = (g + 1) & table->mask) {
+    Group &group = table->groups[g];
+    bool has_empty = false;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      if (!group.full[i].load(std::memory_order_relaxed)) {
+        has_empty = true;
+      } else if (group.keys[i].load(std::memory_order_relaxed) == key) {
+        // only a full group can have let probes pass
+        bool was_full = true;
+        for (size_t j = 0; j < GROUP_SIZE; ++j) {
+          was_full = was_full && group.full[j].load(std::memory_order_relaxed);
+        }
+        if (was_full) {
+          ShiftBack(table, g, i);
+        } else {
+          WriteBegin(group.seq);
+          group.full[i].store(false, std::memory_order_relaxed);
+          WriteEnd(group.seq);
+        }
+        --size_;
+        return true;
+      }
+    }
+    if (has_empty) {
+      break;
+    }
+  }
+  return false;
+}
+
+/*
+ * insert <key,value> entry in hash table, overwrite the value if key is
+ * already present
+ */
+template <typename K, typename V>
+void ConcurrentHash<K, V>::Insert(const K &key, const V &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Table *table = table_.load(std::memory_order_relaxed);
+  if ((size_ + 1) * 2 > (table->mask + 1) * GROUP_SIZE) {
+    Rehash(size_ + 1);
+    table = table_.load(std::memory_order_relaxed);
+  }
+
+  size_t g = HomeGroup(table, key);
+  for (size_t n = 0; n <= table->mask; ++n, g = (g + 1) & table->mask) {
+    Group &group = table->groups[g];
+    size_t empty_slot = GROUP_SIZE;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      if (!group.full[i].load(std::memory_order_relaxed)) {
+        empty_slot = empty_slot == GROUP_SIZE ? i : empty_slot;
+      } else if (group.keys[i].load(std::memory_order_relaxed) == key) {
+        WriteBegin(group.seq);
+        group.values[i].store(value, std::memory_order_relaxed);
+        WriteEnd(group.seq);
+        return;
+      }
+    }
+    // the probe ends here, key is not present
+    if (empty_slot != GROUP_SIZE) {
+      WriteBegin(group.seq);
+      group.keys[empty_slot].store(key, std::memory_order_relaxed);
+      group.values[empty_slot].store(value, std::memory_order_relaxed);
+      group.full[empty_slot].store(true, std::memory_order_relaxed);
+      WriteEnd(group.seq);
+      ++size_;
+      return;
+    }
+  }
+  // the table is at most half full
+  assert(false);
+}
+
+template <typename K, typename V>
+size_t ConcurrentHash<K, V>::GetNumSlots() const {
+  return (table_.load(std::memory_order_acquire)->mask + 1) * GROUP_SIZE;
+}
+
+/*
+ * helper function to calculate the home group of input key. Fibonacci
+ * hashing spreads consecutive keys like page ids over the table
+ */
+template <typename K, typename V>
+size_t ConcurrentHash<K, V>::HomeGroup(const Table *table,
+                                       const K &key) const {
+  uint64_t hash = std::hash<K>()(key) * 0x9E3779B97F4A7C15ULL;
+  return static_cast<size_t>(hash >> 32) & table->mask;
+}
+
+/*
+ * Seqlock read side: copy what is needed from the group, then check that no
+ * writer touched it in between, retry otherwise
+ */
+template <typename K, typename V>
+bool ConcurrentHash<K, V>::ReadGroup(Group &group, const K &key, V &value,
+                                     bool &has_empty) const {
+  while (true) {
+    uint32_t seq = group.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+    bool found = false;
+    has_empty = false;
+    V result = V();
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      if (!group.full[i].load(std::memory_order_relaxed)) {
+        has_empty = true;
+      } else if (!found &&
+                 group.keys[i].load(std::memory_order_relaxed) == key) {
+        result = group.values[i].load(std::memory_order_relaxed);
+        found = true;
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (group.seq.load(std::memory_order_relaxed) == seq) {
+      if (found) {
+        value = result;
+      }
+      return found;
+    }
+  }
+}
+
+/*
+ * Seqlock write side, should be called when holding the mutex
+ */
+template <typename K, typename V>
+void ConcurrentHash<K, V>::WriteBegin(std::atomic<uint32_t> &seq) {
+  seq.store(seq.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+template <typename K, typename V>
+void ConcurrentHash<K, V>::WriteEnd(std::atomic<uint32_t> &seq) {
+  seq.store(seq.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+}
+
+/*
+ * Remove the entry in slot i of the full group g. Its slot becomes a hole:
+ * an entry of a later group whose probe passed the hole moves into it and
+ * leaves a hole behind, until a group that already ended probes is reached,
+ * where the hole is simply emptied.
+ * should be called when holding the mutex
+ */
+template <typename K, typename V>
+void ConcurrentHash<K, V>::ShiftBack(Table *table, size_t g, size_t i) {
+  WriteBegin(shift_seq_);
+  size_t hole_group = g, hole_slot = i;
+  bool hole_ends_probe = false;
+  for (size_t h = (g + 1) & table->mask; !hole_ends_probe && h != g;
+       h = (h + 1) & table->mask) {
+    Group &group = table->groups[h];
+    size_t moved = GROUP_SIZE;
+    bool has_empty = false;
+    for (size_t j = 0; j < GROUP_SIZE; ++j) {
+      if (!group.full[j].load(std::memory_order_relaxed)) {
+        has_empty = true;
+        continue;
+      }
+      // movable if hole_group lies on the probe path from home to h
+      size_t home =
+          HomeGroup(table, group.keys[j].load(std::memory_order_relaxed));
+      if (moved == GROUP_SIZE &&
+          ((h - home) & table->mask) >= ((h - hole_group) & table->mask)) {
+        moved = j;
+      }
+    }
+    if (moved != GROUP_SIZE) {
+      Group &to = table->groups[hole_group];
+      WriteBegin(to.seq);
+      to.keys[hole_slot].store(group.keys[moved].load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+      to.values[hole_slot].store(
+          group.values[moved].load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+      WriteEnd(to.seq);
+      hole_group = h;
+      hole_slot = moved;
+    }
+    hole_ends_probe = has_empty;
+  }
+
+  Group &group = table->groups[hole_group];
+  WriteBegin(group.seq);
+  group.full[hole_slot].store(false, std::memory_order_relaxed);
+  WriteEnd(group.seq);
+  WriteEnd(shift_seq_);
+}
+
+/*
+ * Move every entry into a new array with room for twice capacity entries and
+ * publish it. The new array is private until published, so it is filled
+ * without sequence locks; readers still probing the old one see it unchanged.
+ * should be called when holding the mutex
+ */
+template <typename K, typename V>
+void ConcurrentHash<K, V>::Rehash(size_t capacity) {
+  size_t num_groups = 1;
+  while (num_groups * GROUP_SIZE < capacity * 2) {
+    num_groups <<= 1;
+  }
+  std::unique_ptr<Table> table(new Table(num_groups));
+
+  Table *old_table = table_.load(std::memory_order_relaxed);
+  for (size_t g = 0; old_table != nullptr && g <= old_table->mask; ++g) {
+    Group &group = old_table->groups[g];
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      if (!group.full[i].load(std::memory_order_relaxed)) {
+        continue;
+      }
+      K key = group.keys[i].load(std::memory_order_relaxed);
+      size_t h = HomeGroup(table.get(), key);
+      size_t j = 0;
+      while (table->groups[h].full[j].load(std::memory_order_relaxed)) {
+        if (++j == GROUP_SIZE) {
+          h = (h + 1) & table->mask;
+          j = 0;
+        }
+      }
+      Group &to = table->groups[h];
+      to.keys[j].store(key, std::memory_order_relaxed);
+      to.values[j].store(group.values[i].load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+      to.full[j].store(true, std::memory_order_relaxed);
+    }
+  }
+
+  table_.store(table.get(), std::memory_order_release);
+  tables_.push_back(std::move(table));
+}
+
+template class ConcurrentHash<page_id_t, Page *>;
+// test purpose
+template class ConcurrentHash<int, int>;
+} // namespace cmudb
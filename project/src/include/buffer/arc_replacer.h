@@ -0,0 +1,101 @@
+/**
+ * arc_replacer.h
+ *
+ * Functionality: Adaptive Replacement Cache. Resident frames are kept in two
+ * LRU lists, T1 for pages seen once recently and T2 for pages seen at least
+ * twice. Page ids of pages evicted from them are remembered in the ghost
+ * lists B1 and B2. A page missed by the pool but found in B1 means T1 was
+ * too small, so the target size p of T1 grows; a hit in B2 shrinks it.
+ * Victim evicts from T1 while it is larger than p, otherwise from T2.
+ *
+ * Ghosts are keyed by page id, so the replacer learns which page a frame
+ * holds from RecordAccess, which the buffer pool calls on every fetch. The
+ * buffer pool asks for victims with VictimFor, so a ghost hit adapts p
+ * before the victim is chosen, and a B2 hit with |T1| == p evicts from T1 as
+ * ARC's REPLACE does. Misses served from the free list adapt p in
+ * RecordAccess.
+ *
+ * A page accessed again less than `correlated_period` ticks after its last
+ * access (e.g. a table iterator fetching the page once per tuple) stays in T1,
+ * otherwise every scanned page would be promoted to T2.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ARCReplacer : public Replacer<T> {
+  struct entry {
+    page_id_t page_id = INVALID_PAGE_ID;
+    bool in_t2 = false;
+    bool evictable = false;
+    size_t last_access = 0;
+    typename std::list<T>::iterator pos;
+  };
+  struct ghost {
+    bool in_b2;
+    std::list<page_id_t>::iterator pos;
+  };
+
+public:
+  explicit ARCReplacer(size_t capacity,
+                       size_t correlated_period = CORRELATED_PERIOD);
+
+  ~ARCReplacer();
+
+  // disable copy
+  ARCReplacer(const ARCReplacer &) = delete;
+  ARCReplacer &operator=(const ARCReplacer &) = delete;
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool VictimFor(T &value, page_id_t page_id);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void Candidates(std::vector<T> &values, size_t n);
+
+  void RecordAccess(const T &value, page_id_t page_id);
+
+  // the buffer pool was resized to capacity frames
+  void SetCapacity(size_t capacity);
+
+  // metrics
+  size_t GetTarget();          // adaptation parameter p, target size of T1
+  size_t GetGhostHitCount();   // missed pages found in B1 or B2
+
+private:
+  // should be called when holding the lock
+  bool Evict(bool from_t2, T &value);
+  void TrimGhosts();
+  // adapt p to a ghost hit and forget the ghost, return whether it was in B2
+  bool GhostHit(typename std::unordered_map<page_id_t, ghost>::iterator it);
+
+  size_t capacity_;
+  const size_t correlated_period_;
+  size_t current_timestamp_;
+  size_t target_;     // p
+  size_t size_;       // number of evictable frames
+  size_t ghost_hits_;
+  // ghost hit VictimFor adapted p to already, RecordAccess puts it into T2
+  page_id_t adapted_page_id_;
+  bool adapted_in_b2_;
+
+  std::mutex mutex_;
+  std::unordered_map<T, entry> frames_;
+  std::list<T> t1_, t2_;               // resident, LRU at front
+  std::list<page_id_t> b1_, b2_;       // ghosts, LRU at front
+  std::unordered_map<page_id_t, ghost> ghosts_;
+};
+
+} // namespace cmudb
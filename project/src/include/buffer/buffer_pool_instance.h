@@ -0,0 +1,268 @@
+/*
+ * buffer_pool_instance.h
+ *
+ * Functionality: One independent shard of the buffer pool. Each instance owns
+ * its own frames, page table, replacer, free list and latch, so operations on
+ * pages that hash to different instances never contend with each other.
+ * BufferPoolManager routes every call to the instance owning the page id.
+ *
+ * Fetching a resident page and unpinning a page do not take the latch: the
+ * page table is read lock-free and the pin count is an atomic of the frame.
+ * The replacer learns about such pins and unpins lazily, frames are queued
+ * and the queue is applied to the replacer under the latch before a victim is
+ * chosen. A victim is only taken over if its pin count is still 0.
+ *
+ * With a compressed cache, clean victims are compressed into it on eviction
+ * and misses look there before reading disk.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/buffer_ring.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/compressed_cache.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "disk/disk_manager.h"
+#include "hash/concurrent_hash.h"
+#include "logging/log_manager.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+class BufferPoolInstance {
+public:
+  // max_pool_size bounds Resize, 0 means pool_size
+  // compressed_cache_size: bytes of compressed clean victims kept, 0 disables
+  // the compressed cache
+  BufferPoolInstance(size_t pool_size, DiskManager *disk_manager,
+                     LogManager *log_manager = nullptr,
+                     ReplacerType replacer_type = ReplacerType::LRU,
+                     size_t max_pool_size = 0,
+                     size_t compressed_cache_size = 0);
+
+  ~BufferPoolInstance();
+
+  // disable copy
+  BufferPoolInstance(BufferPoolInstance const &) = delete;
+  BufferPoolInstance &operator=(BufferPoolInstance const &) = delete;
+
+  // a page read through ring recycles one of the ring's frames
+  Page *FetchPage(page_id_t page_id, BufferRing *ring = nullptr);
+
+  bool UnpinPage(page_id_t page_id, bool is_dirty);
+  // page must be a frame of this instance, pinned by the caller
+  bool UnpinPage(Page *page, bool is_dirty);
+
+  bool FlushPage(page_id_t page_id);
+
+  // page_id must be freshly allocated from disk manager by the caller
+  Page *NewPage(page_id_t page_id, BufferRing *ring = nullptr);
+
+  bool DeletePage(page_id_t page_id);
+
+  // dropping pages of several instances at once, for
+  // BufferPoolManager::DropTablespace: with the latch of every instance held,
+  // take over the resident frames of page_ids, all of them or none, false if
+  // one is pinned. Then either discard the pages, without writing them back
+  // (they stay allocated), or put the frames back as they were
+  inline std::unique_lock<std::mutex> Lock() {
+    return std::unique_lock<std::mutex>(latch_);
+  }
+  bool TakeOverPages(const std::vector<page_id_t> &page_ids);
+  void PutBackPages(const std::vector<page_id_t> &page_ids);
+  void DiscardPages(const std::vector<page_id_t> &page_ids);
+
+  // read page_id without pinning it, for the prefetch thread. The read is
+  // asynchronous, the page is in the page table and fetches of it wait
+  bool PrefetchPage(page_id_t page_id, BufferRing *ring = nullptr);
+  // wait until the reads started by PrefetchPage are done
+  void WaitForPrefetches();
+
+  // batch fetch, for BufferPoolManager::FetchPages: pin page_id like
+  // FetchPage, without waiting for the frame to be ready. If the page has to
+  // be read from disk, read is set and the caller reads it into the frame,
+  // then calls FinishRead. Every other frame returned is waited for with
+  // WaitForPage, after the caller's own reads are done
+  Page *PinPage(page_id_t page_id, bool &read, BufferRing *ring = nullptr);
+  void FinishRead(Page *page);
+  void WaitForPage(Page *page);
+
+  // write back dirty pages among the next n victims, for the cleaner thread
+  size_t CleanPages(size_t n);
+
+  // flush of many pages at once, for BufferPoolManager::FlushAllPages:
+  // copy a dirty page, keeping it pinned so it can not be evicted meanwhile.
+  // the copy is then registered as in flight and the pin released, writes of
+  // the page wait until the copy is written. ok: the write of data, the copy,
+  // succeeded, the page is dirty again otherwise
+  void GetDirtyPages(std::vector<page_id_t> &page_ids);
+  Page *CopyDirtyPage(page_id_t page_id, char *data);
+  void BeginPageWrite(Page *page);
+  void EndPageWrite(page_id_t page_id, const char *data, bool ok);
+
+  // ids of the resident pages, the ones the replacer would keep longest
+  // first: pinned pages, then evictable ones from the last victim backwards
+  void GetResidentPages(std::vector<page_id_t> &page_ids);
+
+  // grow or shrink to pool_size frames online, return the size reached
+  size_t Resize(size_t pool_size);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+  inline size_t GetMaxPoolSize() const { return capacity_; }
+  inline size_t GetPageSize() const { return page_size_; }
+
+  // for debug
+  inline size_t GetPageTableSize() const { return page_table_->Size(); }
+  size_t GetReplacerSize();
+
+  // FetchPage found the page in memory / had to read it from disk
+  inline size_t GetHitCount() const { return hit_count_; }
+  inline size_t GetMissCount() const { return miss_count_; }
+  // pages read ahead by PrefetchPage
+  inline size_t GetPrefetchCount() const { return prefetch_count_; }
+
+  // dirty pages written on eviction / by the cleaner thread
+  inline size_t GetForegroundWriteCount() const { return dirty_evictions_; }
+  inline size_t GetBackgroundWriteCount() const { return background_writes_; }
+
+  // snapshot of every counter and histogram of this instance
+  BufferPoolStats GetStats() const;
+
+  // ARC only: target size of T1 and number of misses found in ghost lists
+  inline size_t GetArcTarget() const {
+    auto arc = dynamic_cast<ARCReplacer<Page *> *>(replacer_);
+    return arc == nullptr ? 0 : arc->GetTarget();
+  }
+  inline size_t GetGhostHitCount() const {
+    auto arc = dynamic_cast<ARCReplacer<Page *> *>(replacer_);
+    return arc == nullptr ? 0 : arc->GetGhostHitCount();
+  }
+
+private:
+  // lock-free: pin page if it still holds page_id
+  bool TryPin(Page *page, page_id_t page_id);
+  bool UnpinFrame(Page *page, bool is_dirty);
+
+  // lock-free: queue page for the replacer, unless already queued
+  void MarkPending(Page *page);
+  // apply the queued pins, unpins and accesses to the replacer
+  // should be called when holding the latch
+  void SyncReplacer();
+
+  // take an unpinned frame over (pin count 0 -> -1), lock-free pins fail
+  // until the pin count is set again
+  static inline bool TakeOver(Page *page) {
+    int unpinned = 0;
+    return page->pin_count_.compare_exchange_strong(unpinned, -1);
+  }
+
+  // forget page_id, for DeletePage
+  // should be called when holding the latch
+  bool Discard(page_id_t page_id);
+  // return a frame taken over to the free list
+  // should be called when holding the latch
+  void FreeFrame(Page *page);
+
+  // find a frame from free list first, then from replacer. wal_lsn is set if
+  // the victim is newer than the log, see below
+  // should be called when holding the latch
+  Page *GetVictimPage(page_id_t page_id, lsn_t &wal_lsn);
+  // recycle a frame of ring for page_id, or find a regular victim, as if for
+  // no page if readahead
+  // should be called when holding the latch
+  Page *GetVictimPage(BufferRing *ring, page_id_t page_id, lsn_t &wal_lsn,
+                      bool readahead = false);
+
+  // take a victim frame for page_id, the frame is pinned and not ready.
+  // nullptr with wal_lsn set if the victim is a dirty page whose log records
+  // are not persistent up to wal_lsn, pick again after WaitForLog
+  // should be called when holding the latch
+  // readahead: the frame is for a prefetch, not an access to page_id
+  Page *ClaimFrame(page_id_t page_id, page_id_t &dirty_page_id,
+                   page_id_t &clean_page_id, BufferRing *ring,
+                   lsn_t &wal_lsn, bool readahead = false);
+  // return true if page is dirty and newer than the log (WAL), lsn is set to
+  // the log record it has to wait for
+  bool IsAheadOfLog(Page *page, lsn_t &lsn);
+  // release the latch until the log is persistent up to lsn, return false if
+  // lsn is INVALID_LSN or the log failed
+  bool WaitForLog(lsn_t lsn, std::unique_lock<std::mutex> &lock);
+
+  // write back the previous page of a claimed frame, its log records are
+  // persistent already, should be called without holding the latch
+  void WriteBack(Page *page, page_id_t page_id);
+  // keep the previous clean page of a claimed frame in the compressed cache
+  // should be called without holding the latch
+  void StashPage(Page *page, page_id_t page_id);
+
+  // read a page from the compressed cache, or from disk if not there
+  void ReadPage(page_id_t page_id, char *data);
+  // mark a prefetched frame ready and unpin it, free it if the read failed
+  void FinishPrefetch(Page *page, bool ok);
+  // keep a page dirty whose write, of copy data, failed
+  // should be called without holding the latch
+  void WriteFailed(page_id_t page_id, const char *data);
+
+  // write a page to disk and record the latency, false if the write failed
+  bool WritePage(page_id_t page_id, const char *data);
+
+  std::atomic<size_t> pool_size_;            // number of pages in this instance
+  const size_t capacity_;                    // frames reserved for Resize
+  const size_t page_size_;                   // page size of the db file
+  Page *pages_;                              // array of pages
+  char *arena_;                              // page data of every frame
+  size_t arena_size_;
+  std::vector<Page *> retired_;              // frames not in use, no memory
+  DiskManager *disk_manager_;
+  LogManager *log_manager_;
+  CompressedCache *compressed_cache_;        // nullptr if disabled
+
+  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages that are currently in memory
+
+  Replacer<Page *> *replacer_;               // to find an unpinned page for replacement
+  std::list<Page *> *free_list_;             // to find a free page for replacement
+
+  std::mutex latch_;                         // to protect shared data structure
+
+  // frames pinned or unpinned without the latch, a ring of capacity_ slots.
+  // A frame is queued at most once, so the ring never overflows
+  std::atomic<Page *> *pending_;
+  std::atomic<size_t> pending_tail_;         // next slot to fill
+  size_t pending_head_;                      // next slot to apply, under latch
+
+  // instrumentation, see BufferPoolStats
+  StripedCounter hit_count_;
+  StripedCounter miss_count_;
+  StripedCounter new_pages_;
+  StripedCounter pin_failures_;
+  StripedCounter clean_evictions_;
+  StripedCounter dirty_evictions_;
+  StripedCounter wal_flushes_;
+  StripedCounter prefetch_count_;
+  StripedCounter background_writes_;
+  StripedCounter disk_reads_;
+  StripedCounter compressed_hits_;
+  StripedCounter compressed_stashes_;
+  LatencyHistogram fetch_miss_latency_;
+  LatencyHistogram write_latency_;
+
+  // pages being written without holding the latch (by the cleaner or when
+  // evicted), disk is not up to date until the write is done
+  std::unordered_set<page_id_t> writing_;
+  // notified when an I/O done without holding the latch completes
+  std::condition_variable io_cv_;
+  // reads of PrefetchPage in flight, under latch
+  size_t prefetches_in_flight_;
+};
+
+} // namespace cmudb
@@ -4,25 +4,49 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be partitioned into several independent instances, a page id
+ * always maps to the same instance (page_id % num_instances), so threads
+ * working on different pages do not line up on a single latch.
+ *
+ * The pool can be resized online up to max_pool_size frames, reserved at
+ * construction, to give memory back under pressure without a restart.
+ *
+ * An optional compressed cache below the pool keeps clean pages evicted from
+ * it, several times as many as the same memory holds in frames.
+ *
+ * The ids of the resident pages can be dumped to a small sidecar file, at
+ * shutdown or periodically, and read back in at startup so a restarted pool
+ * does not have to warm up from the workload's own misses.
+ *
+ * The disk manager may be destroyed before the pool: the background threads
+ * of the pool are stopped then, and its reads in flight are done. The pool
+ * can only be destroyed afterwards.
  */
 
 #pragma once
 
-#include <list>
-#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
-#include "buffer/lru_replacer.h"
-#include "disk/disk_manager.h"
-#include "hash/extendible_hash.h"
-#include "logging/log_manager.h"
-#include "page/page.h"
+#include "buffer/buffer_pool_instance.h"
+#include "buffer/page_guard.h"
 
 namespace cmudb {
 
 class BufferPoolManager {
 public:
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                    LogManager *log_manager = nullptr);
+                    LogManager *log_manager = nullptr,
+                    size_t num_instances = 1,
+                    ReplacerType replacer_type = ReplacerType::LRU,
+                    size_t max_pool_size = 0,
+                    size_t compressed_cache_size = 0);
 
   ~BufferPoolManager();
 
@@ -30,37 +54,220 @@ public:
   BufferPoolManager(BufferPoolManager const &) = delete;
   BufferPoolManager &operator=(BufferPoolManager const &) = delete;
 
-  Page *FetchPage(page_id_t page_id);
+  // pages read or created through a ring recycle the ring's frames instead of
+  // evicting pages of the pool, for large scans and bulk loads
+  Page *FetchPage(page_id_t page_id, BufferRing *ring = nullptr);
+
+  // fetch many pages at once, pages[i] pinned for page_ids[i] or nullptr if
+  // its instance is full. the misses are read with one disk request per run
+  // of consecutive page ids. return the number of pages pinned
+  size_t FetchPages(const std::vector<page_id_t> &page_ids,
+                    std::vector<Page *> &pages, BufferRing *ring = nullptr);
 
   bool UnpinPage(page_id_t page_id, bool is_dirty);
 
   bool FlushPage(page_id_t page_id);
 
-  Page *NewPage(page_id_t &page_id);
+  // write back every dirty page and make them durable, for checkpoints and
+  // clean shutdown. num_pages: number of pages written, if not nullptr.
+  // return false if a write failed, those pages stay dirty, or the sync did
+  bool FlushAllPages(size_t *num_pages = nullptr);
+
+  // hint: extent of the object the page is for, see DiskManager
+  Page *NewPage(page_id_t &page_id, BufferRing *ring = nullptr,
+                ExtentHint *hint = nullptr);
 
   bool DeletePage(page_id_t page_id);
 
+  // the object of hint allocates no more pages
+  inline void ReleaseExtent(ExtentHint *hint) {
+    disk_manager_->ReleaseExtent(hint);
+  }
+
+  inline tablespace_id_t GetTablespaceId(page_id_t page_id) {
+    return disk_manager_->GetTablespaceId(page_id);
+  }
+  // discard the pages of the tablespace from the pool without writing them
+  // back, and drop it. Its objects must be out of use, false if a page of it
+  // is still pinned
+  bool DropTablespace(tablespace_id_t tablespace_id);
+
+  // page pinned and latched until the guard goes away, the guard is not valid
+  // if all the pages of the instance are pinned
+  ReadPageGuard FetchPageRead(page_id_t page_id, BufferRing *ring = nullptr);
+  WritePageGuard FetchPageWrite(page_id_t page_id);
+  WritePageGuard NewPageGuarded(page_id_t &page_id,
+                                BufferRing *ring = nullptr,
+                                ExtentHint *hint = nullptr);
+
+  // unpin a frame the caller holds, no page table lookup
+  bool UnpinPage(Page *page, bool is_dirty);
+
+  // read page_id into the pool in the background without pinning it
+  void Prefetch(page_id_t page_id,
+                std::shared_ptr<BufferRing> ring = nullptr);
+
+  // max pages scans read ahead, 0 disables readahead
+  inline size_t GetReadAheadWindow() const { return readahead_window_; }
+  inline void SetReadAheadWindow(size_t window) { readahead_window_ = window; }
+
+  // spawn a separate thread writing back dirty pages ahead of eviction
+  void RunCleanerThread(std::chrono::milliseconds interval = CLEANER_INTERVAL,
+                        size_t low_watermark = CLEANER_LOW_WATERMARK);
+  void StopCleanerThread();
+
+  // write the ids of the resident pages, hottest first, to file. return
+  // false if it can not be written
+  bool DumpPageSet(const std::string &file);
+  // read the pages listed in file into the pool, unpinned. return the number
+  // of pages read, 0 if file is missing or not a page set
+  size_t WarmUp(const std::string &file);
+  void WarmUpInBackground(const std::string &file);
+
+  // spawn a separate thread dumping the page set to file every interval,
+  // stopping it dumps one last time
+  void RunPageSetDumpThread(
+      const std::string &file,
+      std::chrono::milliseconds interval = PAGE_SET_DUMP_INTERVAL);
+  void StopPageSetDumpThread();
+
+  // grow or shrink the pool online, frames of pinned pages can not be
+  // drained. return the pool size reached
+  size_t Resize(size_t pool_size);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+
+  inline size_t GetNumInstances() const { return instances_.size(); }
+
+  // page size of the db file, the size of every frame
+  inline size_t GetPageSize() const { return instances_[0]->GetPageSize(); }
+
+  size_t GetHitCount() const {
+    size_t count = 0;
+    for (auto *instance : instances_) {
+      count += instance->GetHitCount();
+    }
+    return count;
+  }
+
+  size_t GetMissCount() const {
+    size_t count = 0;
+    for (auto *instance : instances_) {
+      count += instance->GetMissCount();
+    }
+    return count;
+  }
+
+  size_t GetPrefetchCount() const {
+    size_t count = 0;
+    for (auto *instance : instances_) {
+      count += instance->GetPrefetchCount();
+    }
+    return count;
+  }
+
+  size_t GetForegroundWriteCount() const {
+    size_t count = 0;
+    for (auto *instance : instances_) {
+      count += instance->GetForegroundWriteCount();
+    }
+    return count;
+  }
+
+  size_t GetBackgroundWriteCount() const {
+    size_t count = 0;
+    for (auto *instance : instances_) {
+      count += instance->GetBackgroundWriteCount();
+    }
+    return count;
+  }
+
+  // ARC only: sum of the T1 target size p of every instance
+  size_t GetArcTarget() const {
+    size_t target = 0;
+    for (auto *instance : instances_) {
+      target += instance->GetArcTarget();
+    }
+    return target;
+  }
+
+  size_t GetGhostHitCount() const {
+    size_t count = 0;
+    for (auto *instance : instances_) {
+      count += instance->GetGhostHitCount();
+    }
+    return count;
+  }
+
+  // snapshot of the counters and latency histograms of all instances
+  BufferPoolStats GetStats() const {
+    BufferPoolStats stats;
+    for (auto *instance : instances_) {
+      stats += instance->GetStats();
+    }
+    return stats;
+  }
+
   // for debug
   bool Check() const {
-    //std::cerr << "table: " << page_table_->Size() << " replacer: "
-    //          << replacer_->Size() << std::endl;
+    size_t table_size = 0, replacer_size = 0;
+    for (auto *instance : instances_) {
+      table_size += instance->GetPageTableSize();
+      replacer_size += instance->GetReplacerSize();
+    }
+    //std::cerr << "table: " << table_size << " replacer: "
+    //          << replacer_size << std::endl;
     // +1 for header_page, in the test environment,
     // header_page is out the replacer's control
-    return page_table_->Size() == (replacer_->Size() + 1);
+    return table_size == (replacer_size + 1);
   }
 
 private:
-  size_t pool_size_;                         // number of pages in buffer pool
-  Page *pages_;                              // array of pages
+  // the instance which owns page_id
+  inline BufferPoolInstance *GetInstance(page_id_t page_id) const {
+    return instances_[page_id % instances_.size()];
+  }
+
+  std::atomic<size_t> pool_size_;            // number of pages in buffer pool
   DiskManager *disk_manager_;
   LogManager *log_manager_;
+  std::vector<BufferPoolInstance *> instances_;  // independent shards of the pool
+  // stops the threads if the disk manager goes away first
+  size_t close_hook_id_;
+  bool disk_manager_closed_;
+
+  void StopPrefetchThread();
+  // stop every thread of the pool using the disk manager
+  void StopThreads();
+
+  size_t WarmUp(const std::string &file, const std::atomic<bool> *running);
+
+  // prefetch thread, started by the first Prefetch call
+  std::atomic<size_t> readahead_window_;
+  bool prefetch_running_;
+  std::thread *prefetch_thread_;
+  std::mutex prefetch_latch_;                // protect prefetch_queue_
+  std::condition_variable prefetch_cv_;
+  // page id and the ring of the scan asking for it
+  std::deque<std::pair<page_id_t, std::shared_ptr<BufferRing>>>
+      prefetch_queue_;
 
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages that are currently in memory
+  // cleaner thread
+  std::atomic<bool> cleaner_running_;
+  std::thread *cleaner_thread_;
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
 
-  Replacer<Page *> *replacer_;               // to find an unpinned page for replacement
-  std::list<Page *> *free_list_;             // to find a free page for replacement
+  // warm up thread, stopped early if the pool goes away first
+  std::atomic<bool> warm_up_running_;
+  std::thread *warm_up_thread_;
 
-  std::mutex latch_;                         // to protect shared data structure
+  // page set dump thread
+  std::atomic<bool> dump_running_;
+  std::thread *dump_thread_;
+  std::string dump_file_;
+  std::mutex dump_latch_;
+  std::condition_variable dump_cv_;
 };
 
 } // namespace cmudb
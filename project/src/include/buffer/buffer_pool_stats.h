@@ -0,0 +1,142 @@
+/**
+ * buffer_pool_stats.h
+ *
+ * Functionality: Instrumentation of the buffer pool. Counters are sharded
+ * over cache line sized stripes, every thread adds to its own stripe, so
+ * counting on the hit path does not bounce a shared cache line between
+ * cores; reading a counter sums the stripes. Latency histograms use
+ * power-of-two buckets of nanoseconds and only time I/O, where a shared
+ * atomic add is negligible.
+ *
+ * BufferPoolStats is a plain snapshot of all of them, the sum over the
+ * instances of a buffer pool manager.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace cmudb {
+
+static constexpr size_t STAT_STRIPES = 16;
+static constexpr size_t HISTOGRAM_BUCKETS = 40; // up to 2^40 ns, ~18 minutes
+
+class StripedCounter {
+  struct Stripe {
+    std::atomic<uint64_t> value;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+public:
+  StripedCounter() {
+    for (auto &stripe : stripes_) {
+      stripe.value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // disable copy
+  StripedCounter(const StripedCounter &) = delete;
+  StripedCounter &operator=(const StripedCounter &) = delete;
+
+  inline void Add(uint64_t n = 1) {
+    stripes_[ThreadStripe()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+  inline StripedCounter &operator++() {
+    Add();
+    return *this;
+  }
+  inline StripedCounter &operator+=(uint64_t n) {
+    Add(n);
+    return *this;
+  }
+
+  uint64_t Load() const {
+    uint64_t sum = 0;
+    for (auto &stripe : stripes_) {
+      sum += stripe.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+  inline operator uint64_t() const { return Load(); }
+
+private:
+  // threads are spread over the stripes round robin on first use
+  static inline size_t ThreadStripe() {
+    static std::atomic<size_t> next_stripe(0);
+    static thread_local size_t stripe = next_stripe++ % STAT_STRIPES;
+    return stripe;
+  }
+
+  Stripe stripes_[STAT_STRIPES];
+};
+
+// snapshot of a LatencyHistogram
+struct LatencyStats {
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+  // bucket i counts latencies in [2^i, 2^(i+1)) ns, bucket 0 also 0 ns
+  uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+
+  double MeanMicros() const;
+  // upper bound of the bucket holding the p-th percentile, 0 < p <= 100
+  uint64_t PercentileNanos(double p) const;
+
+  LatencyStats &operator+=(const LatencyStats &that);
+};
+
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+
+  // disable copy
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(std::chrono::nanoseconds latency);
+  // record the time elapsed since start
+  inline void RecordSince(std::chrono::steady_clock::time_point start) {
+    Record(std::chrono::steady_clock::now() - start);
+  }
+
+  void Snapshot(LatencyStats &stats) const;
+
+private:
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_ns_;
+  std::atomic<uint64_t> buckets_[HISTOGRAM_BUCKETS];
+};
+
+struct BufferPoolStats {
+  uint64_t fetch_hits = 0;        // FetchPage found the page in memory
+  uint64_t fetch_misses = 0;      // FetchPage read the page from disk
+  uint64_t new_pages = 0;         // NewPage succeeded
+  uint64_t pin_failures = 0;      // FetchPage/NewPage returned nullptr
+  uint64_t clean_evictions = 0;   // victim frame held a clean page
+  uint64_t dirty_evictions = 0;   // victim frame had to be written back
+  uint64_t wal_flushes = 0;       // eviction waited for the log to be flushed
+  uint64_t prefetches = 0;        // pages read ahead
+  uint64_t background_writes = 0; // dirty pages written by the cleaner
+  uint64_t disk_reads = 0;        // pages read from disk
+  uint64_t compressed_hits = 0;   // pages read from the compressed cache
+  uint64_t compressed_stashes = 0; // clean victims kept compressed
+  uint64_t compressed_pages = 0;  // pages in the compressed cache now
+  uint64_t compressed_bytes = 0;  // and the memory they take
+
+  LatencyStats fetch_miss_latency; // FetchPage miss, eviction included
+  LatencyStats write_latency;      // every page written by the pool
+
+  // percentage of fetches served from the pool
+  double HitRatio() const;
+  // percentage of page reads, misses of the pool, served from the
+  // compressed cache
+  double CompressedHitRatio() const;
+
+  BufferPoolStats &operator+=(const BufferPoolStats &that);
+
+  std::string ToString() const;
+};
+
+} // namespace cmudb
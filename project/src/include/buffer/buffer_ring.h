@@ -0,0 +1,64 @@
+/**
+ * buffer_ring.h
+ *
+ * Functionality: buffer access strategy of a large sequential scan or bulk
+ * load. Pages fetched or created through a ring recycle a small private set
+ * of frames in turn instead of taking victims from the replacer, so the scan
+ * never holds more than `size` frames and the rest of the pool keeps its
+ * working set.
+ *
+ * A slot remembers its frame and the page the ring put into it. The frame is
+ * only recycled if it still holds that page and is unpinned, otherwise the
+ * slot takes a regular victim instead (another thread is using the page, or
+ * the frame was evicted meanwhile). With a partitioned pool an instance only
+ * recycles its own frames, the slots are shared among the instances the scan
+ * goes through.
+ *
+ * A ring serves one scan at a time, and the prefetch requests of that scan,
+ * which outlive it in the prefetch queue, hence the latch and shared_ptr use.
+ * Pages read ahead occupy ring frames until the scan gets to them, so the
+ * ring should be well larger than the readahead window.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+#include "page/page.h"
+
+namespace cmudb {
+
+class BufferRing {
+  friend class BufferPoolInstance;
+
+  struct Slot {
+    Page *frame = nullptr;
+    page_id_t page_id = INVALID_PAGE_ID;
+  };
+
+public:
+  explicit BufferRing(size_t size = BUFFER_RING_SIZE)
+      : slots_(size), next_(0), recycle_count_(0) {
+    assert(size > 0);
+  }
+
+  // disable copy
+  BufferRing(BufferRing const &) = delete;
+  BufferRing &operator=(BufferRing const &) = delete;
+
+  inline size_t GetSize() const { return slots_.size(); }
+
+  // frames recycled instead of evicting a page of the pool
+  inline size_t GetRecycleCount() const { return recycle_count_; }
+
+private:
+  std::mutex latch_;          // protect slots_ and next_
+  std::vector<Slot> slots_;
+  size_t next_;               // slot to recycle next
+  std::atomic<size_t> recycle_count_;
+};
+
+} // namespace cmudb
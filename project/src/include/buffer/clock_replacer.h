@@ -0,0 +1,58 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK (second chance) approximation of LRU. Every frame owns
+ * a slot in a fixed array holding an "in replacer" bit and a reference bit.
+ * Insert/Erase only flip bits, so they never allocate and never take the
+ * mutex; Victim sweeps the clock hand under the mutex, clearing reference
+ * bits until it meets a frame that has not been touched since the last sweep.
+ *
+ * Values are mapped to slots by their distance from `base`, e.g. the address
+ * of the first frame for Page *, or 0 for int.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+public:
+  explicit ClockReplacer(size_t num_frames, T base = T());
+
+  ~ClockReplacer();
+
+  // disable copy
+  ClockReplacer(const ClockReplacer &) = delete;
+  ClockReplacer &operator=(const ClockReplacer &) = delete;
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void Candidates(std::vector<T> &values, size_t n);
+
+private:
+  inline size_t Index(const T &value) const;
+
+  const size_t num_frames_;
+  const T base_;
+
+  std::unique_ptr<std::atomic<bool>[]> in_replacer_;
+  std::unique_ptr<std::atomic<bool>[]> referenced_;
+  std::atomic<size_t> size_;
+
+  std::mutex mutex_;   // protect clock hand
+  size_t hand_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,76 @@
+/**
+ * compressed_cache.h
+ *
+ * Functionality: second level page cache between a buffer pool instance and
+ * disk. Clean pages evicted from the pool are compressed and kept here, up to
+ * a bound on the compressed bytes held, least recently stashed pages are
+ * dropped first. A pool miss looks here before reading disk; a page found is
+ * handed back to the pool and dropped from this cache, a page lives in one
+ * tier at a time, so a copy here is never older than disk.
+ *
+ * The codec is a byte oriented LZ77 variant in the style of LZ4: sequences of
+ * literals followed by a back reference into the page, found through a small
+ * hash table of 4 byte prefixes. It is fast and does well on the zero filled
+ * free space and repeated keys of slotted and b+ tree pages.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class CompressedCache {
+public:
+  // capacity: compressed bytes held at most
+  explicit CompressedCache(size_t capacity);
+
+  // disable copy
+  CompressedCache(CompressedCache const &) = delete;
+  CompressedCache &operator=(CompressedCache const &) = delete;
+
+  // keep a copy of page_id, replacing an older one. return false if the page
+  // does not compress below page_size
+  bool Insert(page_id_t page_id, const char *data, size_t page_size);
+  // move page_id out of the cache into data. return false if not found
+  bool Remove(page_id_t page_id, char *data, size_t page_size);
+  // drop page_id, e.g. when it is deleted
+  void Erase(page_id_t page_id);
+
+  inline size_t GetCapacity() const { return capacity_; }
+  size_t GetSize();      // compressed bytes held
+  size_t GetNumPages();
+
+  // compress size bytes of src into dst, return the compressed size, 0 if it
+  // does not fit in capacity bytes
+  static size_t Compress(const char *src, size_t size, char *dst,
+                         size_t capacity);
+  // decompress size bytes of src into exactly dst_size bytes of dst. return
+  // false if src is not a valid compressed block of that size
+  static bool Decompress(const char *src, size_t size, char *dst,
+                         size_t dst_size);
+
+private:
+  struct Entry {
+    page_id_t page_id;
+    std::string data;
+  };
+
+  // drop entries from the cold end until bytes more fit
+  // should be called when holding the latch
+  void MakeRoom(size_t bytes);
+  void EraseEntry(std::list<Entry>::iterator it);
+
+  const size_t capacity_;
+  size_t size_;
+  std::mutex latch_;
+  std::list<Entry> entries_;  // most recently stashed first
+  std::unordered_map<page_id_t, std::list<Entry>::iterator> index_;
+};
+
+} // namespace cmudb
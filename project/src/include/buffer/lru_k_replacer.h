@@ -0,0 +1,79 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement. Every frame remembers the logical time of
+ * its last K accesses, the victim is the evictable frame whose K-th most
+ * recent access is the oldest (largest backward K-distance). Frames accessed
+ * less than K times have an infinite distance and go first, least recently
+ * used first, so a sequential scan touching each page once can not push out
+ * pages that are used over and over (b+ tree pages, header page).
+ *
+ * Accesses less than `correlated_period` ticks (accesses to any frame) after
+ * the previous one to the same frame are correlated, e.g. a table iterator
+ * fetching the page once per tuple, and only count as one access.
+ *
+ * History survives Erase (pin), it is dropped when the frame is evicted or
+ * starts holding another page.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+  struct history {
+    page_id_t page_id = INVALID_PAGE_ID;
+    std::deque<size_t> accesses;   // oldest first, at most k entries
+    bool evictable = false;
+  };
+  // <has k accesses, k-th most recent or last access>, smallest goes first
+  typedef std::pair<bool, size_t> key_type;
+
+public:
+  explicit LRUKReplacer(size_t k = LRUK_K,
+                        size_t correlated_period = CORRELATED_PERIOD);
+
+  ~LRUKReplacer();
+
+  // disable copy
+  LRUKReplacer(const LRUKReplacer &) = delete;
+  LRUKReplacer &operator=(const LRUKReplacer &) = delete;
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void Candidates(std::vector<T> &values, size_t n);
+
+  void RecordAccess(const T &value, page_id_t page_id);
+
+private:
+  // should be called when holding the lock
+  inline key_type Key(const history &h) const {
+    return h.accesses.size() >= k_
+               ? std::make_pair(true, h.accesses.front())
+               : std::make_pair(false, h.accesses.back());
+  }
+
+  const size_t k_;
+  const size_t correlated_period_;
+  size_t current_timestamp_;
+
+  std::mutex mutex_;
+  std::unordered_map<T, history> frames_;
+  std::map<key_type, T> evictable_;
+};
+
+} // namespace cmudb
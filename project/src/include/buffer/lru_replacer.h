@@ -43,6 +43,8 @@ public:
 
   size_t Size();
 
+  void Candidates(std::vector<T> &values, size_t n);
+
 private:
   // invariant check
   void check();
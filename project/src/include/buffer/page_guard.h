@@ -0,0 +1,88 @@
+/**
+ * page_guard.h
+ *
+ * Functionality: RAII handles of a pinned and latched page, handed out by
+ * BufferPoolManager::FetchPageRead/FetchPageWrite/NewPageGuarded. A guard
+ * keeps the frame it was given, so releasing it unlatches the page and unpins
+ * the frame exactly once, without looking the page up again. Guards are move
+ * only; a moved from or default constructed guard is not valid and releases
+ * nothing.
+ */
+
+#pragma once
+
+#include "page/page.h"
+
+namespace cmudb {
+
+class BufferPoolManager;
+
+class ReadPageGuard {
+public:
+  ReadPageGuard() = default;
+  // page must be pinned and read latched by the caller
+  ReadPageGuard(BufferPoolManager *buffer_pool_manager, Page *page);
+
+  ~ReadPageGuard() { Drop(); }
+
+  // disable copy
+  ReadPageGuard(ReadPageGuard const &) = delete;
+  ReadPageGuard &operator=(ReadPageGuard const &) = delete;
+
+  ReadPageGuard(ReadPageGuard &&that) noexcept;
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+  // unlatch and unpin now
+  void Drop();
+
+  inline bool IsValid() const { return page_ != nullptr; }
+  inline page_id_t GetPageId() const { return page_->GetPageId(); }
+  inline Page *GetPage() const { return page_; }
+  inline const char *GetData() const { return page_->GetData(); }
+
+  // view of the page content, e.g. a b+ tree page
+  template <typename T> inline const T *As() const {
+    return reinterpret_cast<const T *>(GetData());
+  }
+
+private:
+  BufferPoolManager *buffer_pool_manager_ = nullptr;
+  Page *page_ = nullptr;
+};
+
+class WritePageGuard {
+public:
+  WritePageGuard() = default;
+  // page must be pinned and write latched by the caller
+  WritePageGuard(BufferPoolManager *buffer_pool_manager, Page *page);
+
+  ~WritePageGuard() { Drop(); }
+
+  // disable copy
+  WritePageGuard(WritePageGuard const &) = delete;
+  WritePageGuard &operator=(WritePageGuard const &) = delete;
+
+  WritePageGuard(WritePageGuard &&that) noexcept;
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+  // unlatch and unpin now, dirty unless SetDirty(false) was called
+  void Drop();
+
+  inline bool IsValid() const { return page_ != nullptr; }
+  inline page_id_t GetPageId() const { return page_->GetPageId(); }
+  inline Page *GetPage() const { return page_; }
+  inline char *GetData() const { return page_->GetData(); }
+  inline void SetDirty(bool is_dirty) { is_dirty_ = is_dirty; }
+
+  // view of the page content, e.g. a b+ tree page
+  template <typename T> inline T *As() const {
+    return reinterpret_cast<T *>(GetData());
+  }
+
+private:
+  BufferPoolManager *buffer_pool_manager_ = nullptr;
+  Page *page_ = nullptr;
+  bool is_dirty_ = true;
+};
+
+} // namespace cmudb
@@ -0,0 +1,38 @@
+/**
+ * read_ahead.h
+ *
+ * Functionality: readahead state of one sequential scan over a chain of pages
+ * (table pages, b+ tree leaves). Each time the scan enters a page it reports
+ * the page and its next link; the next link is always prefetched. While the
+ * scan keeps moving to page id + 1, the chain is assumed to be laid out
+ * sequentially and the ids following the next link are prefetched too, the
+ * window doubling up to the pool's readahead window. A jump shrinks the
+ * window back to the next link only. A scan reading through a buffer ring
+ * prefetches into the same ring.
+ */
+
+#pragma once
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class ReadAhead {
+public:
+  explicit ReadAhead(BufferPoolManager *buffer_pool_manager,
+                     std::shared_ptr<BufferRing> ring = nullptr);
+
+  // the scan entered page_id, whose next link is next_page_id
+  void OnPage(page_id_t page_id, page_id_t next_page_id);
+
+  inline size_t GetWindow() const { return window_; }
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  std::shared_ptr<BufferRing> ring_;
+  page_id_t last_page_id_;   // page the scan was on before
+  page_id_t issued_until_;   // highest page id prefetched on a sequential run
+  size_t window_;
+};
+
+} // namespace cmudb
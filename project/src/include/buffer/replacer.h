@@ -6,9 +6,15 @@
 #pragma once
 
 #include <cstdlib>
+#include <vector>
+
+#include "common/config.h"
 
 namespace cmudb {
 
+// replacement policy of buffer pool
+enum class ReplacerType { LRU = 0, CLOCK, LRU_K, ARC };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
@@ -17,6 +23,13 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // peek at up to n values Victim would return next, most likely first
+  virtual void Candidates(std::vector<T> &values, size_t n) = 0;
+  // value is accessed (pinned) for page_id, history based policies only
+  virtual void RecordAccess(const T &value, page_id_t page_id) {}
+  // Victim making room for a miss of page_id, policies keeping the history
+  // of evicted pages may look at it first
+  virtual bool VictimFor(T &value, page_id_t page_id) { return Victim(value); }
 };
 
 } // namespace cmudb
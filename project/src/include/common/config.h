@@ -16,18 +16,40 @@ extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
 extern std::atomic<bool> ENABLE_LOGGING;
 
+extern std::chrono::milliseconds CLEANER_INTERVAL;
+
+extern std::chrono::milliseconds PAGE_SET_DUMP_INTERVAL;
+
+extern std::chrono::milliseconds SYNC_INTERVAL;
+
 #define INVALID_PAGE_ID  (-1) // representing an invalid page id
 #define INVALID_TXN_ID   (-1) // representing an invalid txn id
 #define INVALID_LSN      (-1) // representing an invalid lsn
 #define HEADER_PAGE_ID   0    // the header page id
-#define PAGE_SIZE        4096 // size of a data page in byte
+#define DB_TABLESPACE_ID 0    // pages kept in the db file, not a tablespace
+#define PAGE_SIZE        4096 // default size of a data page in byte
+#define MIN_PAGE_SIZE    4096 // page sizes are powers of two in between
+#define MAX_PAGE_SIZE    (64 << 10)
+#define HUGE_PAGE_SIZE   (2 << 20) // transparent huge page size on x86-64
 
 #define LOG_BUFFER_SIZE  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
 #define BUCKET_SIZE      50   // size of extendible hash bucket
 #define BUFFER_POOL_SIZE 10   // size of buffer pool
+#define LRUK_K           2    // number of accesses remembered by LRU-K replacer
+#define CORRELATED_PERIOD 16 // LRU-K/ARC: closer accesses to a frame count as one
+#define CLEANER_LOW_WATERMARK 4 // next victims per instance the cleaner keeps clean
+#define READAHEAD_WINDOW 8    // max pages a sequential scan reads ahead
+#define PREFETCH_QUEUE_SIZE 64 // pending prefetch requests, more are dropped
+#define BUFFER_RING_SIZE 32   // frames a scan with a buffer ring recycles
+#define FLUSH_BATCH_SIZE 64   // pages FlushAllPages copies and writes at once
+#define IO_QUEUE_DEPTH   32   // page I/Os in flight through the async I/O engine
+#define FREE_EXTENT_PAGES 256 // aligned runs of free pages punched out of the db file
+#define EXTENT_SIZE      (1 << 20) // db file preallocation unit, and page run reserved per object
+#define LOG_PREALLOC_SIZE (4 << 20) // bytes of the log file allocated ahead at a time
 
 typedef int32_t page_id_t;    // page id type
 typedef int32_t txn_id_t;     // transaction id type
 typedef int32_t lsn_t;        // log sequence number type
+typedef int32_t tablespace_id_t; // tablespace id type
 
 } // namespace cmudb
\ No newline at end of file
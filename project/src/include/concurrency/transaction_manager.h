@@ -25,7 +25,9 @@ public:
   TransactionManager &operator=(TransactionManager const &) = delete;
 
   Transaction *Begin();
-  void Commit(Transaction *txn);
+  // false if logging is on and the commit record can not be made durable,
+  // the log failed. The transaction is committed in memory all the same
+  bool Commit(Transaction *txn);
   void Abort(Transaction *txn);
 
 private:
@@ -5,31 +5,194 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * The first block of the database file is a file header recording the page
+ * size chosen when the file was created, pages follow it. The header block is
+ * one page large so that pages stay aligned for O_DIRECT. Files of version 0,
+ * without a header, are not opened, UpgradeVersion0File rewrites them in the
+ * current format on request.
+ *
+ * Pages come in groups of page_size * 8, each led by a bitmap block with a
+ * bit per page of the group set while the page is allocated. Allocation is
+ * first fit, freed pages are reused before the file grows, and aligned runs
+ * of FREE_EXTENT_PAGES free pages are punched out of the file. Allocating and
+ * freeing only change the bitmap in memory, changed bitmap blocks are written
+ * before the next page write and on SyncPages, so a page on disk always has
+ * its bit on disk. A crash may leak pages freed since, it never hands out a
+ * page holding data again.
+ *
+ * The file is preallocated EXTENT_SIZE at a time ahead of the pages handed
+ * out, so it grows in large contiguous chunks. An object (table heap, b+
+ * tree) passing an extent hint gets its pages from extents of EXTENT_SIZE
+ * reserved for it, other allocations skip reserved pages. Reservations live
+ * in memory only, the rest of an extent is free for first fit again after a
+ * restart, ReleaseExtent or once the hint goes away with its object.
+ *
+ * A tablespace keeps the extents of its objects in files of their own
+ * instead of the db file, one file per directory it was created with, its
+ * extents striped over them round robin. Page ids stay global: the db file
+ * still allocates them, a small map of extent number to (file, offset) tells
+ * where a page lives. Each tablespace file records the extents it holds in
+ * a map behind its header block, the db file's catalog of tablespace files
+ * (db name with .tablespaces) is read back on startup. Dropping a tablespace
+ * unlinks its files and frees all of its pages at once.
+ *
+ * Pages are read and written with positional I/O on a file descriptor, there
+ * is no shared file position, so any number of threads do page I/O at once.
+ * The size of the file is cached, nothing asks the file system for it.
+ * Runs of consecutive pages are moved with a single preadv/pwritev each, from
+ * and to frames scattered in memory.
+ *
+ * Page I/O can also be asynchronous, through an I/O engine (io_uring or a
+ * thread pool) created on first use, to keep many page I/Os in flight.
+ *
+ * The db file and the log file each have a sync mode, deciding when their
+ * writes reach stable storage. The log file is zero-filled ahead of its
+ * end, LOG_PREALLOC_SIZE at a time, so appends change neither its blocks
+ * nor its size. The log ends at the first flush starting with zeros.
  */
 
 #pragma once
+#include <algorithm>
 #include <atomic>
-#include <fstream>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
+#include "disk/io_engine.h"
 
 namespace cmudb {
 
+class DiskManager;
+
+// the extent an object allocates its pages from, owned by the object and
+// only touched by DiskManager::AllocatePage. empty at first. The rest of the
+// extent is released when the hint goes away, unless the disk manager is
+// gone already
+struct ExtentHint {
+  ExtentHint() = default;
+  ~ExtentHint();
+
+  // disable copy, the disk manager knows the hint by its address
+  ExtentHint(ExtentHint const &) = delete;
+  ExtentHint &operator=(ExtentHint const &) = delete;
+
+  page_id_t next = INVALID_PAGE_ID; // next page id of the extent to try
+  page_id_t end = INVALID_PAGE_ID;  // past the last page id of the extent
+  // where the extents of the object live
+  tablespace_id_t tablespace_id = DB_TABLESPACE_ID;
+  // reserved the extent, nullptr if there is none
+  DiskManager *disk_manager = nullptr;
+};
+
+// when the writes to a file become durable
+enum class SyncMode {
+  NONE,     // only on SyncPages/SyncLog, the OS writes back when it likes
+  ALWAYS,   // fdatasync after every write
+  PERIODIC, // fdatasync every SYNC_INTERVAL by a background thread, a crash
+            // loses the writes of up to one interval
+  DSYNC,    // file opened with O_DSYNC, every write is durable on return
+};
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  // direct_io: bypass the OS page cache (O_DIRECT) for the db file
+  // page_size: page size of a new db file, an existing file keeps the page
+  // size recorded in its header
+  // io_engine: engine behind the asynchronous page I/O
+  // data_sync/log_sync: sync mode of the db file/log file. The log manager
+  // takes a log buffer as persistent once WriteLog returns true
+  DiskManager(const std::string &db_file, bool direct_io = false,
+              size_t page_size = PAGE_SIZE,
+              IOEngineType io_engine = IOEngineType::URING,
+              SyncMode data_sync = SyncMode::NONE,
+              SyncMode log_sync = SyncMode::ALWAYS);
   ~DiskManager();
 
-  void WritePage(page_id_t page_id, const char *page_data);
+  // rewrite a version 0 db file (no header, PAGE_SIZE pages) in the current
+  // format, never done on open since such files have no magic to check
+  static void UpgradeVersion0File(const std::string &db_file);
+
+  // page writes return false if the write, or its sync with ALWAYS, failed
+  bool WritePage(page_id_t page_id, const char *page_data);
   void ReadPage(page_id_t page_id, char *page_data);
+  // write num_pages consecutive pages starting at page_id in one request
+  bool WritePages(page_id_t page_id, const char *pages_data, size_t num_pages);
+  // vectored I/O of num_pages consecutive pages starting at page_id, one
+  // buffer per page, in one request (one per group, see above)
+  void ReadPages(page_id_t page_id, size_t num_pages, char *const *pages_data);
+  bool WritePages(page_id_t page_id, size_t num_pages,
+                  const char *const *pages_data);
+  // scatter/gather I/O of the pages of a sorted page id list, one request per
+  // run of consecutive ids. buffer i holds page page_ids[i]
+  void ReadPages(const std::vector<page_id_t> &page_ids,
+                 char *const *pages_data);
+  bool WritePages(const std::vector<page_id_t> &page_ids,
+                  const char *const *pages_data);
+  // make the pages written so far durable, false if that failed
+  bool SyncPages();
 
-  void WriteLog(char *log_data, int size);
+  // asynchronous page I/O, up to IO_QUEUE_DEPTH in flight. callback runs on
+  // an I/O thread once done, with false on an I/O error, and must not wait
+  // for other asynchronous I/O. data must stay valid until then
+  void ReadPageAsync(page_id_t page_id, char *page_data,
+                     std::function<void(bool)> callback);
+  void WritePagesAsync(page_id_t page_id, const char *pages_data,
+                       size_t num_pages, std::function<void(bool)> callback);
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+  std::future<bool> WritePagesAsync(page_id_t page_id, const char *pages_data,
+                                    size_t num_pages);
+  // "io_uring" or "threads"
+  const char *GetIOEngineName();
+
+  // hook runs when the disk manager is destroyed, before the asynchronous
+  // I/O in flight is drained, so users with threads of their own (a buffer
+  // pool) can stop them. return an id for RemoveCloseHook
+  size_t AddCloseHook(std::function<void()> hook);
+  void RemoveCloseHook(size_t hook_id);
+
+  // false if the write, or its sync with ALWAYS, failed. The log may have a
+  // hole then, the records written after it are not durable either
+  bool WriteLog(char *log_data, int size);
   bool ReadLog(char *log_data, int size, int offset);
+  // make the log written so far durable
+  void SyncLog();
 
-  page_id_t AllocatePage();
+  // hint: take the page from the extent of the object, reserve a new one
+  // for it when used up. first fit if nullptr
+  page_id_t AllocatePage(ExtentHint *hint = nullptr);
   void DeallocatePage(page_id_t page_id);
+  // give up the pages of the extent not allocated yet, e.g. on drop
+  void ReleaseExtent(ExtentHint *hint);
+  bool IsAllocated(page_id_t page_id);
+
+  // create a tablespace of a file name.<i>.tbs in each of dirs, the
+  // directory of the db file if empty. Objects pass its id in their extent
+  // hint. throw an exception if a file can not be created
+  tablespace_id_t CreateTablespace(const std::string &name,
+                                   const std::vector<std::string> &dirs = {});
+  // unlink the files of the tablespace, its pages are free again. Nothing
+  // may read or write them any more. false if there is no such tablespace
+  bool DropTablespace(tablespace_id_t tablespace_id);
+  // tablespace page_id lives in, DB_TABLESPACE_ID if in the db file
+  tablespace_id_t GetTablespaceId(page_id_t page_id);
+  // the allocated pages of a tablespace
+  std::vector<page_id_t> GetTablespacePages(tablespace_id_t tablespace_id);
+
+  int GetNumPages();
+
+  inline size_t GetPageSize() const { return page_size_; }
+
+  inline bool IsDirectIO() const { return direct_io_; }
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,17 +200,169 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
-  int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  // a file of a tablespace. Its first extent holds the header block and the
+  // extent map: for each slot of the file the extent number + 1 of the
+  // extent in it, 0 past the last one. Extent slots follow
+  struct TablespaceFile {
+    std::string path;
+    int fd;
+    std::vector<uint32_t> extent_map; // a multiple of a page long
+    size_t num_extents = 0;
+  };
+  struct Tablespace {
+    std::vector<TablespaceFile> files;
+    // in all files, the next one goes to file num_extents % files.size()
+    size_t num_extents = 0;
+    size_t num_free_pages = 0; // in its extents
+  };
+  // where an extent of a tablespace lives
+  struct ExtentLocation {
+    tablespace_id_t tablespace_id;
+    int fd;
+    off_t offset;
+  };
+
+  // create the file header of an empty file, or read and validate it
+  void InitFileHeader(size_t page_size);
+  // pages of a group, behind its bitmap block
+  inline size_t PagesPerGroup() const { return page_size_ * 8; }
+  // byte offset of the bitmap block of a group, behind the file header
+  inline off_t BitmapOffset(size_t group) const {
+    return static_cast<off_t>(1 + group * (PagesPerGroup() + 1)) * page_size_;
+  }
+  // byte offset of a page
+  inline off_t PageOffset(page_id_t page_id) const {
+    return BitmapOffset(page_id / PagesPerGroup()) +
+           static_cast<off_t>(1 + page_id % PagesPerGroup()) * page_size_;
+  }
+  // pages of an extent, a power of two dividing the pages of a group
+  inline size_t ExtentPages() const {
+    return std::max<size_t>(1, EXTENT_SIZE / page_size_);
+  }
+  // byte offset of extent slot of a tablespace file, behind the extent map
+  inline off_t SlotOffset(size_t slot) const {
+    return static_cast<off_t>((1 + slot) * ExtentPages() * page_size_);
+  }
+  // file and offset of page_id. Return how many of the num_pages pages from
+  // page_id follow it there, up to the end of its group, and of its extent
+  // in a tablespace
+  size_t Locate(page_id_t page_id, size_t num_pages, int &fd, off_t &offset);
+  // read the bitmap blocks of an existing file
+  void LoadBitmap();
+  // the following should be called when holding alloc_latch_
+  // make room in the bitmaps for page_id
+  void GrowBitmap(page_id_t page_id);
+  inline bool IsSet(const std::vector<uint64_t> &bits,
+                    page_id_t page_id) const {
+    return static_cast<size_t>(page_id / 64) < bits.size() &&
+           (bits[page_id / 64] & (uint64_t(1) << (page_id % 64))) != 0;
+  }
+  // neither allocated nor reserved
+  bool IsRunFree(page_id_t first, size_t num_pages) const;
+  // reserve the first free aligned extent for hint
+  void ReserveExtent(ExtentHint *hint);
+  // preallocate the db file from first up to and including last
+  void Preallocate(page_id_t first, page_id_t last);
+  // the tablespace functions below should be called when holding
+  // alloc_latch_
+  // point hint at an extent of its tablespace with a free page, false if
+  // there is none
+  bool FindTablespaceExtent(ExtentHint *hint);
+  // move the free extent from first_page_id into a file of the tablespace
+  void MapExtent(tablespace_id_t tablespace_id, page_id_t first_page_id);
+  // open a file of a tablespace, create it with its header if create
+  TablespaceFile OpenTablespaceFile(const std::string &path,
+                                    tablespace_id_t tablespace_id,
+                                    bool create);
+  // read the catalog and the extent maps of the tablespace files
+  void LoadTablespaces();
+  // replace the catalog with the tablespaces now
+  void WriteCatalog();
+  void CloseTablespaces();
+  // should be called when holding alloc_latch_
+  bool WriteBitmap(size_t group);
+  // write the changed bitmap blocks, before pages are written. Blocks whose
+  // write failed are written again next time
+  bool FlushBitmap();
+  void PunchFreeExtent(page_id_t page_id);
+  // positional I/O on the db file or a tablespace file. A read beyond the
+  // end of file fills the rest of data with zeros. Writes return false if
+  // the write or the sync of the file mode failed
+  bool WriteAt(int fd, const char *data, size_t size, off_t offset);
+  void ReadAt(int fd, char *data, size_t size, off_t offset);
+  // vectored version of the above for num_pages pages, at most IOV_MAX
+  bool VectorAt(bool write, int fd, char *const *pages_data, size_t num_pages,
+                off_t offset);
+  // split a run of pages where its location changes and at IOV_MAX
+  bool PagesAt(bool write, page_id_t page_id, size_t num_pages,
+               char *const *pages_data);
+  void SubmitAt(bool write, int fd, char *data, size_t size, off_t offset,
+                std::function<void(bool)> callback);
+  // raise the cached file size to end if below
+  void GrowFileSize(off_t end);
+  // apply the sync mode of the file after a write to it
+  bool AfterWrite(int fd, SyncMode mode, std::atomic<bool> &unsynced);
+  // fdatasync the db file and the tablespace files, false if one failed
+  bool SyncDataFiles();
+  // end of the log written in flushes of flush_size bytes
+  off_t FindLogEnd(int flush_size);
+  // zero-fill the log file up to end at least, false if that failed
+  bool PreallocateLog(off_t end);
+  IOEngine *GetIOEngine();
+
+  int log_fd_;
+  // bytes in the log file, only the flush thread appends
+  std::atomic<off_t> log_size_;
+  // end of the blocks preallocated for the log
+  off_t log_allocated_;
+  // log_size_ is the end of the log, not the file size it starts from
+  bool log_end_found_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
+  std::string catalog_name_;
+  int db_fd_;
+  // db file opened with O_DIRECT
+  bool direct_io_;
+  // bytes in the db file, grows with writes beyond its end
+  std::atomic<off_t> file_size_;
+  size_t page_size_;
+  IOEngineType io_engine_type_;
+  IOEngine *io_engine_;
+  std::once_flag io_engine_once_;
+  SyncMode data_sync_;
+  SyncMode log_sync_;
+  // written since the last sync, for PERIODIC
+  std::atomic<bool> data_unsynced_;
+  std::atomic<bool> log_unsynced_;
+  // background sync thread, only with a PERIODIC file
+  std::thread *sync_thread_;
+  bool sync_running_;
+  std::mutex sync_latch_;
+  std::condition_variable sync_cv_;
+  std::mutex alloc_latch_;             // protect the bitmap
+  std::vector<uint64_t> bitmap_;       // bit set per allocated page
+  std::vector<uint64_t> reserved_;     // bit set per page of an extent hint
+  std::set<ExtentHint *> hints_;       // hints holding an extent
+  std::set<size_t> dirty_groups_;      // bitmap blocks changed in memory
+  std::atomic<bool> bitmap_dirty_;     // dirty_groups_ is not empty
+  page_id_t next_page_id_;             // past the last allocated page
+  page_id_t free_hint_;                // no free unreserved page below it
+  off_t db_allocated_;                 // end of the preallocated db file
+  std::map<tablespace_id_t, Tablespace> tablespaces_; // under alloc_latch_
+  std::mutex map_latch_;               // protect the two below
+  // by extent number, extents not in it live in the db file
+  std::unordered_map<page_id_t, ExtentLocation> extent_map_;
+  std::vector<int> tablespace_fds_;
+  // extent_map_ is not empty, page I/O skips the lookup otherwise
+  std::atomic<bool> has_tablespaces_;
+  std::mutex hooks_latch_;             // protect the two below
+  std::map<size_t, std::function<void()>> close_hooks_;
+  size_t next_hook_id_;
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
+  // last log buffer written, to enforce swapping log buffers
+  char *buffer_used_;
 };
 
 } // namespace cmudb
\ No newline at end of file
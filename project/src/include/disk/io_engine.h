@@ -0,0 +1,52 @@
+/**
+ * io_engine.h
+ *
+ * Functionality: asynchronous positional I/O on file descriptors, so a single
+ * thread can keep many page reads and writes in flight and fast devices see
+ * the deep queues they need.
+ *
+ * The io_uring engine talks to the kernel rings directly: submitters fill
+ * submission queue entries under a latch, a completion thread reaps the
+ * completion queue and runs the callbacks. Where io_uring is not available
+ * (old kernels, seccomp filters of containers) a pool of threads doing
+ * pread/pwrite takes its place behind the same interface.
+ */
+
+#pragma once
+
+#include <functional>
+#include <sys/types.h>
+
+namespace cmudb {
+
+enum class IOEngineType { URING, THREAD_POOL };
+
+// bytes transferred, -errno if the I/O failed
+typedef std::function<void(ssize_t)> IOCallback;
+
+struct IORequest {
+  bool write;
+  int fd;
+  char *data;
+  size_t size;
+  off_t offset;
+  IOCallback callback;
+};
+
+class IOEngine {
+public:
+  // wait for the requests in flight and their callbacks
+  virtual ~IOEngine() {}
+
+  // queue request, wait if queue_depth requests are in flight already.
+  // callback runs on a completion thread of the engine, it must not wait for
+  // other I/O of the same engine
+  virtual void Submit(IORequest request) = 0;
+
+  virtual const char *GetName() const = 0;
+
+  // URING: io_uring if the kernel lets us set up a ring, threads otherwise
+  static IOEngine *Create(IOEngineType type, size_t queue_depth);
+};
+
+} // namespace cmudb
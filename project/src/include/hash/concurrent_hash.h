@@ -0,0 +1,102 @@
+/*
+ * concurrent_hash.h : open addressing hash table with lock-free lookups
+ *
+ * Functionality: Drop-in page table for the buffer pool. Slots live in one
+ * flat array, grouped by 8, so there is no heap allocation per entry and a
+ * lookup usually touches a single group. Keys are hashed to a home group and
+ * probe linearly over groups; a group with an empty slot ends the probe.
+ *
+ * Every group carries a sequence lock: writers make it odd while they modify
+ * the group, readers copy the slots they need and retry if the sequence
+ * changed meanwhile. Find therefore never takes a lock, Insert and Remove
+ * are serialized by a mutex.
+ *
+ * Remove leaves no tombstone: if the group was full, entries of later groups
+ * that probed past it are shifted back into the hole. A shifted entry is
+ * briefly in no group a reader could have seen, so shifts are covered by one
+ * more sequence lock for the whole table, which Find only checks before
+ * reporting a miss. The table is kept at most half full, so full groups and
+ * shifts are rare. When it grows, entries are rehashed into a new array; the
+ * old one is kept until the hash table is destroyed, since a concurrent Find
+ * may still be reading it.
+ *
+ * Keys and values must be trivially copyable (e.g. page_id_t and Page *).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "hash/hash_table.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+class ConcurrentHash : public HashTable<K, V> {
+  static_assert(std::is_trivially_copyable<K>::value &&
+                    std::is_trivially_copyable<V>::value,
+                "ConcurrentHash only holds trivially copyable keys/values");
+
+  static constexpr size_t GROUP_SIZE = 8;
+
+  struct Group {
+    std::atomic<uint32_t> seq;  // odd while a writer modifies the group
+    std::atomic<bool> full[GROUP_SIZE];
+    std::atomic<K> keys[GROUP_SIZE];
+    std::atomic<V> values[GROUP_SIZE];
+  };
+
+  struct Table {
+    explicit Table(size_t num_groups);
+    size_t mask;                      // number of groups - 1
+    std::unique_ptr<Group[]> groups;
+  };
+
+public:
+  // capacity: number of entries expected, the table grows beyond it
+  explicit ConcurrentHash(size_t capacity);
+
+  ~ConcurrentHash();
+
+  // disable copy
+  ConcurrentHash(const ConcurrentHash &) = delete;
+  ConcurrentHash &operator=(const ConcurrentHash &) = delete;
+
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+
+  bool Remove(const K &key) override;
+
+  void Insert(const K &key, const V &value) override;
+
+  size_t Size() const override { return size_; }
+
+  // for test: number of slots of the current array
+  size_t GetNumSlots() const;
+
+private:
+  size_t HomeGroup(const Table *table, const K &key) const;
+
+  // search one group under its sequence lock. return true if key was found,
+  // has_empty tells whether the probe ends with this group
+  bool ReadGroup(Group &group, const K &key, V &value, bool &has_empty) const;
+
+  // should be called when holding the mutex
+  void WriteBegin(std::atomic<uint32_t> &seq);
+  void WriteEnd(std::atomic<uint32_t> &seq);
+  void ShiftBack(Table *table, size_t g, size_t i);
+  void Rehash(size_t capacity);
+
+  std::atomic<Table *> table_;                  // array readers probe
+  std::atomic<uint32_t> shift_seq_;             // odd while shifting entries
+  std::vector<std::unique_ptr<Table>> tables_;  // current and retired arrays
+  std::atomic<size_t> size_;                    // key-value number in table
+  std::mutex mutex_;                            // serialize writers
+};
+
+} // namespace cmudb
@@ -29,10 +29,13 @@ enum class Operation { READONLY = 0, INSERT, DELETE };
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class BPlusTree {
 public:
+  // tablespace_id: where the nodes of a new tree live, an existing tree
+  // stays in the tablespace of its root
   explicit BPlusTree(const std::string &name,
                      BufferPoolManager *buffer_pool_manager,
                      const KeyComparator &comparator,
-                     page_id_t root_page_id = INVALID_PAGE_ID);
+                     page_id_t root_page_id = INVALID_PAGE_ID,
+                     tablespace_id_t tablespace_id = DB_TABLESPACE_ID);
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -80,6 +83,9 @@ private:
     BufferPoolManager *buffer;
   };
 
+  // read only descent, the leaf stays latched in the guard
+  ReadPageGuard FindLeafPageRead(const KeyType &key, bool leftMost);
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value,
@@ -127,6 +133,8 @@ private:
   page_id_t root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
+  // nodes are allocated from extents of the tree, scans read them in order
+  ExtentHint extent_hint_;
 };
 
 } // namespace cmudb
@@ -7,6 +7,7 @@
 
 #include "page/b_plus_tree_leaf_page.h"
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/read_ahead.h"
 
 namespace cmudb {
 
@@ -16,12 +17,15 @@ namespace cmudb {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class IndexIterator {
 public:
-  // you may define your own constructor based on your member variables
-  IndexIterator(BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *,
-                int, BufferPoolManager *);
+  // guard of the leaf page to start with, not valid for an empty tree
+  IndexIterator(ReadPageGuard &&, int, BufferPoolManager *);
 
   ~IndexIterator();
 
+  // move only, the iterator owns the latch and the pin of its leaf
+  IndexIterator(IndexIterator &&) = default;
+  IndexIterator &operator=(IndexIterator &&) = default;
+
   bool isEnd();
 
   const MappingType &operator*();
@@ -30,9 +34,11 @@ public:
 
 private:
   // add your own private member variables here
-  BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *leaf_;
+  ReadPageGuard guard_;
+  const BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *leaf_;
   int index_;
   BufferPoolManager *buff_pool_manager_;
+  ReadAhead read_ahead_;
 };
 
 } // namespace cmudb
@@ -8,10 +8,12 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <future>
 #include <mutex>
 
+#include "common/exception.h"
 #include "disk/disk_manager.h"
 #include "logging/log_record.h"
 
@@ -19,11 +21,26 @@ namespace cmudb {
 
 class LogManager {
 public:
-  explicit LogManager(DiskManager *disk_manager)
+  // log_buffer_size: size of each of the two log buffers, LogRecovery must
+  // read the log with the same size. 0 derives it from the page size of the
+  // db file, see DefaultLogBufferSize
+  // log_timeout: the flush thread flushes at least that often
+  // throw an exception if a log buffer can not hold the largest log record
+  explicit LogManager(DiskManager *disk_manager, size_t log_buffer_size = 0,
+                      std::chrono::milliseconds log_timeout = LOG_TIMEOUT)
       : promise(nullptr), flush_lsn_(0), next_lsn_(0), persistent_lsn_(INVALID_LSN),
-        offset_(0), disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+        log_failed_(false),
+        log_buffer_size_(log_buffer_size != 0
+                             ? log_buffer_size
+                             : DefaultLogBufferSize(
+                                   disk_manager->GetPageSize())),
+        log_timeout_(log_timeout), offset_(0), disk_manager_(disk_manager) {
+    if (log_buffer_size_ < MinLogBufferSize(disk_manager->GetPageSize())) {
+      throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                      "log buffer smaller than the largest log record");
+    }
+    log_buffer_ = new char[log_buffer_size_];
+    flush_buffer_ = new char[log_buffer_size_];
   }
 
   ~LogManager() {
@@ -47,12 +64,29 @@ public:
   // get/set helper functions
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
+  inline lsn_t GetNextLSN() { return next_lsn_; }
   inline char *GetLogBuffer() { return log_buffer_; }
+  inline size_t GetLogBufferSize() const { return log_buffer_size_; }
 
   inline std::promise<void> *GetPromise() { return promise; }
   inline void SetPromise(std::promise<void> *p) { promise = p; }
 
-  void WakeupFlushThread(std::promise<void> *promise);
+  bool WakeupFlushThread(std::promise<void> *promise);
+
+  // a write or sync of the log failed, log records are not made persistent
+  // any more. Commits waiting for the log fail
+  inline bool HasFailed() const { return log_failed_; }
+
+  // LOG_BUFFER_SIZE scaled to pages of page_size
+  static inline size_t DefaultLogBufferSize(size_t page_size) {
+    return LOG_BUFFER_SIZE / PAGE_SIZE * page_size;
+  }
+  // size of the largest log record, an update of a tuple filling a page of
+  // page_size: the header, the rid and two tuples with their lengths
+  static inline size_t MinLogBufferSize(size_t page_size) {
+    return LogRecord::HEADER_SIZE + sizeof(RID) +
+           2 * (sizeof(int32_t) + page_size);
+  }
 
 private:
   inline void swapBuffer();
@@ -68,15 +102,22 @@ private:
   // log records before & include persistent_lsn_ have been written to disk
   std::atomic<lsn_t> persistent_lsn_;
 
+  std::atomic<bool> log_failed_;
+
   // log buffer related
   char *log_buffer_;
   char *flush_buffer_;
+  const size_t log_buffer_size_;
+  const std::chrono::milliseconds log_timeout_;
 
   int offset_;
 
   // latch to protect shared member variables
   std::mutex latch_;
 
+  // only one force flush request can wait on `promise` at a time
+  std::mutex wakeup_latch_;
+
   // flush thread
   std::thread *flush_thread_;
 
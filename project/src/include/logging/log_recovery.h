@@ -11,18 +11,26 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
+#include "logging/log_manager.h"
 #include "logging/log_record.h"
 
 namespace cmudb {
 
 class LogRecovery {
 public:
+  // log_buffer_size must be the one of the log manager that wrote the log,
+  // 0 derives it from the page size of the db file like LogManager does
   LogRecovery(DiskManager *disk_manager,
-              BufferPoolManager *buffer_pool_manager)
+              BufferPoolManager *buffer_pool_manager,
+              size_t log_buffer_size = 0)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager),
-        offset_(0) {
+        offset_(0),
+        log_buffer_size_(log_buffer_size != 0
+                             ? log_buffer_size
+                             : LogManager::DefaultLogBufferSize(
+                                   disk_manager->GetPageSize())) {
     // global transaction through recovery phase
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_buffer_ = new char[log_buffer_size_];
   }
 
   ~LogRecovery() {
@@ -48,6 +56,7 @@ private:
 
   // log buffer related
   int offset_;
+  const size_t log_buffer_size_;
   char *log_buffer_;
 };
 
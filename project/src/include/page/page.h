@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -16,11 +17,19 @@
 
 namespace cmudb {
 
+// state of the frame holding a page, only buffer pool manager uses it
+enum class FrameState {
+  FREE = 0, // in free list
+  LOADING,  // page is being read from disk
+  READY,    // page content is valid
+  WRITING   // previous page in the frame is being written back
+};
+
 class Page {
-  friend class BufferPoolManager;
+  friend class BufferPoolInstance;
 
 public:
-  Page() { ResetMemory(); }
+  Page() {};
   ~Page() {};
 
   // disable copy
@@ -47,13 +56,21 @@ public:
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory(size_t page_size) { memset(data_, 0, page_size); }
 
   // members
-  char data_[PAGE_SIZE]; // actual data
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  int pin_count_ = 0;
-  bool is_dirty_ = false;
+  char *data_ = nullptr; // actual data, a frame of the buffer pool arena
+  // resident pages are pinned and unpinned without the latch of the buffer
+  // pool, the frame descriptor is atomic. pin_count_ is -1 while the buffer
+  // pool takes the frame over, lock-free pins back off then
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  std::atomic<int> pin_count_{0};
+  std::atomic<bool> is_dirty_{false};
+  std::atomic<FrameState> state_{FrameState::FREE};
+  // fetched since the replacer last heard of the frame
+  std::atomic<bool> accessed_{false};
+  // waiting in the queue of frames the replacer has to hear of
+  std::atomic<bool> queued_{false};
   RWMutex rwlatch_;
 };
 
@@ -24,9 +24,11 @@ public:
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
             LogManager *log_manager, page_id_t first_page_id);
 
-  // create table heap
+  // create table heap, with its pages in a tablespace of its own or the db
+  // file
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, Transaction *txn);
+            LogManager *log_manager, Transaction *txn,
+            tablespace_id_t tablespace_id = DB_TABLESPACE_ID);
 
   // for insert, if tuple is too large (>~page_size), return false
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn);
@@ -44,9 +46,13 @@ public:
 
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
 
+  // drops the tablespace of the table, if any
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  // a scan given a buffer ring only recycles the ring's frames, use it for
+  // tables much larger than the ring so they do not flush the pool
+  TableIterator begin(Transaction *txn,
+                      std::shared_ptr<BufferRing> ring = nullptr);
 
   TableIterator end();
 
@@ -60,6 +66,8 @@ private:
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_;
+  // pages are allocated from extents of the table, scans read them in order
+  ExtentHint extent_hint_;
 };
 
 } // namespace cmudb
@@ -8,6 +8,7 @@
 
 #include <cassert>
 
+#include "buffer/read_ahead.h"
 #include "common/rid.h"
 #include "table/tuple.h"
 
@@ -19,7 +20,8 @@ class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                std::shared_ptr<BufferRing> ring = nullptr);
 
   ~TableIterator() { delete tuple_; }
 
@@ -43,6 +45,8 @@ private:
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  std::shared_ptr<BufferRing> ring_;   // pages are read through it if set
+  ReadAhead read_ahead_;
 };
 
 } // namespace cmudb
\ No newline at end of file
@@ -59,20 +59,70 @@ int VtabCommit(sqlite3_vtab *pVTab);
 
 int VtabBegin(sqlite3_vtab *pVTab);
 
+// storage engine options, chosen at open time, defaults from common/config.h
+struct StorageEngineOptions {
+  size_t buffer_pool_size = BUFFER_POOL_SIZE;
+  // frames reserved for BufferPoolManager::Resize, 0 means buffer_pool_size
+  size_t max_buffer_pool_size = 0;
+  size_t buffer_pool_instances = 1;
+  // bytes of compressed clean pages kept below the pool, 0 disables it
+  size_t compressed_cache_size = 0;
+  ReplacerType replacer_type = ReplacerType::LRU;
+  bool direct_io = false;
+  // when writes to the db file and the log file become durable, a commit is
+  // only durable with a log_sync of ALWAYS or DSYNC
+  SyncMode data_sync = SyncMode::NONE;
+  SyncMode log_sync = SyncMode::ALWAYS;
+  // page size of a new db file, an existing file keeps its own
+  size_t page_size = PAGE_SIZE;
+  // a log written with one size must be recovered with the same size. 0
+  // derives it from the page size of the db file, a smaller size than the
+  // largest log record (two tuples of a page) is rejected
+  size_t log_buffer_size = 0;
+  std::chrono::milliseconds log_timeout = LOG_TIMEOUT;
+  // sidecar file of the resident page ids, dumped periodically and at
+  // shutdown, read back at startup. empty disables warm-up
+  std::string page_set_file;
+  std::chrono::milliseconds page_set_dump_interval = PAGE_SET_DUMP_INTERVAL;
+  // serve requests while warming up instead of waiting for it
+  bool background_warm_up = false;
+};
+
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  StorageEngine(std::string db_file_name,
+                const StorageEngineOptions &options = StorageEngineOptions())
+      : options_(options) {
     ENABLE_LOGGING = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, options.direct_io,
+                                    options.page_size, IOEngineType::URING,
+                                    options.data_sync, options.log_sync);
 
     // log related
-    log_manager_ = new LogManager(disk_manager_);
+    try {
+      log_manager_ = new LogManager(disk_manager_, options.log_buffer_size,
+                                    options.log_timeout);
+    } catch (...) {
+      delete disk_manager_;
+      throw;
+    }
 
-    buffer_pool_manager_ =
-        new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    buffer_pool_manager_ = new BufferPoolManager(
+        options.buffer_pool_size, disk_manager_, log_manager_,
+        options.buffer_pool_instances, options.replacer_type,
+        options.max_buffer_pool_size, options.compressed_cache_size);
+    if (!options.page_set_file.empty()) {
+      if (options.background_warm_up) {
+        buffer_pool_manager_->WarmUpInBackground(options.page_set_file);
+      } else {
+        buffer_pool_manager_->WarmUp(options.page_set_file);
+      }
+      buffer_pool_manager_->RunPageSetDumpThread(
+          options.page_set_file, options.page_set_dump_interval);
+    }
 
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
@@ -80,15 +130,17 @@ public:
   }
 
   ~StorageEngine() {
+    buffer_pool_manager_->FlushAllPages();
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
     delete buffer_pool_manager_;
     delete log_manager_;
+    delete disk_manager_;
     delete lock_manager_;
     delete transaction_manager_;
   }
 
+  const StorageEngineOptions options_;
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
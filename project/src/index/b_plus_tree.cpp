@@ -2,6 +2,7 @@
  * b_plus_tree.cpp
  */
 
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -18,9 +19,14 @@ BPlusTree<KeyType, ValueType, KeyComparator>::
 BPlusTree(const std::string &name,
           BufferPoolManager *buffer_pool_manager,
           const KeyComparator &comparator,
-          page_id_t root_page_id)
+          page_id_t root_page_id, tablespace_id_t tablespace_id)
     : index_name_(name), root_page_id_(root_page_id),
-      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {
+  extent_hint_.tablespace_id =
+      root_page_id == INVALID_PAGE_ID
+          ? tablespace_id
+          : buffer_pool_manager->GetTablespaceId(root_page_id);
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 thread_local bool BPlusTree<KeyType, ValueType, KeyComparator>::root_is_locked = false;
@@ -49,27 +55,18 @@ GetValue(const KeyType &key, std::vector<ValueType> &result,
   // for debug
   //__attribute__((unused)) auto checker = Checker{buffer_pool_manager_};
 
-  auto *leaf = FindLeafPage(key, false, Operation::READONLY, transaction);
-  bool ret = false;
-  if (leaf != nullptr) {
-    ValueType value;
-    if (leaf->Lookup(key, value, comparator_)) {
-      result.push_back(value);
-      ret = true;
-    }
-    UnlockUnpinPages(Operation::READONLY, transaction);
-
-    // in case of `transaction` is nullptr
-    if (transaction == nullptr) {
-      auto page_id = leaf->GetPageId();
-      // unlock and unpin
-      buffer_pool_manager_->FetchPage(page_id)->RUnlatch();
-      buffer_pool_manager_->UnpinPage(page_id, false);
-      // unpin again
-      buffer_pool_manager_->UnpinPage(page_id, false);
-    }
+  auto guard = FindLeafPageRead(key, false);
+  if (!guard.IsValid()) {
+    return false;
   }
-  return ret;
+  auto *leaf = guard.template As<
+      BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>>();
+  ValueType value;
+  if (leaf->Lookup(key, value, comparator_)) {
+    result.push_back(value);
+    return true;
+  }
+  return false;
 }
 
 /*****************************************************************************
@@ -109,7 +106,8 @@ Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void BPlusTree<KeyType, ValueType, KeyComparator>::
 StartNewTree(const KeyType &key, const ValueType &value) {
-  auto *page = buffer_pool_manager_->NewPage(root_page_id_);
+  auto *page = buffer_pool_manager_->NewPage(root_page_id_, nullptr,
+                                             &extent_hint_);
   if (page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while StartNewTree");
@@ -118,7 +116,8 @@ StartNewTree(const KeyType &key, const ValueType &value) {
       reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
                                          KeyComparator> *>(page->GetData());
   UpdateRootPageId(true);
-  root->Init(root_page_id_, INVALID_PAGE_ID);
+  root->Init(root_page_id_, INVALID_PAGE_ID,
+             buffer_pool_manager_->GetPageSize());
   root->Insert(key, value, comparator_);
 
   // unpin root
@@ -195,13 +194,14 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 template <typename N> N *BPlusTree<KeyType, ValueType, KeyComparator>::
 Split(N *node) {
   page_id_t page_id;
-  auto *page = buffer_pool_manager_->NewPage(page_id);
+  auto *page = buffer_pool_manager_->NewPage(page_id, nullptr, &extent_hint_);
   if (page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while Split");
   }
   auto new_node = reinterpret_cast<N *>(page->GetData());
-  new_node->Init(page_id);
+  new_node->Init(page_id, INVALID_PAGE_ID,
+                 buffer_pool_manager_->GetPageSize());
 
   node->MoveHalfTo(new_node, buffer_pool_manager_);
   return new_node;
@@ -221,7 +221,8 @@ void BPlusTree<KeyType, ValueType, KeyComparator>::
 InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
                  BPlusTreePage *new_node, Transaction *transaction) {
   if (old_node->IsRootPage()) {
-    auto *page = buffer_pool_manager_->NewPage(root_page_id_);
+    auto *page = buffer_pool_manager_->NewPage(root_page_id_, nullptr,
+                                               &extent_hint_);
     if (page == nullptr) {
       throw Exception(EXCEPTION_TYPE_INDEX,
                       "all page are pinned while InsertIntoParent");
@@ -230,7 +231,8 @@ InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
     auto root =
         reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t,
                                                KeyComparator> *>(page->GetData());
-    root->Init(root_page_id_);
+    root->Init(root_page_id_, INVALID_PAGE_ID,
+               buffer_pool_manager_->GetPageSize());
     root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
 
     old_node->SetParentPageId(root_page_id_);
@@ -265,7 +267,8 @@ InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
       // internal have no space and have to split
       // first make a copy of internal node, simplify split process
       page_id_t page_id;
-      auto *page = buffer_pool_manager_->NewPage(page_id);
+      auto *page =
+          buffer_pool_manager_->NewPage(page_id, nullptr, &extent_hint_);
       if (page == nullptr) {
         throw Exception(EXCEPTION_TYPE_INDEX,
                         "all page are pinned while InsertIntoParent");
@@ -277,7 +280,8 @@ InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
       auto *copy =
           reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t,
                                                  KeyComparator> *>(page->GetData());
-      copy->Init(page_id);
+      copy->Init(page_id, INVALID_PAGE_ID,
+                 buffer_pool_manager_->GetPageSize());
       copy->SetSize(internal->GetSize());
       for (int i = 1, j = 0; i <= internal->GetSize(); ++i, ++j) {
         if (internal->ValueAt(i - 1) == old_node->GetPageId()) {
@@ -593,7 +597,7 @@ IndexIterator<KeyType, ValueType, KeyComparator> BPlusTree<KeyType, ValueType, K
 Begin() {
   KeyType key{};
   return IndexIterator<KeyType, ValueType, KeyComparator>(
-      FindLeafPage(key, true), 0, buffer_pool_manager_);
+      FindLeafPageRead(key, true), 0, buffer_pool_manager_);
 }
 
 /*
@@ -604,13 +608,15 @@ Begin() {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType, ValueType, KeyComparator> BPlusTree<KeyType, ValueType, KeyComparator>::
 Begin(const KeyType &key) {
-  auto *leaf = FindLeafPage(key, false);
+  auto guard = FindLeafPageRead(key, false);
   int index = 0;
-  if (leaf != nullptr) {
-    index = leaf->KeyIndex(key, comparator_);
+  if (guard.IsValid()) {
+    index = guard.template As<
+        BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>>()->KeyIndex(
+            key, comparator_);
   }
   return IndexIterator<KeyType, ValueType, KeyComparator>(
-      leaf, index, buffer_pool_manager_);
+      std::move(guard), index, buffer_pool_manager_);
 }
 
 /*****************************************************************************
@@ -761,6 +767,52 @@ FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *trans
                                             ValueType, KeyComparator> *>(node);
 }
 
+/*
+ * Read only descent for point queries and index iterators, the child is
+ * latched before the parent is released (latch crabbing)
+ * @return: guard of the leaf page containing key (or of the left most leaf if
+ * leftMost == true), not valid if the tree is empty
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+ReadPageGuard BPlusTree<KeyType, ValueType, KeyComparator>::
+FindLeafPageRead(const KeyType &key, bool leftMost) {
+  // empty B+ tree?
+  if (IsEmpty()) {
+    return ReadPageGuard();
+  }
+
+  // walk from root node
+  auto guard = buffer_pool_manager_->FetchPageRead(root_page_id_);
+  if (!guard.IsValid()) {
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "all page are pinned while FindLeafPage");
+  }
+  auto *node = guard.template As<BPlusTreePage>();
+  while (!node->IsLeafPage()) {
+    auto internal = reinterpret_cast<
+        const BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(node);
+    page_id_t child_page_id;
+    if (leftMost) {
+      child_page_id = internal->ValueAt(0);
+    } else {
+      child_page_id = internal->Lookup(key, comparator_);
+    }
+
+    auto child = buffer_pool_manager_->FetchPageRead(child_page_id);
+    if (!child.IsValid()) {
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "all page are pinned while FindLeafPage");
+    }
+    // sanity check, parent page id must match
+    assert(child.template As<BPlusTreePage>()->GetParentPageId() ==
+           node->GetPageId());
+    // release parent
+    guard = std::move(child);
+    node = guard.template As<BPlusTreePage>();
+  }
+  return guard;
+}
+
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
@@ -772,12 +824,12 @@ FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *trans
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void BPlusTree<KeyType, ValueType, KeyComparator>::
 UpdateRootPageId(bool insert_record) {
-  auto *page = buffer_pool_manager_->FetchPage(HEADER_PAGE_ID);
-  if (page == nullptr) {
+  auto guard = buffer_pool_manager_->FetchPageWrite(HEADER_PAGE_ID);
+  if (!guard.IsValid()) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while UpdateRootPageId");
   }
-  auto *header_page = reinterpret_cast<HeaderPage *>(page->GetData());
+  auto *header_page = static_cast<HeaderPage *>(guard.GetPage());
 
   if (insert_record) {
     // create a new record<index_name + root_page_id> in header_page
@@ -786,7 +838,6 @@ UpdateRootPageId(bool insert_record) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
 /*
@@ -801,12 +852,12 @@ ToString(bool verbose) {
   }
   std::queue<BPlusTreePage *> todo, tmp;
   std::stringstream tree;
-  auto node = reinterpret_cast<BPlusTreePage *>(
-      buffer_pool_manager_->FetchPage(root_page_id_));
-  if (node == nullptr) {
+  auto *root = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (root == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while printing");
   }
+  auto node = reinterpret_cast<BPlusTreePage *>(root->GetData());
   todo.push(node);
   bool first = true;
   while (!todo.empty()) {
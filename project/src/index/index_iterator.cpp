@@ -13,17 +13,21 @@ namespace cmudb {
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType, ValueType, KeyComparator>::
-IndexIterator(BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *leaf,
-              int index_, BufferPoolManager *buff_pool_manager):
-    leaf_(leaf), index_(index_), buff_pool_manager_(buff_pool_manager) {}
+IndexIterator(ReadPageGuard &&guard, int index_,
+              BufferPoolManager *buff_pool_manager):
+    guard_(std::move(guard)), leaf_(nullptr), index_(index_),
+    buff_pool_manager_(buff_pool_manager), read_ahead_(buff_pool_manager) {
+  if (guard_.IsValid()) {
+    leaf_ = guard_.As<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>>();
+  }
+}
 
+/*
+ * the guard releases the leaf
+ */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType, ValueType, KeyComparator>::
-~IndexIterator() {
-  buff_pool_manager_->FetchPage(leaf_->GetPageId())->RUnlatch();
-  buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-  buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-};
+~IndexIterator() = default;
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool IndexIterator<KeyType, ValueType, KeyComparator>::
@@ -44,29 +48,26 @@ operator*() {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType, ValueType, KeyComparator> &IndexIterator<KeyType, ValueType, KeyComparator>::
 operator++() {
+  read_ahead_.OnPage(leaf_->GetPageId(), leaf_->GetNextPageId());
   ++index_;
   if (index_ == leaf_->GetSize() && leaf_->GetNextPageId() != INVALID_PAGE_ID) {
     // first unpin leaf_, then get the next leaf
     page_id_t next_page_id = leaf_->GetNextPageId();
 
-    auto *page = buff_pool_manager_->FetchPage(next_page_id);
-    if (page == nullptr) {
+    auto guard = buff_pool_manager_->FetchPageRead(next_page_id);
+    if (!guard.IsValid()) {
       throw Exception(EXCEPTION_TYPE_INDEX,
                       "all page are pinned while IndexIterator(operator++)");
     }
     // first acquire next page, then release previous page
-    page->RLatch();
-
-    buff_pool_manager_->FetchPage(leaf_->GetPageId())->RUnlatch();
-    buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-    buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
+    guard_ = std::move(guard);
 
-    auto next_leaf =
-        reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
-                                           KeyComparator> *>(page->GetData());
+    auto next_leaf = guard_.As<
+        BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>>();
     assert(next_leaf->IsLeafPage());
     index_ = 0;
     leaf_ = next_leaf;
+    read_ahead_.OnPage(leaf_->GetPageId(), leaf_->GetNextPageId());
   }
   return *this;
 };
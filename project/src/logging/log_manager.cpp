@@ -20,22 +20,30 @@ void LogManager::RunFlushThread() {
       while (ENABLE_LOGGING) {
         std::unique_lock<std::mutex> lock(latch_);
         // timeout?
-        if (cv_.wait_for(lock, LOG_TIMEOUT) == std::cv_status::timeout &&
+        if (cv_.wait_for(lock, log_timeout_) == std::cv_status::timeout &&
             offset_ != 0) {
           swapBuffer();
         }
         lsn_t delta = flush_lsn_;
+        // a waiter is woken up once, whether or not the log was written
+        std::promise<void> *waiter = promise;
+        promise = nullptr;
         lock.unlock();
 
         if (ENABLE_LOGGING && !disk_manager_->GetFlushState()
-            && persistent_lsn_ + 1 != next_lsn_) {
-          disk_manager_->WriteLog(flush_buffer_, LOG_BUFFER_SIZE);
-          SetPersistentLSN(delta);
-
-          if (promise != nullptr) {
-            promise->set_value();
+            && persistent_lsn_ + 1 != next_lsn_ && !log_failed_) {
+          // the log has a hole after a failed write or sync, nothing
+          // written after it becomes persistent
+          if (disk_manager_->WriteLog(flush_buffer_, log_buffer_size_)) {
+            SetPersistentLSN(delta);
+          } else {
+            log_failed_ = true;
           }
         }
+
+        if (waiter != nullptr) {
+          waiter->set_value();
+        }
       }
     });
   }
@@ -73,8 +81,12 @@ inline void LogManager::swapBuffer() {
 /*
  * wake up flush thread, only called by buffer pool manager
  * when it wants to force flush
+ * @return: false if the log has failed, the persistent lsn does not move any
+ * more
  */
-void LogManager::WakeupFlushThread(std::promise<void> *promise) {
+bool LogManager::WakeupFlushThread(std::promise<void> *promise) {
+  // buffer pool instances may force flush concurrently
+  std::lock_guard<std::mutex> wakeup(wakeup_latch_);
   {
     std::lock_guard<std::mutex> lock(latch_);
     swapBuffer();
@@ -89,6 +101,7 @@ void LogManager::WakeupFlushThread(std::promise<void> *promise) {
     promise->get_future().wait();
   }
   SetPromise(nullptr);
+  return !log_failed_;
 }
 
 /*
@@ -113,9 +126,10 @@ void LogManager::WakeupFlushThread(std::promise<void> *promise) {
  */
 lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
   std::lock_guard<std::mutex> lock(latch_);
+  assert(log_record.size_ <= static_cast<int>(log_buffer_size_));
 
   // log_buffer is almost full?
-  if (offset_ + log_record.size_ > LOG_BUFFER_SIZE) {
+  if (offset_ + log_record.size_ > static_cast<int>(log_buffer_size_)) {
     swapBuffer();
     // wake up flush thread
     cv_.notify_one();
@@ -2,6 +2,8 @@
  * log_recovery.cpp
  */
 
+#include <vector>
+
 #include "logging/log_recovery.h"
 #include "page/table_page.h"
 
@@ -21,7 +23,9 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
   lsn_t prev_lsn_ = *reinterpret_cast<const lsn_t *>(data + 12);
   LogRecordType log_record_type_ = *reinterpret_cast<const LogRecordType *>(data + 16);
 
-  if (size_ < 0 || lsn_ == INVALID_LSN || txn_id_ == INVALID_TXN_ID ||
+  // log buffers are flushed as a whole, stale bytes after the last record
+  // must not be taken as a (zero sized) record
+  if (size_ < LogRecord::HEADER_SIZE || lsn_ == INVALID_LSN || txn_id_ == INVALID_TXN_ID ||
       log_record_type_ == LogRecordType::INVALID) {
     return false;
   }
@@ -78,10 +82,12 @@ void LogRecovery::Redo() {
   assert(ENABLE_LOGGING == false);
 
   // have more log?
-  while (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_)) {
+  while (disk_manager_->ReadLog(log_buffer_, log_buffer_size_, offset_)) {
     LogRecord log;
     int buffer_offset_ = 0;
-    while (DeserializeLogRecord(log_buffer_ + buffer_offset_, log)) {
+    while (buffer_offset_ + LogRecord::HEADER_SIZE <=
+               static_cast<int>(log_buffer_size_) &&
+           DeserializeLogRecord(log_buffer_ + buffer_offset_, log)) {
       // lsn -> offset mapping in WAL log
       lsn_mapping_[log.GetLSN()] = offset_ + buffer_offset_;
 
@@ -95,31 +101,29 @@ void LogRecovery::Redo() {
         // Begin and NewPage logs can be ignored
         if (log.GetLogRecordType() == LogRecordType::INSERT) {
           RID rid = log.GetInsertRID();
-          auto *page = reinterpret_cast<TablePage *>(
-              buffer_pool_manager_->FetchPage(rid.GetPageId()));
-          assert(page != nullptr);
+          auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+          assert(guard.IsValid());
+          auto *page = static_cast<TablePage *>(guard.GetPage());
 
           // log is newer than disk page?
+          guard.SetDirty(log.GetLSN() > page->GetLSN());
           if (log.GetLSN() > page->GetLSN()) {
-            page->WLatch();
             auto res = page->InsertTuple(log.GetInserteTuple(), rid, nullptr, nullptr, nullptr);
             assert(res);
-            page->WUnlatch();
           }
-          buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
 
         } else if (log.GetLogRecordType() == LogRecordType::MARKDELETE ||
             log.GetLogRecordType() == LogRecordType::ROLLBACKDELETE ||
             log.GetLogRecordType() == LogRecordType::APPLYDELETE) {
           RID rid = log.GetDeleteRID();
 
-          auto *page = reinterpret_cast<TablePage *>(
-              buffer_pool_manager_->FetchPage(rid.GetPageId()));
-          assert(page != nullptr);
+          auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+          assert(guard.IsValid());
+          auto *page = static_cast<TablePage *>(guard.GetPage());
 
           // log is newer than disk page?
+          guard.SetDirty(log.GetLSN() > page->GetLSN());
           if (log.GetLSN() > page->GetLSN()) {
-            page->WLatch();
             if (log.GetLogRecordType() == LogRecordType::MARKDELETE) {
               auto res = page->MarkDelete(rid, nullptr, nullptr, nullptr);
               assert(res);
@@ -128,62 +132,52 @@ void LogRecovery::Redo() {
             } else {
               page->ApplyDelete(rid, nullptr, nullptr);
             }
-            page->WUnlatch();
           }
-          buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
 
         } else if (log.GetLogRecordType() == LogRecordType::UPDATE) {
           RID rid = log.GetUpdateRID();
-          auto *page = reinterpret_cast<TablePage *>(
-              buffer_pool_manager_->FetchPage(rid.GetPageId()));
-          assert(page != nullptr);
+          auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+          assert(guard.IsValid());
+          auto *page = static_cast<TablePage *>(guard.GetPage());
 
           // log is newer than disk page?
+          guard.SetDirty(log.GetLSN() > page->GetLSN());
           if (log.GetLSN() > page->GetLSN()) {
-            page->WLatch();
             auto res = page->UpdateTuple(log.GetUpdateNewTuple(), log.GetUpdateOldTuple(),
                                          rid, nullptr, nullptr, nullptr);
             assert(res);
-            page->WUnlatch();
           }
-          buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
 
         } else if (log.GetLogRecordType() == LogRecordType::NEWPAGE) {
           page_id_t pre_page_id = log.prev_page_id_;
-          TablePage *page;
 
           // the first page
           if (pre_page_id == INVALID_PAGE_ID) {
-            page = reinterpret_cast<TablePage *>(
-                buffer_pool_manager_->NewPage(pre_page_id));
-            assert(page != nullptr);
-            page->WLatch();
-            page->Init(pre_page_id, PAGE_SIZE, INVALID_PAGE_ID, nullptr, nullptr);
-            page->WUnlatch();
+            auto guard = buffer_pool_manager_->NewPageGuarded(pre_page_id);
+            assert(guard.IsValid());
+            static_cast<TablePage *>(guard.GetPage())
+                ->Init(pre_page_id, buffer_pool_manager_->GetPageSize(),
+                       INVALID_PAGE_ID, nullptr, nullptr);
           } else {
-            page = reinterpret_cast<TablePage *>(
-                buffer_pool_manager_->FetchPage(pre_page_id));
-            assert(page != nullptr);
+            auto guard = buffer_pool_manager_->FetchPageWrite(pre_page_id);
+            assert(guard.IsValid());
+            auto *page = static_cast<TablePage *>(guard.GetPage());
 
             if (page->GetNextPageId() == INVALID_PAGE_ID) {
               // alloc a new page
               page_id_t new_page_id;
-              auto *new_page = reinterpret_cast<TablePage *>(
-                  buffer_pool_manager_->NewPage(new_page_id));
+              auto *new_page = buffer_pool_manager_->NewPage(new_page_id);
               assert(new_page != nullptr);
-              page->WLatch();
               page->SetNextPageId(new_page_id);
-              page->WUnlatch();
 
-              buffer_pool_manager_->UnpinPage(new_page_id, false);
+              buffer_pool_manager_->UnpinPage(new_page, false);
             }
           }
-          buffer_pool_manager_->UnpinPage(pre_page_id, true);
         }
       }
       buffer_offset_ += log.GetSize();
     }
-    offset_ += LOG_BUFFER_SIZE;
+    offset_ += log_buffer_size_;
   }
 }
 
@@ -195,14 +189,16 @@ void LogRecovery::Undo() {
   // ENABLE_LOGGING must be false when recovery
   assert(ENABLE_LOGGING == false);
 
-  char buffer[PAGE_SIZE];
+  // a log record holds at most a tuple, no larger than a page
+  std::vector<char> record(buffer_pool_manager_->GetPageSize());
+  char *buffer = record.data();
 
   for (auto it = active_txn_.begin(); it != active_txn_.end(); ++it) {
     auto offset_ = lsn_mapping_[it->second];
     LogRecord log;
 
     // read log record, undo it, then get the pre_lsn
-    disk_manager_->ReadLog(buffer, offset_, PAGE_SIZE);
+    disk_manager_->ReadLog(buffer, record.size(), offset_);
     while (DeserializeLogRecord(buffer, log)) {
       if (log.log_record_type_ == LogRecordType::BEGIN) {
         // current txn is done
@@ -212,22 +208,20 @@ void LogRecovery::Undo() {
       // undo
       if (log.log_record_type_ == LogRecordType::INSERT) {
         RID rid = log.GetInsertRID();
-        auto *page = reinterpret_cast<TablePage *>(
-            buffer_pool_manager_->FetchPage(rid.GetPageId()));
-        page->WLatch();
-        page->ApplyDelete(rid, nullptr, nullptr);
-        page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+        auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+        assert(guard.IsValid());
+        static_cast<TablePage *>(guard.GetPage())
+            ->ApplyDelete(rid, nullptr, nullptr);
 
       } else if (log.log_record_type_ == LogRecordType::MARKDELETE ||
           log.log_record_type_ == LogRecordType::ROLLBACKDELETE ||
           log.log_record_type_ == LogRecordType::APPLYDELETE) {
 
         RID rid = log.GetDeleteRID();
-        auto *page = reinterpret_cast<TablePage *>(
-            buffer_pool_manager_->FetchPage(rid.GetPageId()));
+        auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+        assert(guard.IsValid());
+        auto *page = static_cast<TablePage *>(guard.GetPage());
 
-        page->WLatch();
         if (log.log_record_type_ == LogRecordType::MARKDELETE) {
           page->RollbackDelete(rid, nullptr, nullptr);
         } else if (log.log_record_type_ == LogRecordType::ROLLBACKDELETE) {
@@ -235,24 +229,18 @@ void LogRecovery::Undo() {
         } else {
           page->InsertTuple(log.delete_tuple_, rid, nullptr, nullptr, nullptr);
         }
-        page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
 
       } else if (log.log_record_type_ == LogRecordType::UPDATE) {
         RID rid = log.GetUpdateRID();
-        auto *page = reinterpret_cast<TablePage *>(
-            buffer_pool_manager_->FetchPage(rid.GetPageId()));
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
-
-        page->WLatch();
-        page->UpdateTuple(log.old_tuple_, log.new_tuple_, rid,
-                          nullptr, nullptr, nullptr);
-        page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+        auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+        assert(guard.IsValid());
+        static_cast<TablePage *>(guard.GetPage())
+            ->UpdateTuple(log.old_tuple_, log.new_tuple_, rid, nullptr, nullptr,
+                          nullptr);
       }
 
       offset_ = lsn_mapping_[log.prev_lsn_];
-      disk_manager_->ReadLog(buffer, offset_, PAGE_SIZE);
+      disk_manager_->ReadLog(buffer, record.size(), offset_);
     }
   }
 
@@ -23,7 +23,7 @@ namespace cmudb {
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>::
-Init(page_id_t page_id, page_id_t parent_id) {
+Init(page_id_t page_id, page_id_t parent_id, size_t page_size) {
 // set page type
   SetPageType(IndexPageType::LEAF_PAGE);
   // set current size: 1 for the first invalid key
@@ -36,7 +36,7 @@ Init(page_id_t page_id, page_id_t parent_id) {
   SetNextPageId(INVALID_PAGE_ID);
 
   // set max page size, header is 28bytes
-  int size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage))/
+  int size = (page_size - sizeof(BPlusTreeLeafPage))/
       (sizeof(KeyType) + sizeof(ValueType));
   SetMaxSize(size);
 }
@@ -89,7 +89,7 @@ KeyAt(int index) const {
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 const MappingType &BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>::
-GetItem(int index) {
+GetItem(int index) const {
   // replace with your own code
   assert(0 <= index && index < GetSize());
   return array[index];
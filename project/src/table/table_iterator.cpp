@@ -8,8 +8,10 @@
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             std::shared_ptr<BufferRing> ring)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), ring_(ring),
+      read_ahead_(table_heap->buffer_pool_manager_, std::move(ring)) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
   }
@@ -27,33 +29,34 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  assert(cur_page != nullptr); // all pages are pinned
-  cur_page->RLatch();
+  auto guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId(),
+                                                  ring_.get());
+  assert(guard.IsValid()); // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(guard.GetPage());
+  read_ahead_.OnPage(cur_page->GetPageId(), cur_page->GetNextPageId());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      // first acquire next page, then release current page
+      guard = buffer_pool_manager->FetchPageRead(cur_page->GetNextPageId(),
+                                                 ring_.get());
+      assert(guard.IsValid());
+      cur_page = static_cast<TablePage *>(guard.GetPage());
+      read_ahead_.OnPage(cur_page->GetPageId(), cur_page->GetNextPageId());
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
   }
   tuple_->rid_ = next_tuple_rid;
 
+  // the tuple is on the page already latched, no need to fetch it again
   if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    cur_page->GetTuple(tuple_->rid_, *tuple_, txn_,
+                       table_heap_->lock_manager_);
   }
   // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
   return *this;
 }
 
@@ -313,13 +313,13 @@ int VtabCommit(sqlite3_vtab *pVTab) {
     return SQLITE_OK;
   // get global txn manager
   auto transaction_manager = storage_engine_->transaction_manager_;
-  // invoke transaction manager to commit(this txn can't fail)
-  transaction_manager->Commit(transaction);
+  // invoke transaction manager to commit, it only fails if the log does
+  bool durable = transaction_manager->Commit(transaction);
   // when commit, delete transaction pointer and set to null
   delete transaction;
   global_transaction_ = nullptr;
 
-  return SQLITE_OK;
+  return durable ? SQLITE_OK : SQLITE_IOERR;
 }
 
 sqlite3_module VtableModule = {
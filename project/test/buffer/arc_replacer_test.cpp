@@ -0,0 +1,149 @@
+/**
+ * arc_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/arc_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ARCReplacerTest, SampleTest) {
+  ARCReplacer<int> arc_replacer(4, 0);
+
+  // frame i holds page 10 + i, every page seen once
+  for (int i = 0; i < 4; ++i) {
+    arc_replacer.RecordAccess(i, 10 + i);
+    arc_replacer.Insert(i);
+  }
+  EXPECT_EQ(4, arc_replacer.Size());
+
+  // page 11 seen twice, T1: 0 2 3, T2: 1
+  EXPECT_EQ(true, arc_replacer.Erase(1));
+  arc_replacer.RecordAccess(1, 11);
+  arc_replacer.Insert(1);
+
+  // p = 0, evict from T1
+  int value;
+  arc_replacer.Victim(value);
+  EXPECT_EQ(0, value);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+
+  // page 10 comes back from B1, T1 should have been larger
+  arc_replacer.RecordAccess(0, 10);
+  arc_replacer.Insert(0);
+  EXPECT_EQ(1, arc_replacer.GetGhostHitCount());
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+
+  // T1: 2 3 is larger than p
+  arc_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  arc_replacer.RecordAccess(2, 14);
+  arc_replacer.Insert(2);
+  arc_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+
+  // T1: 2 is not larger than p, T2: 1 0
+  arc_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+
+  // page 11 comes back from B2, T2 should have been larger
+  arc_replacer.RecordAccess(1, 11);
+  arc_replacer.Insert(1);
+  EXPECT_EQ(2, arc_replacer.GetGhostHitCount());
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+  EXPECT_EQ(3, arc_replacer.Size());
+}
+
+TEST(ARCReplacerTest, PinnedTest) {
+  ARCReplacer<int> arc_replacer(3, 0);
+
+  for (int i = 0; i < 3; ++i) {
+    arc_replacer.RecordAccess(i, i);
+  }
+  // nothing unpinned yet
+  int value;
+  EXPECT_EQ(false, arc_replacer.Victim(value));
+
+  // frame 2 moves to T2 and is the only evictable one
+  arc_replacer.RecordAccess(2, 2);
+  arc_replacer.Insert(2);
+  EXPECT_EQ(1, arc_replacer.Size());
+  EXPECT_EQ(true, arc_replacer.Victim(value));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(false, arc_replacer.Victim(value));
+
+  // skip pinned frames at the LRU end
+  arc_replacer.Insert(1);
+  EXPECT_EQ(false, arc_replacer.Erase(0));
+  EXPECT_EQ(true, arc_replacer.Victim(value));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(0, arc_replacer.Size());
+}
+
+TEST(ARCReplacerTest, CorrelatedTest) {
+  ARCReplacer<int> arc_replacer(4, 2);
+
+  // frame 0 is accessed twice far apart, frame 1 in a burst
+  arc_replacer.RecordAccess(0, 0);
+  for (int i = 2; i < 4; ++i) {
+    arc_replacer.RecordAccess(i, i);
+  }
+  arc_replacer.RecordAccess(0, 0);
+  for (int i = 0; i < 10; ++i) {
+    arc_replacer.RecordAccess(1, 1);
+  }
+  for (int i = 0; i < 4; ++i) {
+    arc_replacer.Insert(i);
+  }
+
+  // T1: 2 3 1, T2: 0
+  int value;
+  for (int i : {2, 3, 1, 0}) {
+    EXPECT_EQ(true, arc_replacer.Victim(value));
+    EXPECT_EQ(i, value);
+  }
+}
+
+TEST(ARCReplacerTest, VictimForTest) {
+  ARCReplacer<int> arc_replacer(6, 0);
+
+  // frame i holds page 10 + i, every page seen once
+  for (int i = 0; i < 6; ++i) {
+    arc_replacer.RecordAccess(i, 10 + i);
+    arc_replacer.Insert(i);
+  }
+  int value;
+  EXPECT_EQ(true, arc_replacer.Victim(value));
+  EXPECT_EQ(0, value);
+
+  // pages 10, 11 and 12 come back from B1, p grows before each victim
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(true, arc_replacer.VictimFor(value, 10 + i));
+    EXPECT_EQ(i + 1, arc_replacer.GetTarget());
+    arc_replacer.RecordAccess(value, 10 + i);
+    arc_replacer.Insert(value);
+  }
+  // T1 was larger than p twice, then p = 3 evicted page 10 from T2
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(3, arc_replacer.GetGhostHitCount());
+  EXPECT_EQ(3, arc_replacer.GetTarget());
+
+  // page 13 seen twice, T1: 4 5, T2: 2 1 3
+  EXPECT_EQ(true, arc_replacer.Erase(3));
+  arc_replacer.RecordAccess(3, 13);
+  arc_replacer.Insert(3);
+
+  // page 10 comes back from B2, p shrinks to |T1| and T1 gives the victim
+  EXPECT_EQ(true, arc_replacer.VictimFor(value, 10));
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(2, arc_replacer.GetTarget());
+  arc_replacer.RecordAccess(value, 10);
+  arc_replacer.Insert(value);
+  EXPECT_EQ(4, arc_replacer.GetGhostHitCount());
+  EXPECT_EQ(2, arc_replacer.GetTarget());
+  EXPECT_EQ(5, arc_replacer.Size());
+}
+
+} // namespace cmudb
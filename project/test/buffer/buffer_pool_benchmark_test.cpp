@@ -0,0 +1,1064 @@
+/**
+ * buffer_pool_benchmark_test.cpp
+ *
+ * Throughput of the buffer pool hit path (FetchPage + UnpinPage on resident
+ * pages) with a growing number of threads, single latch vs. partitioned pool.
+ * Cost of the replacement policies on the lru_replacer_test access pattern.
+ * Hit ratio of b+ tree point lookups running next to sequential table scans
+ * under every replacement policy, and with scans going through a buffer ring.
+ * Sequential scan throughput on a cold file with and without readahead.
+ * Memory footprint (process RSS + OS page cache of the db file) and random
+ * read throughput with buffered vs. O_DIRECT I/O.
+ * Page table lookups with a growing number of threads, extendible hashing
+ * vs. the seqlock open addressing table.
+ * B+ tree height and point lookup cost for every supported page size, with
+ * the same amount of buffer pool memory.
+ * Time for a restarted pool to reach a 95% hit ratio on a skewed workload,
+ * cold vs. warmed up from the page set dumped before the restart.
+ * Writing back a pool full of dirty pages page by page, synced after each
+ * page or once, vs. FlushAllPages.
+ * Hit ratio and throughput of a pool of raw frames vs. a smaller pool plus a
+ * compressed cache taking the same memory, on pages about a third full.
+ * Random page read throughput with a growing number of threads, positional
+ * I/O of the disk manager vs. a shared fstream.
+ * Size of the db file over rounds of b+ tree inserts and deletes, with freed
+ * pages reused and free runs punched out of the file.
+ * Cold sequential read throughput of a partitioned pool fetching a page at a
+ * time vs. batches read with vectored I/O.
+ * Commit latency percentiles through the transaction manager, and of the
+ * log buffer sized flushes behind them, under every sync mode of the log file.
+ * Two objects growing side by side, first fit vs. extent hints: runs of
+ * consecutive pages of one of them and cold read throughput of all of them
+ * with scatter/gather I/O.
+ *
+ * The full size benchmarks are disabled so they stay out of `make check`, run
+ * them with ./buffer_pool_benchmark_test --gtest_also_run_disabled_tests
+ * Each one has a Smoke variant run by `make check` on a fraction of the data,
+ * to keep the paths working, its numbers mean nothing.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "hash/concurrent_hash.h"
+#include "hash/extendible_hash.h"
+#include "index/b_plus_tree.h"
+#include "logging/common.h"
+#include "page/header_page.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// a disabled benchmark at full size and a Smoke variant of it at the sizes
+// passed through Scaled
+#define BUFFER_POOL_BENCHMARK(name)                                            \
+  void name##Benchmark();                                                      \
+  TEST(BufferPoolBenchmark, DISABLED_##name) { name##Benchmark(); }            \
+  TEST(BufferPoolBenchmark, name##Smoke) { name##Benchmark(); }                \
+  void name##Benchmark()
+
+namespace {
+
+// n for the full size benchmark, a 16th of it (at least 1) for its Smoke
+// variant
+int Scaled(int n) {
+  const char *name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->name();
+  return strncmp(name, "DISABLED_", 9) == 0 ? n : std::max(1, n / 16);
+}
+
+// fetch/unpin random resident pages, return million operations per second
+double RunHitPath(BufferPoolManager *bpm, int num_pages, int num_threads,
+                  int ops_per_thread) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([=]() {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+      for (int i = 0; i < ops_per_thread; ++i) {
+        page_id_t page_id = dist(gen);
+        auto page = bpm->FetchPage(page_id);
+        if (page != nullptr) {
+          bpm->UnpinPage(page_id, false);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return num_threads * ops_per_thread / elapsed.count() / 1e6;
+}
+
+// lru_replacer_test BasicTest pattern scaled up: insert all, insert again in
+// reverse order, erase half, evict the rest. return elapsed seconds
+double RunReplacer(Replacer<int> *replacer, int num_frames, int rounds) {
+  auto start = std::chrono::steady_clock::now();
+  int value;
+  for (int round = 0; round < rounds; ++round) {
+    for (int i = 0; i < num_frames; ++i) {
+      replacer->Insert(i);
+    }
+    for (int i = 0; i < num_frames; ++i) {
+      replacer->Insert(num_frames - 1 - i);
+    }
+    for (int i = 0; i < num_frames / 2; ++i) {
+      replacer->Erase(i);
+    }
+    while (replacer->Victim(value)) {
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+typedef BPlusTree<GenericKey<8>, RID, GenericComparator<8>> Tree;
+
+// random point lookups, return number of keys found
+int RunLookups(Tree *tree, int num_keys, int num_lookups, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int64_t> dist(0, num_keys - 1);
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  int found = 0;
+  for (int i = 0; i < num_lookups; ++i) {
+    rids.clear();
+    index_key.SetFromInteger(dist(gen));
+    found += tree->GetValue(index_key, rids);
+  }
+  return found;
+}
+
+// full sequential scan, through ring if not nullptr, return number of tuples
+int RunScan(TableHeap *table, std::shared_ptr<BufferRing> ring = nullptr) {
+  Transaction txn(0);
+  int count = 0;
+  for (auto it = table->begin(&txn, ring); it != table->end(); ++it) {
+    ++count;
+  }
+  return count;
+}
+
+// write back the db file and drop it from the OS page cache
+void DropFileCache(const char *file_name) {
+  int fd = open(file_name, O_RDONLY);
+  ASSERT_NE(-1, fd);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// resident set size of this process in KB
+size_t ResidentKB() {
+  std::ifstream statm("/proc/self/statm");
+  size_t size, resident;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// anonymous memory of this process backed by transparent huge pages in KB
+size_t AnonHugeKB() {
+  std::ifstream smaps("/proc/self/smaps_rollup");
+  std::string line;
+  size_t value = 0;
+  while (std::getline(smaps, line)) {
+    if (sscanf(line.c_str(), "AnonHugePages: %zu", &value) == 1) {
+      break;
+    }
+  }
+  return value;
+}
+
+// pages of the file held in the OS page cache, in KB
+size_t CachedKB(const char *file_name) {
+  int fd = open(file_name, O_RDONLY);
+  off_t size = lseek(fd, 0, SEEK_END);
+  void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> vec((size + page_size - 1) / page_size);
+  mincore(map, size, vec.data());
+  size_t count = 0;
+  for (auto v : vec) {
+    count += v & 1;
+  }
+  munmap(map, size);
+  close(fd);
+  return count * page_size / 1024;
+}
+
+// random lookups of present keys, return million lookups per second
+double RunFinds(HashTable<int, int> *table, int num_keys, int num_threads,
+                int ops_per_thread) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([=]() {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<int> dist(0, num_keys - 1);
+      int value;
+      for (int i = 0; i < ops_per_thread; ++i) {
+        table->Find(dist(gen), value);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return num_threads * ops_per_thread / elapsed.count() / 1e6;
+}
+
+double HitRatio(BufferPoolManager *bpm, size_t hits, size_t misses) {
+  hits = bpm->GetHitCount() - hits;
+  misses = bpm->GetMissCount() - misses;
+  return hits + misses == 0 ? 0 : 100.0 * hits / (hits + misses);
+}
+
+// page reads the way the disk manager did them before positional I/O: one
+// file position for everyone, and the file size asked before every read
+class StreamReader {
+public:
+  explicit StreamReader(const char *file_name) : file_name_(file_name) {
+    db_io_.open(file_name, std::ios::binary | std::ios::in);
+  }
+
+  void ReadPage(page_id_t page_id, char *data) {
+    std::lock_guard<std::mutex> lock(latch_);
+    struct stat stat_buf;
+    stat(file_name_, &stat_buf);
+    db_io_.seekg((page_id + 1) * PAGE_SIZE);
+    db_io_.read(data, PAGE_SIZE);
+  }
+
+private:
+  const char *file_name_;
+  std::fstream db_io_;
+  std::mutex latch_;
+};
+
+// random page reads, return thousand reads per second
+template <typename Reader>
+double RunReads(Reader *reader, int num_pages, int num_threads,
+                int ops_per_thread) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([=]() {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<int> dist(0, num_pages - 1);
+      char data[PAGE_SIZE];
+      for (int i = 0; i < ops_per_thread; ++i) {
+        reader->ReadPage(dist(gen), data);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return num_threads * ops_per_thread / elapsed.count() / 1e3;
+}
+
+} // namespace
+
+BUFFER_POOL_BENCHMARK(HitPathScaling) {
+  const int pool_size = 512;
+  const int num_pages = 256;
+  const int ops_per_thread = Scaled(5000);
+
+  std::cout << std::setw(10) << "instances" << std::setw(10) << "threads"
+            << std::setw(14) << "Mops/s" << std::endl;
+  for (size_t num_instances : {1, 16}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(pool_size, disk_manager,
+                                                   nullptr, num_instances);
+    page_id_t page_id;
+    for (int i = 0; i < num_pages; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(page_id));
+      bpm->UnpinPage(page_id, false);
+    }
+
+    for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+      double mops = RunHitPath(bpm, num_pages, num_threads, ops_per_thread);
+      std::cout << std::setw(10) << num_instances << std::setw(10)
+                << num_threads << std::setw(14) << std::fixed
+                << std::setprecision(3) << mops << std::endl;
+    }
+
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+BUFFER_POOL_BENCHMARK(ReplacerCost) {
+  const int num_frames = Scaled(1024);
+  const int rounds = Scaled(20);
+
+  std::cout << std::setw(10) << "replacer" << std::setw(14) << "ns/op"
+            << std::endl;
+  // 2 inserts, 1/2 erase and 1/2 victim per frame and round
+  const double ops = 3.0 * num_frames * rounds;
+
+  LRUReplacer<int> lru_replacer;
+  double lru = RunReplacer(&lru_replacer, num_frames, rounds);
+  std::cout << std::setw(10) << "LRU" << std::setw(14) << std::fixed
+            << std::setprecision(1) << lru / ops * 1e9 << std::endl;
+
+  ClockReplacer<int> clock_replacer(num_frames);
+  double clock = RunReplacer(&clock_replacer, num_frames, rounds);
+  std::cout << std::setw(10) << "CLOCK" << std::setw(14) << std::fixed
+            << std::setprecision(1) << clock / ops * 1e9 << std::endl;
+
+  EXPECT_EQ(0, lru_replacer.Size());
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+BUFFER_POOL_BENCHMARK(ScanResistance) {
+  const int num_keys = Scaled(5000);    // ~40 leaf pages
+  const int num_tuples = Scaled(8000);  // ~100 table pages
+  const int pool_size = 64;
+  const int num_lookup_threads = 2;
+  const int num_lookups = Scaled(5000);
+
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  Schema *schema = ParseCreateStatement(
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)");
+
+  // build index and table in a pool large enough to hold both, then flush
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1024, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  Tree tree("foo_pk", bpm, comparator);
+  Transaction txn(0);
+  RID rid;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < num_keys; ++key) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, &txn);
+  }
+  TableHeap table(bpm, nullptr, nullptr, &txn);
+  page_id_t first_page_id = table.GetFirstPageId();
+  for (int i = 0; i < num_tuples; ++i) {
+    ASSERT_TRUE(table.InsertTuple(ConstructTuple(schema), rid, &txn));
+  }
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  bpm->FlushAllPages();
+  delete bpm;
+
+  std::cout << std::setw(10) << "replacer" << std::setw(14) << "mixed hit%"
+            << std::setw(18) << "after scan hit%" << std::setw(10) << "ARC p"
+            << std::endl;
+  const char *names[] = {"LRU", "CLOCK", "LRU-K", "ARC"};
+  std::vector<std::pair<ReplacerType, bool>> configs = {
+      {ReplacerType::LRU, false},   {ReplacerType::CLOCK, false},
+      {ReplacerType::LRU_K, false}, {ReplacerType::ARC, false},
+      {ReplacerType::LRU, true},    {ReplacerType::CLOCK, true}};
+  for (auto config : configs) {
+    ReplacerType replacer_type = config.first;
+    // scans recycle a ring of 16 frames instead of going through the
+    // replacer, it has to hold the pages read ahead too
+    std::shared_ptr<BufferRing> ring;
+    if (config.second) {
+      ring = std::make_shared<BufferRing>(16);
+    }
+    bpm = new BufferPoolManager(pool_size, disk_manager, nullptr, 1,
+                                replacer_type);
+    auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+    page_id_t root_page_id;
+    ASSERT_TRUE(header_page->GetRootId("foo_pk", root_page_id));
+    bpm->UnpinPage(HEADER_PAGE_ID, false);
+    Tree index("foo_pk", bpm, comparator, root_page_id);
+    TableHeap heap(bpm, nullptr, nullptr, first_page_id);
+
+    // warm up the index
+    EXPECT_EQ(num_lookups, RunLookups(&index, num_keys, num_lookups, 0));
+
+    // lookups next to two back to back full scans
+    size_t hits = bpm->GetHitCount(), misses = bpm->GetMissCount();
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread([&]() {
+      EXPECT_EQ(num_tuples, RunScan(&heap, ring));
+      EXPECT_EQ(num_tuples, RunScan(&heap, ring));
+    }));
+    for (int tid = 1; tid <= num_lookup_threads; ++tid) {
+      threads.push_back(std::thread([&, tid]() {
+        EXPECT_EQ(num_lookups, RunLookups(&index, num_keys, num_lookups, tid));
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double mixed = HitRatio(bpm, hits, misses);
+
+    // one more scan, then lookups, how much of the index is gone?
+    EXPECT_EQ(num_tuples, RunScan(&heap, ring));
+    hits = bpm->GetHitCount(), misses = bpm->GetMissCount();
+    EXPECT_EQ(num_lookups / 10,
+              RunLookups(&index, num_keys, num_lookups / 10, 42));
+    double after = HitRatio(bpm, hits, misses);
+
+    std::string name = names[static_cast<int>(replacer_type)];
+    std::cout << std::setw(10) << (ring ? name + "+ring" : name)
+              << std::setw(14) << std::fixed << std::setprecision(2) << mixed
+              << std::setw(18) << after << std::setw(10)
+              << bpm->GetArcTarget() << std::endl;
+    delete bpm;
+  }
+
+  delete key_schema;
+  delete schema;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(ColdScan) {
+  const int num_tuples = Scaled(12000);  // ~140 table pages
+  const int pool_size = 64;
+
+  Schema *schema = ParseCreateStatement(
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)");
+
+  // build the table in a pool large enough to hold it, then flush
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1024, disk_manager);
+  Transaction txn(0);
+  RID rid;
+  TableHeap table(bpm, nullptr, nullptr, &txn);
+  page_id_t first_page_id = table.GetFirstPageId();
+  for (int i = 0; i < num_tuples; ++i) {
+    ASSERT_TRUE(table.InsertTuple(ConstructTuple(schema), rid, &txn));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  int num_pages = disk_manager->GetNumPages();
+
+  std::cout << std::setw(10) << "window" << std::setw(12) << "ms"
+            << std::setw(12) << "MB/s" << std::setw(12) << "miss"
+            << std::setw(12) << "prefetch" << std::endl;
+  for (size_t window : {0, 1, 8, 32}) {
+    DropFileCache("test.db");
+    bpm = new BufferPoolManager(pool_size, disk_manager);
+    bpm->SetReadAheadWindow(window);
+    TableHeap heap(bpm, nullptr, nullptr, first_page_id);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(num_tuples, RunScan(&heap));
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(10) << window << std::setw(12) << std::fixed
+              << std::setprecision(2) << elapsed.count() * 1e3
+              << std::setw(12)
+              << num_pages * PAGE_SIZE / elapsed.count() / (1 << 20)
+              << std::setw(12) << bpm->GetMissCount() << std::setw(12)
+              << bpm->GetPrefetchCount() << std::endl;
+    delete bpm;
+  }
+
+  delete schema;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(DirectIO) {
+  const int num_pages = Scaled(4096);  // 16MB file
+  const int pool_size = Scaled(2048);  // 8MB arena
+  const int num_threads = 4;
+  const int ops_per_thread = Scaled(20000);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->WritePage(disk_manager->AllocatePage(), data);
+  }
+  delete disk_manager;
+
+  std::cout << std::setw(10) << "mode" << std::setw(10) << "RSS KB"
+            << std::setw(12) << "cache KB" << std::setw(12) << "THP KB"
+            << std::setw(12) << "Mops/s" << std::endl;
+  for (bool direct_io : {false, true}) {
+    DropFileCache("test.db");
+    size_t rss = ResidentKB(), huge = AnonHugeKB();
+    disk_manager = new DiskManager("test.db", direct_io);
+    // CLOCK, LRU walks its whole list on every call when asserts are on
+    auto *bpm = new BufferPoolManager(pool_size, disk_manager, nullptr, 1,
+                                      ReplacerType::CLOCK);
+
+    // the first round fills the pool, the second one is measured
+    RunHitPath(bpm, num_pages, num_threads, ops_per_thread);
+    double mops = RunHitPath(bpm, num_pages, num_threads, ops_per_thread);
+
+    std::cout << std::setw(10) << (direct_io ? "O_DIRECT" : "buffered")
+              << std::setw(10) << ResidentKB() - rss << std::setw(12)
+              << CachedKB("test.db") << std::setw(12) << AnonHugeKB() - huge
+              << std::setw(12) << std::fixed << std::setprecision(3) << mops
+              << std::endl;
+    delete bpm;
+    delete disk_manager;
+  }
+
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(PageTableLookup) {
+  const int num_keys = 4096;
+  const int ops_per_thread = Scaled(100000);
+
+  ExtendibleHash<int, int> extendible(BUCKET_SIZE);
+  ConcurrentHash<int, int> concurrent(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    extendible.Insert(i, i);
+    concurrent.Insert(i, i);
+  }
+
+  std::cout << std::setw(10) << "threads" << std::setw(14) << "extendible"
+            << std::setw(14) << "concurrent" << std::endl;
+  for (int num_threads : {1, 2, 4, 8}) {
+    double slow = RunFinds(&extendible, num_keys, num_threads, ops_per_thread);
+    double fast = RunFinds(&concurrent, num_keys, num_threads, ops_per_thread);
+    std::cout << std::setw(10) << num_threads << std::setw(14) << std::fixed
+              << std::setprecision(3) << slow << std::setw(14) << fast
+              << std::endl;
+  }
+}
+
+BUFFER_POOL_BENCHMARK(PageSize) {
+  typedef BPlusTree<GenericKey<64>, RID, GenericComparator<64>> WideTree;
+  typedef BPlusTreeInternalPage<GenericKey<64>, page_id_t,
+                                GenericComparator<64>> InternalPage;
+  const int num_keys = Scaled(20000);
+  const size_t pool_bytes = 1 << 20;
+  const int num_lookups = Scaled(10000);
+  const int build_pool_size = 4096;
+
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<64> comparator(key_schema);
+
+  std::cout << std::setw(10) << "page size" << std::setw(8) << "height"
+            << std::setw(8) << "pages" << std::setw(14) << "reads/lookup"
+            << std::setw(12) << "us/lookup" << std::endl;
+  for (size_t page_size = MIN_PAGE_SIZE; page_size <= MAX_PAGE_SIZE;
+       page_size <<= 1) {
+    DiskManager *disk_manager =
+        new DiskManager("test.db", false, page_size);
+    // build in a pool holding the whole tree, then flush. CLOCK, LRU walks
+    // its whole list on every call when asserts are on
+    auto *bpm = new BufferPoolManager(build_pool_size, disk_manager, nullptr,
+                                      1, ReplacerType::CLOCK);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+    {
+      WideTree tree("foo_pk", bpm, comparator);
+      Transaction txn(0);
+      RID rid;
+      GenericKey<64> index_key;
+      for (int64_t key = 0; key < num_keys; ++key) {
+        rid.Set(0, key);
+        index_key.SetFromInteger(key);
+        tree.Insert(index_key, rid, &txn);
+      }
+    }
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    // pages deleted by splits leave holes in the page ids
+    for (page_id = 0; page_id < 2 * build_pool_size; ++page_id) {
+      bpm->FlushPage(page_id);
+    }
+    delete bpm;
+
+    // the same memory holds fewer, larger pages
+    bpm = new BufferPoolManager(pool_bytes / page_size, disk_manager, nullptr,
+                                1, ReplacerType::CLOCK);
+    auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+    page_id_t root_page_id;
+    ASSERT_TRUE(header_page->GetRootId("foo_pk", root_page_id));
+    bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+    int height = 1;
+    for (page_id = root_page_id;; ++height) {
+      auto node = reinterpret_cast<BPlusTreePage *>(
+          bpm->FetchPage(page_id)->GetData());
+      bool is_leaf = node->IsLeafPage();
+      page_id_t child = is_leaf
+          ? INVALID_PAGE_ID
+          : reinterpret_cast<InternalPage *>(node)->ValueAt(0);
+      bpm->UnpinPage(page_id, false);
+      if (is_leaf) {
+        break;
+      }
+      page_id = child;
+    }
+
+    WideTree tree("foo_pk", bpm, comparator, root_page_id);
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int64_t> dist(0, num_keys - 1);
+    GenericKey<64> index_key;
+    std::vector<RID> rids;
+    size_t misses = bpm->GetMissCount();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_lookups; ++i) {
+      rids.clear();
+      index_key.SetFromInteger(dist(gen));
+      EXPECT_TRUE(tree.GetValue(index_key, rids));
+    }
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(10) << page_size << std::setw(8) << height
+              << std::setw(8) << disk_manager->GetNumPages() << std::setw(14)
+              << std::fixed << std::setprecision(3)
+              << double(bpm->GetMissCount() - misses) / num_lookups
+              << std::setw(12) << elapsed.count() / num_lookups << std::endl;
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+
+  delete key_schema;
+}
+
+BUFFER_POOL_BENCHMARK(WarmUp) {
+  const int num_pages = Scaled(8192);  // 32MB file
+  const int pool_size = Scaled(1024);
+  const int hot_pages = Scaled(896);   // spread over the whole file
+  const int window = Scaled(1000);     // ops the hit ratio is measured over
+  const int max_ops = Scaled(200000);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->WritePage(disk_manager->AllocatePage(), data);
+  }
+  std::vector<page_id_t> hot;
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    hot.push_back(page_id);
+  }
+  std::mt19937 gen(0);
+  std::shuffle(hot.begin(), hot.end(), gen);
+  hot.resize(hot_pages);
+
+  // 99% of the fetches go to the hot pages, return true on a hit
+  auto fetch = [&](BufferPoolManager *bpm, std::mt19937 &gen) {
+    std::uniform_int_distribution<int> coin(0, 99);
+    std::uniform_int_distribution<int> hot_dist(0, hot_pages - 1);
+    std::uniform_int_distribution<page_id_t> cold_dist(0, num_pages - 1);
+    page_id_t page_id =
+        coin(gen) == 0 ? cold_dist(gen) : hot[hot_dist(gen)];
+    size_t misses = bpm->GetMissCount();
+    EXPECT_NE(nullptr, bpm->FetchPage(page_id));
+    bpm->UnpinPage(page_id, false);
+    return bpm->GetMissCount() == misses;
+  };
+
+  // run the workload long enough to settle, then dump the page set
+  auto *bpm = new BufferPoolManager(pool_size, disk_manager, nullptr, 1,
+                                    ReplacerType::CLOCK);
+  for (int i = 0; i < 20 * pool_size; ++i) {
+    fetch(bpm, gen);
+  }
+  EXPECT_TRUE(bpm->DumpPageSet("test.pageset"));
+  delete bpm;
+
+  std::cout << std::setw(10) << "start" << std::setw(12) << "warm-up ms"
+            << std::setw(12) << "to 95% ms" << std::setw(12) << "ops"
+            << std::setw(12) << "misses" << std::endl;
+  for (bool warm_up : {false, true}) {
+    DropFileCache("test.db");
+    bpm = new BufferPoolManager(pool_size, disk_manager, nullptr, 1,
+                                ReplacerType::CLOCK);
+    std::mt19937 gen(1);
+
+    auto start = std::chrono::steady_clock::now();
+    if (warm_up) {
+      EXPECT_LT(0, bpm->WarmUp("test.pageset"));
+    }
+    std::chrono::duration<double> warm_up_time =
+        std::chrono::steady_clock::now() - start;
+    int ops = 0, hits = 0;
+    std::vector<bool> last(window, false);
+    while (ops < max_ops && (ops < window || hits * 100 < window * 95)) {
+      bool hit = fetch(bpm, gen);
+      hits += hit - last[ops % window];
+      last[ops % window] = hit;
+      ++ops;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(10) << (warm_up ? "warm" : "cold") << std::setw(12)
+              << std::fixed << std::setprecision(2)
+              << warm_up_time.count() * 1e3 << std::setw(12)
+              << elapsed.count() * 1e3 << std::setw(12) << ops
+              << std::setw(12) << bpm->GetMissCount() << std::endl;
+    delete bpm;
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.pageset");
+}
+
+BUFFER_POOL_BENCHMARK(FlushAll) {
+  const int num_pages = Scaled(2048);  // 8MB of dirty pages
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(num_pages, disk_manager, nullptr, 4,
+                                    ReplacerType::CLOCK);
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  std::cout << std::setw(16) << "mode" << std::setw(12) << "ms"
+            << std::setw(12) << "MB/s" << std::endl;
+  for (const char *mode : {"page + sync", "page, one sync", "flush all"}) {
+    for (page_id = 0; page_id < num_pages; ++page_id) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (mode[0] == 'f') {
+      size_t written;
+      EXPECT_TRUE(bpm->FlushAllPages(&written));
+      EXPECT_EQ(num_pages, written);
+    } else {
+      for (page_id = 0; page_id < num_pages; ++page_id) {
+        EXPECT_TRUE(bpm->FlushPage(page_id));
+        if (mode[5] == '+') {
+          disk_manager->SyncPages();
+        }
+      }
+      disk_manager->SyncPages();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(16) << mode << std::setw(12) << std::fixed
+              << std::setprecision(2) << elapsed.count() * 1e3
+              << std::setw(12)
+              << num_pages * PAGE_SIZE / elapsed.count() / (1 << 20)
+              << std::endl;
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(CompressedCache) {
+  const int num_pages = Scaled(3072);  // 12MB file
+  const size_t memory = Scaled(1024) * PAGE_SIZE;
+  const int num_threads = 4;
+  const int ops_per_thread = Scaled(20000);
+
+  // records in the upper third of every page, free space zeroed
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> number(0, 99999999);
+  char data[PAGE_SIZE] = {0};
+  for (int i = 0; i < num_pages; ++i) {
+    for (int j = PAGE_SIZE - PAGE_SIZE / 3; j + 48 < PAGE_SIZE; j += 48) {
+      snprintf(data + j, 48, "customer#%08d|%08d|%s|", number(gen),
+               number(gen), number(gen) % 2 ? "BUILDING" : "MACHINERY");
+    }
+    disk_manager->WritePage(disk_manager->AllocatePage(), data);
+  }
+  delete disk_manager;
+  // misses go to the device, not the OS page cache
+  disk_manager = new DiskManager("test.db", true);
+
+  std::cout << std::setw(12) << "frames" << std::setw(14) << "compressed"
+            << std::setw(10) << "pool %" << std::setw(12) << "tier %"
+            << std::setw(12) << "disk reads" << std::setw(10) << "Mops/s"
+            << std::endl;
+  for (size_t frames : {memory / PAGE_SIZE, memory / PAGE_SIZE / 2}) {
+    size_t compressed = memory - frames * PAGE_SIZE;
+    auto *bpm = new BufferPoolManager(frames, disk_manager, nullptr, 4,
+                                      ReplacerType::CLOCK, 0, compressed);
+    // the first round fills the pool and the cache, the second one is
+    // measured
+    RunHitPath(bpm, num_pages, num_threads, ops_per_thread);
+    BufferPoolStats before = bpm->GetStats();
+    double mops = RunHitPath(bpm, num_pages, num_threads, ops_per_thread);
+    BufferPoolStats stats = bpm->GetStats();
+    uint64_t hits = stats.fetch_hits - before.fetch_hits;
+    uint64_t misses = stats.fetch_misses - before.fetch_misses;
+    uint64_t tier_hits = stats.compressed_hits - before.compressed_hits;
+    uint64_t disk_reads = stats.disk_reads - before.disk_reads;
+
+    std::cout << std::setw(12) << frames << std::setw(14) << compressed
+              << std::setw(10) << std::fixed << std::setprecision(1)
+              << 100.0 * hits / (hits + misses) << std::setw(12)
+              << (misses == 0 ? 0 : 100.0 * tier_hits / misses)
+              << std::setw(12) << disk_reads << std::setw(10)
+              << std::setprecision(3) << mops << std::endl;
+    delete bpm;
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(PositionalIO) {
+  const int num_pages = Scaled(4096);  // 16MB file, in the OS page cache
+  const int total_reads = Scaled(128000);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  for (int i = 0; i < num_pages; ++i) {
+    snprintf(data, PAGE_SIZE, "page %d", i);
+    disk_manager->WritePage(disk_manager->AllocatePage(), data);
+  }
+  StreamReader stream_reader("test.db");
+
+  std::cout << std::setw(10) << "threads" << std::setw(16) << "fstream K/s"
+            << std::setw(16) << "pread K/s" << std::endl;
+  for (int num_threads : {1, 4, 16, 64}) {
+    int ops_per_thread = total_reads / num_threads;
+    double stream = RunReads(&stream_reader, num_pages, num_threads,
+                             ops_per_thread);
+    double positional =
+        RunReads(disk_manager, num_pages, num_threads, ops_per_thread);
+    std::cout << std::setw(10) << num_threads << std::setw(16) << std::fixed
+              << std::setprecision(1) << stream << std::setw(16) << positional
+              << std::endl;
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(FreePageChurn) {
+  const int num_keys = Scaled(20000);
+  const int num_rounds = 5;
+
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // a pool much smaller than the tree, its pages reach the file
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  Tree tree("foo_pk", bpm, comparator);
+  Transaction txn(0);
+  RID rid;
+  GenericKey<8> index_key;
+
+  std::cout << std::setw(8) << "round" << std::setw(12) << "pages"
+            << std::setw(12) << "file KB" << std::setw(14) << "on disk KB"
+            << std::endl;
+  for (int round = 0; round < num_rounds; ++round) {
+    // new keys every round, the tree grows into new pages
+    int64_t first_key = static_cast<int64_t>(round) * num_keys;
+    for (int64_t key = first_key; key < first_key + num_keys; ++key) {
+      rid.Set(0, static_cast<uint32_t>(key));
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, rid, &txn);
+    }
+    for (int64_t key = first_key; key < first_key + num_keys; ++key) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, &txn);
+    }
+    bpm->FlushAllPages();
+
+    struct stat stat_buf;
+    ASSERT_EQ(0, stat("test.db", &stat_buf));
+    std::cout << std::setw(8) << round << std::setw(12)
+              << disk_manager->GetNumPages() << std::setw(12)
+              << stat_buf.st_size / 1024 << std::setw(14)
+              << stat_buf.st_blocks * 512 / 1024 << std::endl;
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete key_schema;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(BatchFetch) {
+  const int num_pages = Scaled(8192);
+  const int pool_size = 256;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<char> pages(num_pages * PAGE_SIZE, 'x');
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->AllocatePage();
+  }
+  disk_manager->WritePages(0, pages.data(), num_pages);
+
+  std::cout << std::setw(10) << "batch" << std::setw(12) << "ms"
+            << std::setw(12) << "MB/s" << std::endl;
+  for (size_t batch : {1, 8, 32, 128}) {
+    DropFileCache("test.db");
+    BufferPoolManager bpm(pool_size, disk_manager, nullptr, 4);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<page_id_t> page_ids;
+    std::vector<Page *> frames;
+    for (page_id_t first = 0; first < num_pages; first += batch) {
+      page_ids.clear();
+      for (page_id_t page_id = first;
+           page_id < std::min<page_id_t>(first + batch, num_pages);
+           ++page_id) {
+        page_ids.push_back(page_id);
+      }
+      ASSERT_EQ(page_ids.size(), bpm.FetchPages(page_ids, frames));
+      for (auto *page : frames) {
+        bpm.UnpinPage(page, false);
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(10) << batch << std::setw(12) << std::fixed
+              << std::setprecision(2) << elapsed.count() * 1e3
+              << std::setw(12)
+              << num_pages * PAGE_SIZE / elapsed.count() / (1 << 20)
+              << std::endl;
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+BUFFER_POOL_BENCHMARK(CommitLatency) {
+  const int num_commits = Scaled(500);
+
+  std::cout << std::setw(10) << "sync" << std::setw(16) << "commit p50 us"
+            << std::setw(16) << "commit p99 us" << std::setw(16)
+            << "flush p50 us" << std::setw(16) << "flush p99 us"
+            << std::setw(16) << "flush p99.9 us" << std::endl;
+  const char *names[] = {"none", "always", "periodic", "dsync"};
+  for (auto mode : {SyncMode::NONE, SyncMode::ALWAYS, SyncMode::PERIODIC,
+                    SyncMode::DSYNC}) {
+    // a commit waits for the flush thread, which writes a whole log buffer
+    StorageEngineOptions options;
+    options.log_sync = mode;
+    options.log_timeout = std::chrono::milliseconds(1);
+    StorageEngine *storage_engine = new StorageEngine("test.db", options);
+    LogManager *log_manager = storage_engine->log_manager_;
+    TransactionManager *txn_manager = storage_engine->transaction_manager_;
+    log_manager->RunFlushThread();
+    LatencyHistogram commits;
+    for (int i = 0; i < num_commits; ++i) {
+      Transaction *txn = txn_manager->Begin();
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_TRUE(txn_manager->Commit(txn));
+      commits.RecordSince(start);
+      delete txn;
+    }
+    log_manager->StopFlushThread();
+
+    // the flushes alone, without the polling of Commit
+    size_t flush_size = log_manager->GetLogBufferSize();
+    std::vector<char> log_buffers(2 * flush_size, 'x');
+    LatencyHistogram flushes;
+    for (int i = 0; i < num_commits; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      // log buffers take turns, like the log manager's
+      storage_engine->disk_manager_->WriteLog(&log_buffers[i % 2 * flush_size],
+                                              flush_size);
+      flushes.RecordSince(start);
+    }
+    LatencyStats commit_stats, flush_stats;
+    commits.Snapshot(commit_stats);
+    flushes.Snapshot(flush_stats);
+
+    std::cout << std::setw(10) << names[static_cast<int>(mode)]
+              << std::setw(16) << std::fixed << std::setprecision(1)
+              << commit_stats.PercentileNanos(50) / 1e3 << std::setw(16)
+              << commit_stats.PercentileNanos(99) / 1e3 << std::setw(16)
+              << flush_stats.PercentileNanos(50) / 1e3 << std::setw(16)
+              << flush_stats.PercentileNanos(99) / 1e3 << std::setw(16)
+              << flush_stats.PercentileNanos(99.9) / 1e3 << std::endl;
+    delete storage_engine;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+BUFFER_POOL_BENCHMARK(ExtentAllocation) {
+  const int num_pages = Scaled(4096);
+
+  std::vector<char> pages(num_pages * PAGE_SIZE, 'x');
+  std::vector<char *> buffers;
+  for (int i = 0; i < num_pages; ++i) {
+    buffers.push_back(&pages[i * PAGE_SIZE]);
+  }
+  std::cout << std::setw(10) << "hints" << std::setw(10) << "runs"
+            << std::setw(12) << "ms" << std::setw(12) << "MB/s" << std::endl;
+  for (bool hints : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    ExtentHint table, index;
+    std::vector<page_id_t> page_ids;
+    for (int i = 0; i < num_pages; ++i) {
+      page_ids.push_back(disk_manager->AllocatePage(hints ? &table : nullptr));
+      disk_manager->AllocatePage(hints ? &index : nullptr);
+    }
+    disk_manager->WritePages(page_ids, buffers.data());
+    size_t runs = 1;
+    for (size_t i = 1; i < page_ids.size(); ++i) {
+      runs += page_ids[i] != page_ids[i - 1] + 1;
+    }
+
+    DropFileCache("test.db");
+    auto start = std::chrono::steady_clock::now();
+    disk_manager->ReadPages(page_ids, buffers.data());
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(10) << (hints ? "yes" : "no") << std::setw(10)
+              << runs << std::setw(12) << std::fixed << std::setprecision(2)
+              << elapsed.count() * 1e3 << std::setw(12)
+              << num_pages * PAGE_SIZE / elapsed.count() / (1 << 20)
+              << std::endl;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+} // namespace cmudb
@@ -2,7 +2,15 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
@@ -48,4 +56,759 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+TEST(BufferPoolManagerTest, InstancesTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // 4 instances with 4 pages each
+  BufferPoolManager bpm(16, disk_manager, nullptr, 4);
+  EXPECT_EQ(4, bpm.GetNumInstances());
+
+  for (int i = 0; i < 16; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, temp_page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+  }
+  // every instance is full
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+
+  // unpin the pages of one instance only, the others stay full
+  for (int i = 0; i < 16; i += 4) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  for (int i = 0; i < 4; ++i) {
+    // page ids handed out to full instances return nullptr
+    while (bpm.NewPage(temp_page_id) == nullptr) {
+    }
+    EXPECT_EQ(0, temp_page_id % 4);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+
+  // evicted pages come back from disk
+  for (int i = 0; i < 16; i += 4) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, ConcurrentInstancesTest) {
+  const int num_threads = 8;
+  const int num_pages = 64;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(32, disk_manager, nullptr, 8);
+
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    *reinterpret_cast<int *>(page->GetData()) = temp_page_id;
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&bpm, tid]() {
+      for (int i = 0; i < 1000; ++i) {
+        page_id_t page_id = (tid * 7 + i) % num_pages;
+        auto page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        page->RLatch();
+        EXPECT_EQ(page_id, *reinterpret_cast<int *>(page->GetData()));
+        page->RUnlatch();
+        EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// fetches of resident pages and unpins run without the latch, next to
+// misses, evictions and the cleaner taking frames over
+TEST(BufferPoolManagerTest, LatchFreePinTest) {
+  const int num_threads = 4;
+  const int num_pages = 24;
+  const int num_rounds = 2000;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(8, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    *reinterpret_cast<int *>(page->GetData()) = temp_page_id;
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  bpm.RunCleanerThread(std::chrono::milliseconds(1), 2);
+
+  std::atomic<int> increments(0);
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&, tid]() {
+      std::mt19937 gen(tid);
+      // most fetches hit the first pages
+      std::uniform_int_distribution<page_id_t> hot(0, 3), all(0, num_pages - 1);
+      for (int i = 0; i < num_rounds; ++i) {
+        page_id_t page_id = i % 4 == 0 ? all(gen) : hot(gen);
+        auto page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        page->WLatch();
+        EXPECT_EQ(page_id, *reinterpret_cast<int *>(page->GetData()));
+        ++reinterpret_cast<int *>(page->GetData())[2];
+        page->WUnlatch();
+        ++increments;
+        EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  bpm.StopCleanerThread();
+
+  // no update lost, every unpinned page is known to the replacer
+  int sum = 0;
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    auto page = bpm.FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    sum += reinterpret_cast<int *>(page->GetData())[2];
+    if (page_id != 0) {
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+    }
+  }
+  EXPECT_EQ(increments, sum);
+  EXPECT_TRUE(bpm.Check());
+  EXPECT_EQ(true, bpm.UnpinPage(0, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, ClockReplacerTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 1, ReplacerType::CLOCK);
+
+  // write 30 pages through a pool of 10 frames
+  for (int i = 0; i < 30; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // pin every frame, no victim left
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+  }
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_EQ(nullptr, bpm.FetchPage(10));
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  auto page = bpm.FetchPage(29);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("page 29", std::string(page->GetData()));
+  EXPECT_EQ(true, bpm.UnpinPage(29, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, CleanerTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 2);
+
+  // 10 dirty unpinned pages
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // the cleaner writes all of them in the background
+  bpm.RunCleanerThread(std::chrono::milliseconds(1), 5);
+  for (int i = 0; i < 1000 && bpm.GetBackgroundWriteCount() < 10; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bpm.StopCleanerThread();
+  EXPECT_EQ(10, bpm.GetBackgroundWriteCount());
+
+  // evicting them needs no write
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ(0, bpm.GetForegroundWriteCount());
+
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, InFlightIOTest) {
+  const int num_threads = 8;
+  const int num_pages = 40;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    *reinterpret_cast<int *>(page->GetData()) = temp_page_id;
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // every round all threads miss on the same page, while half of them also
+  // touch pages of their own and dirty them, so victims are written back
+  // without the latch as well
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&bpm, tid]() {
+      for (int i = 0; i < 200; ++i) {
+        page_id_t page_id = i % num_pages;
+        if (tid % 2 == 1) {
+          page_id = (page_id + tid * 5) % num_pages;
+        }
+        auto page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        page->RLatch();
+        EXPECT_EQ(page_id, *reinterpret_cast<int *>(page->GetData()));
+        page->RUnlatch();
+        EXPECT_EQ(true, bpm.UnpinPage(page_id, tid % 2 == 1));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, *reinterpret_cast<int *>(page->GetData()));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, PageGuardTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(2, disk_manager);
+
+  {
+    auto guard = bpm.NewPageGuarded(temp_page_id);
+    ASSERT_EQ(true, guard.IsValid());
+    EXPECT_EQ(1, guard.GetPage()->GetPinCount());
+    snprintf(guard.GetData(), PAGE_SIZE, "page 0");
+  }
+  ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+
+  // readers share the page, each guard releases its own pin once
+  auto guard = bpm.FetchPageRead(0);
+  ASSERT_EQ(true, guard.IsValid());
+  {
+    auto other = bpm.FetchPageRead(0);
+    EXPECT_EQ(2, other.GetPage()->GetPinCount());
+    EXPECT_EQ("page 0", std::string(other.GetData()));
+  }
+  EXPECT_EQ(1, guard.GetPage()->GetPinCount());
+
+  // moving hands over the pin, the moved from guard releases nothing
+  ReadPageGuard moved(std::move(guard));
+  EXPECT_EQ(false, guard.IsValid());
+  EXPECT_EQ(1, moved.GetPage()->GetPinCount());
+  Page *page = moved.GetPage();
+  moved.Drop();
+  moved.Drop();
+  EXPECT_EQ(0, page->GetPinCount());
+
+  // assigning releases the page held before
+  auto write_guard = bpm.FetchPageWrite(0);
+  write_guard = bpm.FetchPageWrite(1);
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_EQ(1, write_guard.GetPage()->GetPinCount());
+
+  // every frame pinned
+  auto other = bpm.FetchPageWrite(0);
+  EXPECT_EQ(false, bpm.FetchPageRead(2).IsValid());
+  other.Drop();
+  write_guard.Drop();
+
+  // the write guard marked page 0 dirty, it survives eviction
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ("page 0", std::string(bpm.FetchPageRead(0).GetData()));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, StatsTest) {
+  page_id_t page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(2, disk_manager);
+
+  ASSERT_NE(nullptr, bpm.NewPage(page_id));
+  EXPECT_EQ(true, bpm.UnpinPage(0, true));
+  ASSERT_NE(nullptr, bpm.NewPage(page_id));
+  EXPECT_EQ(true, bpm.UnpinPage(1, false));
+  ASSERT_NE(nullptr, bpm.FetchPage(0));
+  EXPECT_EQ(true, bpm.UnpinPage(0, false));
+
+  // page 1 is clean, page 0 has to be written back
+  ASSERT_NE(nullptr, bpm.NewPage(page_id));
+  ASSERT_NE(nullptr, bpm.FetchPage(1));
+  // every frame pinned
+  EXPECT_EQ(nullptr, bpm.FetchPage(0));
+  EXPECT_EQ(true, bpm.FlushPage(2));
+
+  BufferPoolStats stats = bpm.GetStats();
+  EXPECT_EQ(1, stats.fetch_hits);
+  EXPECT_EQ(2, stats.fetch_misses);
+  EXPECT_EQ(3, stats.new_pages);
+  EXPECT_EQ(1, stats.pin_failures);
+  EXPECT_EQ(1, stats.clean_evictions);
+  EXPECT_EQ(1, stats.dirty_evictions);
+  EXPECT_EQ(0, stats.wal_flushes);
+  EXPECT_NEAR(100.0 / 3, stats.HitRatio(), 0.01);
+  // only the fetch that read page 1 completed a miss
+  EXPECT_EQ(1, stats.fetch_miss_latency.count);
+  // eviction of page 0 and the flush of page 2
+  EXPECT_EQ(2, stats.write_latency.count);
+  EXPECT_EQ(bpm.GetHitCount(), stats.fetch_hits);
+  EXPECT_EQ(bpm.GetForegroundWriteCount(), stats.dirty_evictions);
+  EXPECT_NE(std::string::npos, stats.ToString().find("hits: 1 misses: 2"));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, BufferRingTest) {
+  page_id_t page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(8, disk_manager);
+  for (int i = 0; i < 24; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+  }
+  // pages 16-23 are resident, the hot set 0-3 evicts 16-19
+  for (page_id = 0; page_id < 4; ++page_id) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+
+  // scan the other pages through a ring of 2 frames: the first two misses
+  // take victims (pages 20 and 21), every later miss recycles a ring frame
+  BufferRing ring(2);
+  for (page_id = 4; page_id < 24; ++page_id) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_id, &ring));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(16, ring.GetRecycleCount());
+
+  // the hot set survived the scan
+  size_t hits = bpm.GetHitCount();
+  for (page_id = 0; page_id < 4; ++page_id) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(hits + 4, bpm.GetHitCount());
+
+  // a pinned ring frame is not recycled, a regular victim replaces it
+  BufferRing small_ring(1);
+  Page *page = bpm.FetchPage(4, &small_ring);
+  ASSERT_NE(nullptr, page);
+  Page *other = bpm.FetchPage(5, &small_ring);
+  ASSERT_NE(nullptr, other);
+  EXPECT_NE(page, other);
+  EXPECT_EQ(0, small_ring.GetRecycleCount());
+  EXPECT_EQ(true, bpm.UnpinPage(4, false));
+  EXPECT_EQ(true, bpm.UnpinPage(5, false));
+  // page 4 is not in the ring anymore, page 5 is recycled for page 6
+  ASSERT_EQ(other, bpm.FetchPage(6, &small_ring));
+  EXPECT_EQ(1, small_ring.GetRecycleCount());
+  EXPECT_EQ(true, bpm.UnpinPage(6, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, ResizeTest) {
+  page_id_t page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 1, ReplacerType::LRU, 8);
+  EXPECT_EQ(4, bpm.GetPoolSize());
+  for (int i = 0; i < 4; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+  }
+  EXPECT_EQ(nullptr, bpm.NewPage(page_id));
+
+  // growing hands the reserved frames out
+  EXPECT_EQ(8, bpm.Resize(8));
+  for (int i = 4; i < 8; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+
+  // pinned pages can not be drained
+  EXPECT_EQ(4, bpm.Resize(2));
+  EXPECT_EQ(4, bpm.GetPoolSize());
+
+  // dirty pages are written back before their frames are given up
+  for (page_id = 0; page_id < 4; ++page_id) {
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+  }
+  EXPECT_EQ(2, bpm.Resize(2));
+  for (page_id = 0; page_id < 4; ++page_id) {
+    Page *page = bpm.FetchPage(page_id);
+    if (page_id < 2) {
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(0, strcmp(page->GetData(),
+                          ("page " + std::to_string(page_id)).c_str()));
+    } else {
+      EXPECT_EQ(nullptr, page);
+    }
+  }
+  EXPECT_EQ(true, bpm.UnpinPage(0, false));
+  EXPECT_EQ(true, bpm.UnpinPage(1, false));
+
+  // the pool never grows past the frames reserved at construction
+  EXPECT_EQ(8, bpm.Resize(100));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  page_id_t page_id;
+  size_t num_pages;
+  char data[PAGE_SIZE];
+
+  for (bool direct_io : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db", direct_io);
+    BufferPoolManager bpm(8, disk_manager, nullptr, 2);
+    EXPECT_EQ(true, bpm.FlushAllPages(&num_pages));
+    EXPECT_EQ(0, num_pages);
+
+    for (int i = 0; i < 8; ++i) {
+      Page *page = bpm.NewPage(page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+    }
+    // pinned pages are written too
+    Page *page = bpm.FetchPage(3);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(true, bpm.FlushAllPages(&num_pages));
+    EXPECT_EQ(8, num_pages);
+    EXPECT_EQ(true, bpm.FlushAllPages(&num_pages));
+    EXPECT_EQ(0, num_pages);
+    for (page_id = 0; page_id < 8; ++page_id) {
+      disk_manager->ReadPage(page_id, data);
+      EXPECT_EQ(0, strcmp(data, ("page " + std::to_string(page_id)).c_str()));
+    }
+
+    // only pages dirtied again are written again
+    snprintf(page->GetData(), PAGE_SIZE, "page 3 again");
+    EXPECT_EQ(true, bpm.UnpinPage(3, true));
+    EXPECT_EQ(true, bpm.FlushAllPages(&num_pages));
+    EXPECT_EQ(1, num_pages);
+    disk_manager->ReadPage(3, data);
+    EXPECT_EQ(0, strcmp(data, "page 3 again"));
+
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+TEST(BufferPoolManagerTest, CompressedCacheTest) {
+  page_id_t page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 2, ReplacerType::LRU, 0,
+                        64 << 10);
+  for (int i = 0; i < 16; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+  }
+  // dirty victims are written back, not kept
+  BufferPoolStats stats = bpm.GetStats();
+  EXPECT_EQ(0, stats.compressed_stashes);
+
+  // the first round reads disk, clean victims go to the compressed cache
+  for (int round = 0; round < 2; ++round) {
+    for (page_id = 0; page_id < 16; ++page_id) {
+      Page *page = bpm.FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(0, strcmp(page->GetData(),
+                          ("page " + std::to_string(page_id)).c_str()));
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+    }
+  }
+  stats = bpm.GetStats();
+  EXPECT_EQ(16, stats.disk_reads);
+  EXPECT_EQ(16, stats.compressed_hits);
+  EXPECT_DOUBLE_EQ(50, stats.CompressedHitRatio());
+  EXPECT_EQ(12, stats.compressed_pages);
+
+  // a page dirtied after it left the cache is read back as written
+  Page *page = bpm.FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "page 0 again");
+  EXPECT_EQ(true, bpm.UnpinPage(0, true));
+  for (page_id = 1; page_id < 16; ++page_id) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+  page = bpm.FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 0 again"));
+  EXPECT_EQ(true, bpm.UnpinPage(0, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, WarmUpTest) {
+  page_id_t page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, BufferPoolManager(8, disk_manager).WarmUp("test.pageset"));
+
+  {
+    BufferPoolManager bpm(8, disk_manager, nullptr, 2);
+    for (int i = 0; i < 16; ++i) {
+      Page *page = bpm.NewPage(page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+    }
+    for (page_id = 0; page_id < 16; ++page_id) {
+      bpm.FlushPage(page_id);
+    }
+    // 2 and 3 become the hottest page of their instance
+    for (page_id = 2; page_id < 4; ++page_id) {
+      ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+    }
+    EXPECT_EQ(true, bpm.DumpPageSet("test.pageset"));
+  }
+
+  // a smaller pool only reads the hottest pages of every instance
+  {
+    BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+    EXPECT_EQ(4, bpm.WarmUp("test.pageset"));
+    for (page_id_t id : {2, 3, 14, 15}) {
+      Page *page = bpm.FetchPage(id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(0, strcmp(page->GetData(),
+                          ("page " + std::to_string(id)).c_str()));
+      EXPECT_EQ(true, bpm.UnpinPage(id, false));
+    }
+    EXPECT_EQ(0, bpm.GetStats().fetch_misses);
+
+    // stopping the dump thread dumps the page set one last time
+    bpm.RunPageSetDumpThread("test.pageset", std::chrono::hours(1));
+  }
+
+  {
+    BufferPoolManager bpm(8, disk_manager, nullptr, 2);
+    bpm.WarmUpInBackground("test.pageset");
+  }
+  BufferPoolManager bpm(8, disk_manager, nullptr, 2);
+  EXPECT_EQ(4, bpm.WarmUp("test.pageset"));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.pageset");
+}
+
+TEST(BufferPoolManagerTest, FetchPagesTest) {
+  page_id_t page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(8, disk_manager, nullptr, 2);
+  for (int i = 0; i < 16; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+  }
+
+  // resident pages, misses of both instances and a page asked for twice
+  std::vector<page_id_t> page_ids = {15, 2, 3, 4, 9, 5, 3};
+  std::vector<Page *> pages;
+  EXPECT_EQ(page_ids.size(), bpm.FetchPages(page_ids, pages));
+  ASSERT_EQ(page_ids.size(), pages.size());
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    ASSERT_NE(nullptr, pages[i]);
+    EXPECT_EQ(page_ids[i], pages[i]->GetPageId());
+    EXPECT_EQ(0, strcmp(pages[i]->GetData(),
+                        ("page " + std::to_string(page_ids[i])).c_str()));
+  }
+  EXPECT_EQ(pages[2], pages[6]);
+  EXPECT_EQ(2, pages[2]->GetPinCount());
+  EXPECT_EQ(2, bpm.GetStats().fetch_hits);
+  EXPECT_EQ(5, bpm.GetStats().fetch_misses);
+
+  // instances full of pinned pages leave the rest out
+  std::vector<Page *> more;
+  EXPECT_EQ(2, bpm.FetchPages({0, 1, 6, 7}, more));
+  EXPECT_EQ(nullptr, more[1]);
+  EXPECT_EQ(nullptr, more[3]);
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(pages[i], false));
+  }
+  for (auto *page : more) {
+    if (page != nullptr) {
+      EXPECT_EQ(true, bpm.UnpinPage(page, false));
+    }
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, DropTablespaceTest) {
+  page_id_t page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+  ExtentHint hint;
+  hint.tablespace_id = disk_manager->CreateTablespace("table");
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 8; ++i) {
+    Page *page = bpm.NewPage(page_id, nullptr, &hint);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  EXPECT_EQ(hint.tablespace_id, bpm.GetTablespaceId(page_ids[0]));
+
+  // a pinned page keeps the tablespace, the pages checked before it are not
+  // dropped either, dirty or not
+  Page *page = bpm.FetchPage(page_ids.back());
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(false, bpm.DropTablespace(hint.tablespace_id));
+  EXPECT_EQ(true, bpm.UnpinPage(page_ids.back(), false));
+  EXPECT_EQ(hint.tablespace_id, bpm.GetTablespaceId(page_ids[0]));
+  for (int i = 0; i < 8; ++i) {
+    page = bpm.FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm.UnpinPage(page_ids[i], false));
+  }
+  page = bpm.FetchPage(page_ids[0]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(false, bpm.DropTablespace(hint.tablespace_id));
+  EXPECT_EQ(true, bpm.UnpinPage(page_ids[0], false));
+  bpm.ReleaseExtent(&hint);
+  EXPECT_EQ(true, bpm.DropTablespace(hint.tablespace_id));
+  struct stat stat_buf;
+  EXPECT_NE(0, stat("table.0.tbs", &stat_buf));
+
+  // dirty pages of the tablespace are gone, not written to the db file
+  size_t num_pages;
+  EXPECT_EQ(true, bpm.FlushAllPages(&num_pages));
+  EXPECT_EQ(0, num_pages);
+  for (page_id_t dropped : page_ids) {
+    EXPECT_EQ(false, disk_manager->IsAllocated(dropped));
+  }
+  Page *reused = bpm.NewPage(page_id);
+  ASSERT_NE(nullptr, reused);
+  EXPECT_EQ(page_ids[0], page_id);
+  EXPECT_EQ(0, reused->GetData()[0]);
+  EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.tablespaces");
+}
+
+TEST(BufferPoolManagerTest, DiskManagerFirstTest) {
+  const int num_pages = 64;
+  page_id_t page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(num_pages, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  EXPECT_EQ(true, bpm->FlushAllPages());
+  delete bpm;
+
+  // the disk manager goes away with threads of the pool running and reads
+  // queued, they are stopped first
+  bpm = new BufferPoolManager(num_pages / 2, disk_manager);
+  bpm->RunCleanerThread(std::chrono::milliseconds(1));
+  for (int i = 0; i < num_pages; ++i) {
+    bpm->Prefetch(i);
+  }
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 } // namespace cmudb
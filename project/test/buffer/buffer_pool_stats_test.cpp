@@ -0,0 +1,63 @@
+/**
+ * buffer_pool_stats_test.cpp
+ */
+
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_stats.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(BufferPoolStatsTest, StripedCounterTest) {
+  StripedCounter counter;
+  EXPECT_EQ(0, counter.Load());
+
+  // more threads than stripes, some of them share one
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 20; ++tid) {
+    threads.push_back(std::thread([&counter]() {
+      for (int i = 0; i < 1000; ++i) {
+        ++counter;
+      }
+      counter += 5;
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(20 * 1005, counter.Load());
+}
+
+TEST(BufferPoolStatsTest, LatencyHistogramTest) {
+  LatencyHistogram histogram;
+  // 90 fast records in [512, 1024) ns, 10 slow ones in [2^20, 2^21) ns
+  for (int i = 0; i < 90; ++i) {
+    histogram.Record(std::chrono::nanoseconds(600));
+  }
+  for (int i = 0; i < 10; ++i) {
+    histogram.Record(std::chrono::nanoseconds(1500000));
+  }
+  histogram.Record(std::chrono::nanoseconds(0));
+
+  LatencyStats stats;
+  histogram.Snapshot(stats);
+  EXPECT_EQ(101, stats.count);
+  EXPECT_EQ(90 * 600 + 10 * 1500000, stats.sum_ns);
+  EXPECT_EQ(1, stats.buckets[0]);
+  EXPECT_EQ(90, stats.buckets[9]);
+  EXPECT_EQ(10, stats.buckets[20]);
+  EXPECT_EQ(1023, stats.PercentileNanos(50));
+  EXPECT_EQ((1 << 21) - 1, stats.PercentileNanos(99));
+
+  // snapshots of several instances add up
+  LatencyStats sum;
+  sum += stats;
+  sum += stats;
+  EXPECT_EQ(202, sum.count);
+  EXPECT_EQ(180, sum.buckets[9]);
+  EXPECT_DOUBLE_EQ(stats.MeanMicros(), sum.MeanMicros());
+}
+
+} // namespace cmudb
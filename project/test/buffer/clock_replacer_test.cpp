@@ -0,0 +1,122 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ClockReplacerTest, SampleTest) {
+  ClockReplacer<int> clock_replacer(7);
+
+  // push element into replacer
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(4);
+  clock_replacer.Insert(5);
+  clock_replacer.Insert(6);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(6, clock_replacer.Size());
+
+  // first sweep clears every reference bit, then evicts in clock order
+  int value;
+  clock_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+
+  // a referenced frame gets a second chance
+  clock_replacer.Insert(3);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+
+  // remove element from replacer
+  EXPECT_EQ(false, clock_replacer.Erase(4));
+  EXPECT_EQ(true, clock_replacer.Erase(6));
+  EXPECT_EQ(2, clock_replacer.Size());
+
+  // pop element from replacer after removal
+  clock_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, BasicTest) {
+  ClockReplacer<int> clock_replacer(100);
+
+  // push element into replacer
+  for (int i = 0; i < 100; ++i) {
+    clock_replacer.Insert(i);
+  }
+  EXPECT_EQ(100, clock_replacer.Size());
+
+  // insert again, no duplicate
+  for (int i = 0; i < 100; ++i) {
+    clock_replacer.Insert(99 - i);
+  }
+  EXPECT_EQ(100, clock_replacer.Size());
+
+  // erase the first 50 element
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(true, clock_replacer.Erase(i));
+  }
+  EXPECT_EQ(50, clock_replacer.Size());
+
+  // check left
+  int value = -1;
+  for (int i = 50; i < 100; ++i) {
+    EXPECT_EQ(true, clock_replacer.Victim(value));
+    EXPECT_EQ(i, value);
+    value = -1;
+  }
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+TEST(ClockReplacerTest, ConcurrentTest) {
+  const int num_threads = 8;
+  const int num_frames = 64;
+  ClockReplacer<int> clock_replacer(num_frames);
+
+  // every thread owns num_frames / num_threads frames
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&clock_replacer, tid]() {
+      for (int round = 0; round < 1000; ++round) {
+        for (int i = tid; i < num_frames; i += num_threads) {
+          clock_replacer.Insert(i);
+        }
+        for (int i = tid; i < num_frames; i += num_threads) {
+          clock_replacer.Erase(i);
+        }
+      }
+      for (int i = tid; i < num_frames; i += num_threads) {
+        clock_replacer.Insert(i);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_frames, clock_replacer.Size());
+
+  std::vector<bool> victims(num_frames, false);
+  int value;
+  while (clock_replacer.Victim(value)) {
+    EXPECT_EQ(false, victims[value]);
+    victims[value] = true;
+  }
+  for (int i = 0; i < num_frames; ++i) {
+    EXPECT_EQ(true, victims[i]);
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,138 @@
+/**
+ * compressed_cache_test.cpp
+ */
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/compressed_cache.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+namespace {
+
+// compress and decompress size bytes of data, return the compressed size
+size_t RoundTrip(const std::vector<char> &data) {
+  std::vector<char> compressed(data.size() + data.size() / 255 + 16);
+  size_t size = CompressedCache::Compress(data.data(), data.size(),
+                                          compressed.data(), compressed.size());
+  EXPECT_NE(0, size);
+  std::vector<char> result(data.size());
+  EXPECT_TRUE(CompressedCache::Decompress(compressed.data(), size,
+                                          result.data(), result.size()));
+  EXPECT_EQ(data, result);
+  return size;
+}
+
+} // namespace
+
+TEST(CompressedCacheTest, CodecTest) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  // empty free space of a page compresses to almost nothing
+  std::vector<char> page(PAGE_SIZE, 0);
+  EXPECT_GT(32, RoundTrip(page));
+
+  // a slotted page: a few records of a small alphabet, the rest zeros
+  std::uniform_int_distribution<int> letter('a', 'h');
+  for (int i = 0; i < PAGE_SIZE / 3; ++i) {
+    page[PAGE_SIZE - 1 - i] = static_cast<char>(letter(gen));
+  }
+  EXPECT_GT(PAGE_SIZE / 2, RoundTrip(page));
+
+  // repeated keys far apart, long matches and lengths over 255
+  std::vector<char> large(MAX_PAGE_SIZE);
+  for (size_t i = 0; i < large.size(); ++i) {
+    large[i] = static_cast<char>(i % 1000 < 16 ? byte(gen) : i % 7);
+  }
+  EXPECT_GT(large.size() / 4, RoundTrip(large));
+
+  // tiny inputs have no match at all
+  for (size_t size = 0; size < 10; ++size) {
+    RoundTrip(std::vector<char>(size, 'x'));
+  }
+
+  // random data does not fit in fewer bytes
+  for (auto &c : page) {
+    c = static_cast<char>(byte(gen));
+  }
+  std::vector<char> compressed(PAGE_SIZE);
+  EXPECT_EQ(0, CompressedCache::Compress(page.data(), PAGE_SIZE,
+                                         compressed.data(), PAGE_SIZE - 1));
+  RoundTrip(page);
+}
+
+// truncated or corrupted blocks are rejected, never read or written out of
+// bounds
+TEST(CompressedCacheTest, CorruptionTest) {
+  std::vector<char> page(PAGE_SIZE);
+  for (int i = 0; i < PAGE_SIZE; ++i) {
+    page[i] = static_cast<char>(i % 64 < 8 ? i : 0);
+  }
+  std::vector<char> compressed(PAGE_SIZE);
+  size_t size = CompressedCache::Compress(page.data(), PAGE_SIZE,
+                                          compressed.data(), PAGE_SIZE);
+  ASSERT_NE(0, size);
+
+  std::vector<char> result(PAGE_SIZE);
+  EXPECT_FALSE(CompressedCache::Decompress(compressed.data(), size - 1,
+                                           result.data(), PAGE_SIZE));
+  EXPECT_FALSE(CompressedCache::Decompress(compressed.data(), size,
+                                           result.data(), PAGE_SIZE - 1));
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<size_t> pos(0, size - 1);
+  for (int round = 0; round < 1000; ++round) {
+    std::vector<char> corrupted(compressed.begin(), compressed.begin() + size);
+    corrupted[pos(gen)] ^= static_cast<char>(1 << (round % 8));
+    CompressedCache::Decompress(corrupted.data(), size, result.data(),
+                                PAGE_SIZE);
+  }
+}
+
+TEST(CompressedCacheTest, CacheTest) {
+  std::vector<char> page(PAGE_SIZE, 0);
+  std::vector<char> result(PAGE_SIZE);
+  std::vector<char> compressed(PAGE_SIZE);
+  page[0] = 1;
+  size_t size = CompressedCache::Compress(page.data(), PAGE_SIZE,
+                                          compressed.data(), PAGE_SIZE);
+  // room for 3 such pages
+  CompressedCache cache(3 * size);
+
+  for (page_id_t page_id = 0; page_id < 4; ++page_id) {
+    page[0] = static_cast<char>(page_id + 1);
+    EXPECT_TRUE(cache.Insert(page_id, page.data(), PAGE_SIZE));
+  }
+  // the least recently stashed page made room
+  EXPECT_EQ(3, cache.GetNumPages());
+  EXPECT_EQ(3 * size, cache.GetSize());
+  EXPECT_FALSE(cache.Remove(0, result.data(), PAGE_SIZE));
+
+  // a page found leaves the cache
+  EXPECT_TRUE(cache.Remove(2, result.data(), PAGE_SIZE));
+  EXPECT_EQ(3, result[0]);
+  EXPECT_FALSE(cache.Remove(2, result.data(), PAGE_SIZE));
+  EXPECT_EQ(2, cache.GetNumPages());
+  EXPECT_EQ(2 * size, cache.GetSize());
+
+  cache.Erase(3);
+  EXPECT_FALSE(cache.Remove(3, result.data(), PAGE_SIZE));
+  EXPECT_TRUE(cache.Remove(1, result.data(), PAGE_SIZE));
+  EXPECT_EQ(2, result[0]);
+  EXPECT_EQ(0, cache.GetSize());
+
+  // incompressible pages are not kept
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> byte(0, 255);
+  for (auto &c : page) {
+    c = static_cast<char>(byte(gen));
+  }
+  EXPECT_FALSE(cache.Insert(5, page.data(), PAGE_SIZE));
+  EXPECT_EQ(0, cache.GetNumPages());
+}
+
+} // namespace cmudb
@@ -0,0 +1,121 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 0);
+
+  // access frame i for page i, frame 1 twice
+  for (int i = 1; i <= 6; ++i) {
+    lru_k_replacer.RecordAccess(i, i);
+  }
+  lru_k_replacer.RecordAccess(1, 1);
+
+  // unpin every frame
+  for (int i = 1; i <= 6; ++i) {
+    lru_k_replacer.Insert(i);
+  }
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // frames with less than k accesses go first, oldest first
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+
+  // pin frame 4, history is kept while pinned
+  EXPECT_EQ(true, lru_k_replacer.Erase(4));
+  EXPECT_EQ(false, lru_k_replacer.Erase(4));
+  lru_k_replacer.RecordAccess(4, 4);
+  lru_k_replacer.Insert(4);
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  // 5 and 6 have one access, then 1 (2nd last access older than 4's)
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(6, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+
+  // frame 4 now holds another page, history restarts
+  EXPECT_EQ(true, lru_k_replacer.Erase(4));
+  lru_k_replacer.RecordAccess(4, 40);
+  lru_k_replacer.RecordAccess(7, 7);
+  lru_k_replacer.RecordAccess(7, 7);
+  lru_k_replacer.Insert(7);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(7, value);
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, ScanTest) {
+  const int num_hot = 10;
+  const int num_scan = 100;
+  LRUKReplacer<int> lru_k_replacer(2, 0);
+
+  // hot frames are accessed over and over
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < num_hot; ++i) {
+      lru_k_replacer.RecordAccess(i, i);
+      lru_k_replacer.Insert(i);
+    }
+  }
+
+  // a sequential scan touches every page once, after the hot ones
+  for (int i = num_hot; i < num_hot + num_scan; ++i) {
+    lru_k_replacer.RecordAccess(i, i);
+    lru_k_replacer.Insert(i);
+  }
+  EXPECT_EQ(num_hot + num_scan, lru_k_replacer.Size());
+
+  // scan pages are evicted before any hot page
+  int value;
+  for (int i = num_hot; i < num_hot + num_scan; ++i) {
+    EXPECT_EQ(true, lru_k_replacer.Victim(value));
+    EXPECT_EQ(i, value);
+  }
+  for (int i = 0; i < num_hot; ++i) {
+    EXPECT_EQ(true, lru_k_replacer.Victim(value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+}
+
+TEST(LRUKReplacerTest, CorrelatedTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 4);
+
+  // frame 0 accessed twice far apart
+  lru_k_replacer.RecordAccess(0, 0);
+  for (int i = 1; i <= 4; ++i) {
+    lru_k_replacer.RecordAccess(i, i);
+  }
+  lru_k_replacer.RecordAccess(0, 0);
+
+  // frame 5 accessed in a burst, which counts as a single access
+  for (int i = 0; i < 10; ++i) {
+    lru_k_replacer.RecordAccess(5, 5);
+  }
+  lru_k_replacer.Insert(0);
+  lru_k_replacer.Insert(5);
+
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(0, value);
+}
+
+} // namespace cmudb
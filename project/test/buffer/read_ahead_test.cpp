@@ -0,0 +1,156 @@
+/**
+ * read_ahead_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "buffer/read_ahead.h"
+#include "logging/common.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ReadAheadTest, WindowTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(64, disk_manager);
+  bpm.SetReadAheadWindow(4);
+
+  ReadAhead read_ahead(&bpm);
+  EXPECT_EQ(1, read_ahead.GetWindow());
+
+  // sequential links, the window doubles up to 4
+  read_ahead.OnPage(0, 1);
+  EXPECT_EQ(1, read_ahead.GetWindow());
+  read_ahead.OnPage(1, 2);
+  EXPECT_EQ(2, read_ahead.GetWindow());
+  read_ahead.OnPage(1, 2);
+  EXPECT_EQ(2, read_ahead.GetWindow());
+  read_ahead.OnPage(2, 3);
+  EXPECT_EQ(4, read_ahead.GetWindow());
+  read_ahead.OnPage(3, 4);
+  EXPECT_EQ(4, read_ahead.GetWindow());
+
+  // a jump, only the next link
+  read_ahead.OnPage(10, 5);
+  EXPECT_EQ(1, read_ahead.GetWindow());
+  read_ahead.OnPage(5, 6);
+  EXPECT_EQ(1, read_ahead.GetWindow());
+  read_ahead.OnPage(6, 7);
+  EXPECT_EQ(2, read_ahead.GetWindow());
+
+  // disabled
+  bpm.SetReadAheadWindow(0);
+  read_ahead.OnPage(7, 8);
+  EXPECT_EQ(2, read_ahead.GetWindow());
+
+  // nothing was on disk, every request was dropped
+  EXPECT_EQ(0, bpm.GetPrefetchCount());
+  EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(ReadAheadTest, PrefetchTest) {
+  const int num_pages = 20;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(num_pages, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+    EXPECT_EQ(true, bpm->FlushPage(temp_page_id));
+  }
+  delete bpm;
+
+  // 4 instances, the prefetch thread serves all of them
+  bpm = new BufferPoolManager(num_pages, disk_manager, nullptr, 4);
+  for (int i = 0; i < num_pages / 2; ++i) {
+    bpm->Prefetch(i);
+  }
+  // beyond the end of file
+  bpm->Prefetch(num_pages);
+  for (int i = 0; i < 1000 && bpm->GetPrefetchCount() < num_pages / 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(num_pages / 2, bpm->GetPrefetchCount());
+
+  // prefetched pages are unpinned, fetching them is a hit
+  for (int i = 0; i < num_pages / 2; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(num_pages / 2, bpm->GetHitCount());
+  EXPECT_EQ(0, bpm->GetMissCount());
+  delete bpm;
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(ReadAheadTest, TablespaceScanTest) {
+  const int num_tuples = 2000; // ~25 table pages
+  Schema *schema = ParseCreateStatement(
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)");
+
+  // the table lives in a tablespace, its pages are beyond the end of the db
+  // file
+  DiskManager *disk_manager = new DiskManager("test.db");
+  tablespace_id_t tablespace_id = disk_manager->CreateTablespace("table");
+  BufferPoolManager *bpm = new BufferPoolManager(64, disk_manager);
+  Transaction txn(0);
+  RID rid;
+  page_id_t first_page_id;
+  {
+    TableHeap table(bpm, nullptr, nullptr, &txn, tablespace_id);
+    first_page_id = table.GetFirstPageId();
+    for (int i = 0; i < num_tuples; ++i) {
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(schema), rid, &txn));
+    }
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  EXPECT_EQ(tablespace_id, disk_manager->GetTablespaceId(first_page_id));
+  EXPECT_EQ(0, disk_manager->GetNumPages());
+
+  bpm = new BufferPoolManager(16, disk_manager);
+  bpm->SetReadAheadWindow(4);
+  TableHeap table(bpm, nullptr, nullptr, first_page_id);
+  // the first step of the scan prefetches the next page, wait for it, the
+  // scan would otherwise get there first
+  auto it = table.begin(&txn);
+  ++it;
+  for (int i = 0; i < 1000 && bpm->GetPrefetchCount() == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LT(0, bpm->GetPrefetchCount());
+  int count = 1;
+  for (; it != table.end(); ++it) {
+    ++count;
+  }
+  EXPECT_EQ(num_tuples, count);
+  delete bpm;
+
+  delete schema;
+  EXPECT_EQ(true, disk_manager->DropTablespace(tablespace_id));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.tablespaces");
+}
+
+} // namespace cmudb
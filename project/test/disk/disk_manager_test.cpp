@@ -0,0 +1,684 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, DirectIOTest) {
+  // unaligned buffers go through a bounce buffer
+  char data[PAGE_SIZE + 1], buffer[PAGE_SIZE + 1];
+  for (int i = 0; i < PAGE_SIZE; ++i) {
+    data[i + 1] = static_cast<char>(i);
+  }
+
+  DiskManager *disk_manager = new DiskManager("test.db", true);
+  EXPECT_EQ(true, disk_manager->IsDirectIO());
+  disk_manager->WritePage(0, data + 1);
+  disk_manager->WritePage(2, data + 1);
+  disk_manager->ReadPage(2, buffer + 1);
+  EXPECT_EQ(0, memcmp(data + 1, buffer + 1, PAGE_SIZE));
+  EXPECT_EQ(3, disk_manager->GetNumPages());
+
+  // hole and beyond the end of file read as zeros
+  char zeros[PAGE_SIZE] = {0};
+  disk_manager->ReadPage(1, buffer + 1);
+  EXPECT_EQ(0, memcmp(zeros, buffer + 1, PAGE_SIZE));
+  disk_manager->ReadPage(5, buffer + 1);
+  EXPECT_EQ(0, memcmp(zeros, buffer + 1, PAGE_SIZE));
+  delete disk_manager;
+
+  // buffered I/O sees the same file
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(false, disk_manager->IsDirectIO());
+  disk_manager->ReadPage(0, buffer);
+  EXPECT_EQ(0, memcmp(data + 1, buffer, PAGE_SIZE));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, DirectIOBufferPoolTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db", true);
+  BufferPoolManager bpm(10, disk_manager);
+
+  // frames of the arena are page aligned and written without bounce buffer
+  for (int i = 0; i < 30; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page->GetData()) % PAGE_SIZE);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  for (int i = 0; i < 30; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// the page size is chosen at creation and read back from the file header
+TEST(DiskManagerTest, PageSizeTest) {
+  const size_t page_size = 16 << 10;
+  page_id_t temp_page_id;
+
+  EXPECT_THROW(DiskManager("test.db", false, 3000), Exception);
+  EXPECT_THROW(DiskManager("test.db", false, 2 * MAX_PAGE_SIZE), Exception);
+  remove("test.db");
+  remove("test.log");
+
+  DiskManager *disk_manager = new DiskManager("test.db", true, page_size);
+  EXPECT_EQ(page_size, disk_manager->GetPageSize());
+  EXPECT_EQ(0, disk_manager->GetNumPages());
+  auto *bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(page_size, bpm->GetPageSize());
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    memset(page->GetData(), 'a' + i, page_size);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  delete bpm;
+  delete disk_manager;
+
+  // the page size asked for only applies to new files
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(page_size, disk_manager->GetPageSize());
+  EXPECT_EQ(4, disk_manager->GetNumPages());
+  bpm = new BufferPoolManager(4, disk_manager);
+  std::string expected(page_size, 'a' + 2);
+  auto page = bpm->FetchPage(2);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(expected, std::string(page->GetData(), page_size));
+  EXPECT_EQ(true, bpm->UnpinPage(2, false));
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+
+  // not a database file
+  std::ofstream file("test.db");
+  file << std::string(MIN_PAGE_SIZE, 'x');
+  file.close();
+  EXPECT_THROW(DiskManager("test.db"), Exception);
+  remove("test.db");
+  remove("test.log");
+}
+
+// version 0 files are only upgraded on request, other versions are refused
+TEST(DiskManagerTest, UpgradeTest) {
+  char buffer[PAGE_SIZE] = {0};
+
+  // version 0: no header, PAGE_SIZE pages from offset 0, a header page first
+  std::vector<char> pages(3 * PAGE_SIZE, 0);
+  snprintf(&pages[PAGE_SIZE], PAGE_SIZE, "page 1");
+  snprintf(&pages[2 * PAGE_SIZE], PAGE_SIZE, "page 2");
+  std::ofstream file("test.db", std::ios::binary);
+  file.write(pages.data(), pages.size());
+  file.close();
+  // left alone when opened
+  EXPECT_THROW(DiskManager("test.db"), Exception);
+  std::ifstream in("test.db", std::ios::binary | std::ios::ate);
+  EXPECT_EQ(3 * PAGE_SIZE, static_cast<size_t>(in.tellg()));
+  in.close();
+  DiskManager::UpgradeVersion0File("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(PAGE_SIZE, disk_manager->GetPageSize());
+  EXPECT_EQ(true, disk_manager->IsAllocated(2));
+  disk_manager->ReadPage(1, buffer);
+  EXPECT_EQ("page 1", std::string(buffer));
+  EXPECT_EQ(3, disk_manager->AllocatePage());
+  delete disk_manager;
+  // a current file is not upgraded again
+  EXPECT_THROW(DiskManager::UpgradeVersion0File("test.db"), Exception);
+  disk_manager = new DiskManager("test.db");
+  disk_manager->ReadPage(2, buffer);
+  EXPECT_EQ("page 2", std::string(buffer));
+  EXPECT_EQ(4, disk_manager->AllocatePage());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+
+  // version 1 and newer than this build
+  struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+  } header = {{'l', 'e', 'n', 'g', 'i', 'n', 'e', '\0'}, 1, PAGE_SIZE};
+  for (uint32_t version : {1, 3}) {
+    header.version = version;
+    file.open("test.db", std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file << std::string(2 * PAGE_SIZE - sizeof(header), '\0');
+    file.close();
+    EXPECT_THROW(DiskManager("test.db"), Exception);
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// threads reading and writing different pages share no file position, the
+// cached file size follows the writes
+TEST(DiskManagerTest, ConcurrentIOTest) {
+  const int num_threads = 8;
+  const int pages_per_thread = 64;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([=]() {
+      char data[PAGE_SIZE] = {0}, buffer[PAGE_SIZE];
+      for (int i = 0; i < pages_per_thread; ++i) {
+        page_id_t page_id = i * num_threads + tid;
+        snprintf(data, PAGE_SIZE, "page %d", page_id);
+        disk_manager->WritePage(page_id, data);
+        disk_manager->ReadPage(page_id, buffer);
+        EXPECT_EQ(0, memcmp(data, buffer, PAGE_SIZE));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * pages_per_thread, disk_manager->GetNumPages());
+  delete disk_manager;
+
+  // the size is read back from the file
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(num_threads * pages_per_thread, disk_manager->GetNumPages());
+  char buffer[PAGE_SIZE];
+  disk_manager->ReadPage(100, buffer);
+  EXPECT_EQ("page 100", std::string(buffer));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// many page I/Os in flight through either engine, completions in any order
+TEST(DiskManagerTest, AsyncIOTest) {
+  const int num_pages = 256;
+
+  for (auto type : {IOEngineType::URING, IOEngineType::THREAD_POOL}) {
+    DiskManager *disk_manager =
+        new DiskManager("test.db", true, PAGE_SIZE, type);
+    if (type == IOEngineType::THREAD_POOL) {
+      EXPECT_EQ("threads", std::string(disk_manager->GetIOEngineName()));
+    }
+    // unaligned buffers need bounce buffers with O_DIRECT
+    std::vector<char> data(num_pages * PAGE_SIZE + 1);
+    for (int i = 0; i < num_pages; ++i) {
+      snprintf(&data[i * PAGE_SIZE + 1], PAGE_SIZE, "page %d", i);
+    }
+    std::vector<std::future<bool>> writes;
+    for (int i = 0; i < num_pages; i += 4) {
+      writes.push_back(
+          disk_manager->WritePagesAsync(i, &data[i * PAGE_SIZE + 1], 4));
+    }
+    for (auto &write : writes) {
+      EXPECT_EQ(true, write.get());
+    }
+    EXPECT_EQ(num_pages, disk_manager->GetNumPages());
+
+    std::vector<char> buffer(num_pages * PAGE_SIZE + 1);
+    std::atomic<int> reads(0);
+    for (int i = num_pages - 1; i >= 0; --i) {
+      disk_manager->ReadPageAsync(i, &buffer[i * PAGE_SIZE + 1],
+                                  [&reads](bool ok) {
+                                    EXPECT_EQ(true, ok);
+                                    ++reads;
+                                  });
+    }
+    // beyond the end of file reads zeros
+    char page[PAGE_SIZE];
+    memset(page, 'x', PAGE_SIZE);
+    EXPECT_EQ(true, disk_manager->ReadPageAsync(num_pages + 10, page).get());
+    EXPECT_EQ(0, page[0]);
+    // waits for the reads in flight
+    delete disk_manager;
+    EXPECT_EQ(num_pages, reads);
+    EXPECT_EQ(data, buffer);
+
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// freed pages are reused first, the bitmap survives a restart
+TEST(DiskManagerTest, FreePageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  }
+  disk_manager->DeallocatePage(7);
+  disk_manager->DeallocatePage(3);
+  // not allocated, nothing to do
+  disk_manager->DeallocatePage(3);
+  disk_manager->DeallocatePage(20);
+  EXPECT_EQ(false, disk_manager->IsAllocated(3));
+  EXPECT_EQ(3, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(true, disk_manager->IsAllocated(3));
+  EXPECT_EQ(false, disk_manager->IsAllocated(7));
+  EXPECT_EQ(7, disk_manager->AllocatePage());
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+
+  // a write across a group goes around the bitmap block of the next group
+  const page_id_t last = PAGE_SIZE * 8 - 1;
+  std::vector<char> pages(2 * PAGE_SIZE);
+  snprintf(&pages[0], PAGE_SIZE, "page %d", last);
+  snprintf(&pages[PAGE_SIZE], PAGE_SIZE, "page %d", last + 1);
+  disk_manager->WritePages(last, pages.data(), 2);
+  EXPECT_EQ(true, disk_manager->WritePagesAsync(last, pages.data(), 2).get());
+  disk_manager->ReadPage(last + 1, data);
+  EXPECT_EQ("page " + std::to_string(last + 1), std::string(data));
+  EXPECT_EQ(last + 2, disk_manager->GetNumPages());
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(true, disk_manager->IsAllocated(10));
+  EXPECT_EQ(11, disk_manager->AllocatePage());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// allocations reach the bitmap block on disk with the next page write, in
+// one write for the group
+TEST(DiskManagerTest, DeferredBitmapTest) {
+  // the first byte of the bitmap block of group 0, 0 before it is written
+  auto bitmap_byte = []() {
+    std::ifstream file("test.db", std::ios::binary);
+    file.seekg(PAGE_SIZE);
+    char byte = 0;
+    file.read(&byte, 1);
+    return static_cast<unsigned char>(file ? byte : 0);
+  };
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  }
+  EXPECT_EQ(0, bitmap_byte());
+  char data[PAGE_SIZE] = {0};
+  disk_manager->WritePage(5, data);
+  EXPECT_EQ(0xff, bitmap_byte());
+
+  // frees are written by the sync
+  disk_manager->DeallocatePage(0);
+  disk_manager->DeallocatePage(1);
+  EXPECT_EQ(0xff, bitmap_byte());
+  disk_manager->SyncPages();
+  EXPECT_EQ(0xfc, bitmap_byte());
+
+  // and by the shutdown
+  disk_manager->DeallocatePage(2);
+  delete disk_manager;
+  EXPECT_EQ(0xf8, bitmap_byte());
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(false, disk_manager->IsAllocated(2));
+  EXPECT_EQ(true, disk_manager->IsAllocated(7));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a run of free pages gives its space back to the file system
+TEST(DiskManagerTest, PunchHoleTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<char> pages(2 * FREE_EXTENT_PAGES * PAGE_SIZE, 'x');
+  for (int i = 0; i < 2 * FREE_EXTENT_PAGES; ++i) {
+    disk_manager->AllocatePage();
+  }
+  disk_manager->WritePages(0, pages.data(), 2 * FREE_EXTENT_PAGES);
+  disk_manager->SyncPages();
+  struct stat before;
+  ASSERT_EQ(0, stat("test.db", &before));
+
+  for (int i = 0; i < FREE_EXTENT_PAGES; ++i) {
+    disk_manager->DeallocatePage(i);
+  }
+  struct stat after;
+  ASSERT_EQ(0, stat("test.db", &after));
+  EXPECT_EQ(before.st_size, after.st_size);
+  // file systems without hole punching keep the blocks
+  EXPECT_GE(before.st_blocks, after.st_blocks);
+  char data[PAGE_SIZE];
+  disk_manager->ReadPage(FREE_EXTENT_PAGES, data);
+  EXPECT_EQ('x', data[0]);
+  if (after.st_blocks < before.st_blocks) {
+    disk_manager->ReadPage(0, data);
+    EXPECT_EQ(0, data[0]);
+    // splitting a preallocated extent may take a block of file system
+    // metadata
+    EXPECT_LE((FREE_EXTENT_PAGES - 1) * PAGE_SIZE / 512,
+              before.st_blocks - after.st_blocks);
+  }
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// runs of pages in buffers scattered in memory, one request per run
+TEST(DiskManagerTest, VectoredIOTest) {
+  for (bool direct_io : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db", direct_io);
+    const int num_pages = 16;
+    // every other page of an aligned area, plus an unaligned buffer
+    char *area = static_cast<char *>(
+        aligned_alloc(PAGE_SIZE, (2 * num_pages + 1) * PAGE_SIZE));
+    std::vector<char *> buffers;
+    for (int i = 0; i < num_pages; ++i) {
+      buffers.push_back(area + 2 * i * PAGE_SIZE);
+      snprintf(buffers[i], PAGE_SIZE, "page %d", i);
+    }
+    disk_manager->WritePages(0, num_pages, buffers.data());
+
+    char data[PAGE_SIZE];
+    for (int i = 0; i < num_pages; ++i) {
+      disk_manager->ReadPage(i, data);
+      EXPECT_EQ("page " + std::to_string(i), std::string(data));
+    }
+    for (int i = 0; i < num_pages; ++i) {
+      memset(buffers[i], 0, PAGE_SIZE);
+    }
+    disk_manager->ReadPages(0, num_pages, buffers.data());
+    for (int i = 0; i < num_pages; ++i) {
+      EXPECT_EQ("page " + std::to_string(i), std::string(buffers[i]));
+    }
+
+    // scatter/gather, and pages beyond the end of file read as zeros
+    std::vector<page_id_t> page_ids = {1, 2, 3, 7, 9, 10, num_pages + 5};
+    buffers[3] = area + 2 * num_pages * PAGE_SIZE + 1;
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+      memset(buffers[i], 'x', PAGE_SIZE - 1);
+    }
+    disk_manager->ReadPages(page_ids, buffers.data());
+    for (size_t i = 0; i + 1 < page_ids.size(); ++i) {
+      EXPECT_EQ("page " + std::to_string(page_ids[i]),
+                std::string(buffers[i]));
+    }
+    EXPECT_EQ(0, buffers[page_ids.size() - 1][0]);
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+      snprintf(buffers[i], PAGE_SIZE, "again %d", page_ids[i]);
+    }
+    disk_manager->WritePages(page_ids, buffers.data());
+    for (page_id_t page_id : page_ids) {
+      disk_manager->ReadPage(page_id, data);
+      EXPECT_EQ("again " + std::to_string(page_id), std::string(data));
+    }
+    disk_manager->ReadPage(8, data);
+    EXPECT_EQ("page 8", std::string(data));
+
+    // a run across a group goes around the bitmap block of the next group
+    const page_id_t last = PAGE_SIZE * 8 - 1;
+    disk_manager->WritePages(last - 1, 3, buffers.data());
+    disk_manager->ReadPages(last - 1, 3, buffers.data() + 4);
+    for (int i = 0; i < 3; ++i) {
+      disk_manager->ReadPage(last - 1 + i, data);
+      EXPECT_EQ(std::string(buffers[i]), std::string(data));
+      EXPECT_EQ(std::string(buffers[i]), std::string(buffers[4 + i]));
+    }
+
+    free(area);
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// whatever the sync mode, pages and log read back after a restart
+TEST(DiskManagerTest, SyncModeTest) {
+  char data[PAGE_SIZE];
+  char log_buffers[2][PAGE_SIZE];
+  for (auto mode : {SyncMode::NONE, SyncMode::ALWAYS, SyncMode::PERIODIC,
+                    SyncMode::DSYNC}) {
+    DiskManager *disk_manager = new DiskManager(
+        "test.db", false, PAGE_SIZE, IOEngineType::URING, mode, mode);
+    for (int i = 0; i < 2; ++i) {
+      page_id_t page_id = disk_manager->AllocatePage();
+      snprintf(data, PAGE_SIZE, "page %d", page_id);
+      if (i == 0) {
+        disk_manager->WritePage(page_id, data);
+      } else {
+        EXPECT_EQ(true, disk_manager->WritePagesAsync(page_id, data, 1).get());
+      }
+      snprintf(log_buffers[i], PAGE_SIZE, "log %d", i);
+      disk_manager->WriteLog(log_buffers[i], PAGE_SIZE);
+    }
+    delete disk_manager;
+
+    // the log is preallocated at full size, zeros follow what was written
+    struct stat stat_buf;
+    ASSERT_EQ(0, stat("test.log", &stat_buf));
+    EXPECT_EQ(LOG_PREALLOC_SIZE, stat_buf.st_size);
+    EXPECT_LE(LOG_PREALLOC_SIZE / 512, stat_buf.st_blocks);
+
+    disk_manager = new DiskManager("test.db");
+    for (page_id_t page_id = 0; page_id < 2; ++page_id) {
+      disk_manager->ReadPage(page_id, data);
+      EXPECT_EQ("page " + std::to_string(page_id), std::string(data));
+    }
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_EQ(true, disk_manager->ReadLog(data, PAGE_SIZE, i * PAGE_SIZE));
+      EXPECT_EQ("log " + std::to_string(i), std::string(data));
+    }
+    EXPECT_EQ(true, disk_manager->ReadLog(data, PAGE_SIZE, 2 * PAGE_SIZE));
+    EXPECT_EQ(0, data[0]);
+    // appends go on after the last flush, not at the end of the file
+    snprintf(log_buffers[0], PAGE_SIZE, "log 2");
+    EXPECT_EQ(true, disk_manager->WriteLog(log_buffers[0], PAGE_SIZE));
+    EXPECT_EQ(true, disk_manager->ReadLog(data, PAGE_SIZE, 2 * PAGE_SIZE));
+    EXPECT_EQ("log 2", std::string(data));
+    ASSERT_EQ(0, stat("test.log", &stat_buf));
+    EXPECT_EQ(LOG_PREALLOC_SIZE, stat_buf.st_size);
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// objects growing side by side get pages of their own extents
+TEST(DiskManagerTest, ExtentTest) {
+  const page_id_t extent_pages = EXTENT_SIZE / PAGE_SIZE;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ExtentHint table, index;
+  for (page_id_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(i, disk_manager->AllocatePage(&table));
+    EXPECT_EQ(extent_pages + i, disk_manager->AllocatePage(&index));
+  }
+  // first fit skips reserved pages
+  EXPECT_EQ(2 * extent_pages, disk_manager->AllocatePage());
+
+  // the file is preallocated ahead of the pages, its size does not move
+  disk_manager->SyncPages();
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_EQ(2 * PAGE_SIZE, stat_buf.st_size);
+
+  // a used up extent is followed by the next free one
+  for (page_id_t i = 3; i < extent_pages; ++i) {
+    EXPECT_EQ(i, disk_manager->AllocatePage(&table));
+  }
+  EXPECT_EQ(3 * extent_pages, disk_manager->AllocatePage(&table));
+
+  disk_manager->ReleaseExtent(&index);
+  EXPECT_EQ(extent_pages + 3, disk_manager->AllocatePage());
+  EXPECT_EQ(4 * extent_pages, disk_manager->AllocatePage(&index));
+  delete disk_manager;
+
+  // reservations are gone after a restart
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(true, disk_manager->IsAllocated(3 * extent_pages));
+  EXPECT_EQ(3 * extent_pages + 1, disk_manager->AllocatePage(&table));
+  EXPECT_EQ(extent_pages + 4, disk_manager->AllocatePage());
+
+  // a hint going away with its object gives the rest of its extent back
+  {
+    ExtentHint heap;
+    EXPECT_EQ(5 * extent_pages, disk_manager->AllocatePage(&heap));
+    disk_manager->DeallocatePage(5 * extent_pages);
+  }
+  ExtentHint reopened;
+  EXPECT_EQ(5 * extent_pages, disk_manager->AllocatePage(&reopened));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, TablespaceTest) {
+  const page_id_t extent_pages = EXTENT_SIZE / PAGE_SIZE;
+  mkdir("ts_a", 0755);
+  mkdir("ts_b", 0755);
+  struct stat stat_buf;
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  memset(data, 0, sizeof(data));
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  tablespace_id_t orders =
+      disk_manager->CreateTablespace("orders", {"ts_a", "ts_b"});
+  tablespace_id_t items = disk_manager->CreateTablespace("items");
+  EXPECT_NE(DB_TABLESPACE_ID, orders);
+  EXPECT_NE(orders, items);
+  EXPECT_EQ(0, stat("ts_a/orders.0.tbs", &stat_buf));
+  EXPECT_EQ(0, stat("ts_b/orders.1.tbs", &stat_buf));
+  EXPECT_EQ(0, stat("items.0.tbs", &stat_buf));
+  EXPECT_THROW(disk_manager->CreateTablespace("items"), Exception);
+
+  // three extents striped over two files, first fit skips all of them
+  ExtentHint hint;
+  hint.tablespace_id = orders;
+  std::vector<page_id_t> page_ids;
+  for (page_id_t i = 0; i < 2 * extent_pages + 1; ++i) {
+    page_ids.push_back(disk_manager->AllocatePage(&hint));
+  }
+  EXPECT_EQ(0, page_ids[0]);
+  EXPECT_EQ(2 * extent_pages, page_ids.back());
+  page_id_t db_page_id = disk_manager->AllocatePage();
+  EXPECT_EQ(3 * extent_pages, db_page_id);
+  EXPECT_EQ(orders, disk_manager->GetTablespaceId(extent_pages));
+  EXPECT_EQ(DB_TABLESPACE_ID, disk_manager->GetTablespaceId(db_page_id));
+
+  for (page_id_t page_id : page_ids) {
+    memcpy(data, &page_id, sizeof(page_id));
+    disk_manager->WritePage(page_id, data);
+  }
+  strcpy(data, "db file");
+  disk_manager->WritePage(db_page_id, data);
+  // the pages live in the tablespace files, not in the db file
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_GT(2 * EXTENT_SIZE, stat_buf.st_blocks * 512);
+  // the header extent, then extents 0 and 2 in the first file, 1 in the other
+  ASSERT_EQ(0, stat("ts_a/orders.0.tbs", &stat_buf));
+  EXPECT_EQ(2 * EXTENT_SIZE + PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat("ts_b/orders.1.tbs", &stat_buf));
+  EXPECT_EQ(2 * EXTENT_SIZE, stat_buf.st_size);
+
+  // a run crossing extents is split between the files
+  std::vector<char> pages(4 * PAGE_SIZE);
+  std::vector<char *> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.push_back(&pages[i * PAGE_SIZE]);
+  }
+  disk_manager->ReadPages(extent_pages - 2, 4, buffers.data());
+  for (page_id_t i = 0; i < 4; ++i) {
+    page_id_t page_id;
+    memcpy(&page_id, buffers[i], sizeof(page_id));
+    EXPECT_EQ(extent_pages - 2 + i, page_id);
+  }
+  disk_manager->DeallocatePage(1);
+  delete disk_manager;
+
+  // the catalog and the extent maps are read back
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(orders, disk_manager->GetTablespaceId(2 * extent_pages));
+  for (page_id_t page_id : {page_id_t(0), extent_pages, 2 * extent_pages}) {
+    disk_manager->ReadPage(page_id, buffer);
+    EXPECT_EQ(0, memcmp(buffer, &page_id, sizeof(page_id)));
+  }
+  disk_manager->ReadPage(db_page_id, buffer);
+  EXPECT_EQ(0, strcmp(buffer, "db file"));
+  EXPECT_EQ(db_page_id + 1, disk_manager->AllocatePage());
+  // a freed page is reused within the tablespace
+  ExtentHint reopened;
+  reopened.tablespace_id = orders;
+  EXPECT_EQ(1, disk_manager->AllocatePage(&reopened));
+  EXPECT_EQ(2 * extent_pages + 1, disk_manager->AllocatePage(&reopened));
+
+  // dropping unlinks the files and frees the pages
+  EXPECT_EQ(2 * extent_pages + 2,
+            disk_manager->GetTablespacePages(orders).size());
+  EXPECT_EQ(true, disk_manager->DropTablespace(orders));
+  EXPECT_EQ(false, disk_manager->DropTablespace(orders));
+  EXPECT_NE(0, stat("ts_a/orders.0.tbs", &stat_buf));
+  EXPECT_NE(0, stat("ts_b/orders.1.tbs", &stat_buf));
+  EXPECT_EQ(false, disk_manager->IsAllocated(extent_pages));
+  EXPECT_EQ(DB_TABLESPACE_ID, disk_manager->GetTablespaceId(0));
+  EXPECT_EQ(0, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(DB_TABLESPACE_ID, disk_manager->GetTablespaceId(extent_pages));
+  EXPECT_EQ(true, disk_manager->DropTablespace(items));
+  EXPECT_NE(0, stat("items.0.tbs", &stat_buf));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.tablespaces");
+  rmdir("ts_a");
+  rmdir("ts_b");
+}
+
+// writes to a full device are reported, by the disk manager and by flushes
+TEST(DiskManagerTest, FailedWriteTest) {
+  char data[PAGE_SIZE];
+  memset(data, 0, sizeof(data));
+  remove("full.db");
+  ASSERT_EQ(0, symlink("/dev/full", "full.db"));
+  for (auto mode : {SyncMode::NONE, SyncMode::ALWAYS}) {
+    DiskManager *disk_manager = new DiskManager(
+        "full.db", false, PAGE_SIZE, IOEngineType::URING, mode, mode);
+    page_id_t page_id = disk_manager->AllocatePage();
+    EXPECT_EQ(false, disk_manager->WritePage(page_id, data));
+    EXPECT_EQ(false, disk_manager->WritePages(page_id, data, 1));
+    EXPECT_EQ(false, disk_manager->WritePagesAsync(page_id, data, 1).get());
+
+    BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+    Page *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    bpm->UnpinPage(page_id, true);
+    EXPECT_EQ(false, bpm->FlushPage(page_id));
+    EXPECT_EQ(false, bpm->FlushAllPages());
+    delete bpm;
+    delete disk_manager;
+  }
+  remove("full.db");
+  remove("full.log");
+}
+
+} // namespace cmudb
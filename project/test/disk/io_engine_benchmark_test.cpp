@@ -0,0 +1,152 @@
+/**
+ * io_engine_benchmark_test.cpp
+ *
+ * fio style microbenchmark of the I/O engines: random 4KB reads and writes
+ * with O_DIRECT on a preallocated file, one submitting thread keeping a given
+ * number of I/Os in flight, io_uring vs. the thread pool. Reports IOPS,
+ * bandwidth and mean completion latency per queue depth.
+ *
+ * Disabled so it stays out of `make check`, run it with
+ * ./io_engine_benchmark_test --gtest_also_run_disabled_tests
+ * The Smoke variant runs in `make check` on a small file, to keep the paths
+ * working, its numbers mean nothing.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "disk/io_engine.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+namespace {
+
+const size_t BLOCK_SIZE = 4096;
+
+struct JobResult {
+  double iops;
+  double mbps;
+  double mean_latency_us;
+};
+
+// num_ios random block I/Os with iodepth in flight, like
+// fio --rw=randread|randwrite --bs=4k --direct=1 --iodepth=iodepth
+JobResult RunJob(IOEngine *engine, int fd, size_t file_size, bool write,
+                 size_t iodepth, size_t num_ios) {
+  // one aligned buffer per slot in flight
+  char *buffers = static_cast<char *>(
+      aligned_alloc(BLOCK_SIZE, iodepth * BLOCK_SIZE));
+  memset(buffers, 'x', iodepth * BLOCK_SIZE);
+  std::vector<size_t> free_slots;
+  for (size_t i = 0; i < iodepth; ++i) {
+    free_slots.push_back(i);
+  }
+  std::mutex latch;
+  std::condition_variable cv;
+  size_t completed = 0;
+  double latency_sum_us = 0;
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<size_t> block(0, file_size / BLOCK_SIZE - 1);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_ios; ++i) {
+    size_t slot;
+    {
+      std::unique_lock<std::mutex> lock(latch);
+      cv.wait(lock, [&]() { return !free_slots.empty(); });
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    auto submitted = std::chrono::steady_clock::now();
+    engine->Submit(IORequest{
+        write, fd, buffers + slot * BLOCK_SIZE, BLOCK_SIZE,
+        static_cast<off_t>(block(gen) * BLOCK_SIZE),
+        [&, slot, submitted](ssize_t result) {
+          EXPECT_EQ(static_cast<ssize_t>(BLOCK_SIZE), result);
+          std::chrono::duration<double, std::micro> latency =
+              std::chrono::steady_clock::now() - submitted;
+          std::lock_guard<std::mutex> lock(latch);
+          latency_sum_us += latency.count();
+          ++completed;
+          free_slots.push_back(slot);
+          cv.notify_all();
+        }});
+  }
+  {
+    std::unique_lock<std::mutex> lock(latch);
+    cv.wait(lock, [&]() { return completed == num_ios; });
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  free(buffers);
+
+  JobResult result;
+  result.iops = num_ios / elapsed.count();
+  result.mbps = result.iops * BLOCK_SIZE / (1 << 20);
+  result.mean_latency_us = latency_sum_us / num_ios;
+  return result;
+}
+
+// every engine, read and write, at growing queue depths
+void RunRandomIO(size_t file_size, size_t num_ios) {
+  // lay the file out, so reads hit blocks allocated on the device
+  int fd = open("test.db", O_RDWR | O_CREAT | O_TRUNC, 0644);
+  ASSERT_NE(-1, fd);
+  std::vector<char> chunk(1 << 20, 'a');
+  for (size_t offset = 0; offset < file_size; offset += chunk.size()) {
+    ASSERT_EQ(static_cast<ssize_t>(chunk.size()),
+              pwrite(fd, chunk.data(), chunk.size(), offset));
+  }
+  fdatasync(fd);
+  close(fd);
+  fd = open("test.db", O_RDWR | O_DIRECT);
+  if (fd == -1) {
+    // tmpfs and friends, the page cache is measured instead
+    fd = open("test.db", O_RDWR);
+  }
+  ASSERT_NE(-1, fd);
+
+  std::cout << std::setw(10) << "engine" << std::setw(8) << "rw"
+            << std::setw(8) << "iodepth" << std::setw(12) << "IOPS"
+            << std::setw(10) << "MB/s" << std::setw(12) << "lat us"
+            << std::endl;
+  for (auto type : {IOEngineType::URING, IOEngineType::THREAD_POOL}) {
+    for (bool write : {false, true}) {
+      for (size_t iodepth : {1, 4, 16, 64}) {
+        IOEngine *engine = IOEngine::Create(type, iodepth);
+        JobResult result =
+            RunJob(engine, fd, file_size, write, iodepth, num_ios);
+        std::cout << std::setw(10) << engine->GetName() << std::setw(8)
+                  << (write ? "write" : "read") << std::setw(8) << iodepth
+                  << std::setw(12) << std::fixed << std::setprecision(0)
+                  << result.iops << std::setw(10) << std::setprecision(1)
+                  << result.mbps << std::setw(12) << result.mean_latency_us
+                  << std::endl;
+        delete engine;
+      }
+    }
+  }
+
+  close(fd);
+  remove("test.db");
+}
+
+} // namespace
+
+TEST(IOEngineBenchmark, DISABLED_RandomIO) { RunRandomIO(64 << 20, 20000); }
+
+TEST(IOEngineBenchmark, RandomIOSmoke) { RunRandomIO(4 << 20, 256); }
+
+} // namespace cmudb
@@ -0,0 +1,145 @@
+/**
+ * concurrent_hash_test.cpp
+ */
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "hash/concurrent_hash.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ConcurrentHashTest, SampleTest) {
+  ConcurrentHash<int, int> test(4);
+
+  for (int i = 0; i < 9; ++i) {
+    test.Insert(i, i * 10);
+  }
+  EXPECT_EQ(9, test.Size());
+
+  // find test
+  int result = 0;
+  EXPECT_TRUE(test.Find(8, result));
+  EXPECT_EQ(80, result);
+  EXPECT_TRUE(test.Find(0, result));
+  EXPECT_EQ(0, result);
+  EXPECT_FALSE(test.Find(10, result));
+
+  // insert overwrites the value of a present key
+  test.Insert(2, 200);
+  EXPECT_TRUE(test.Find(2, result));
+  EXPECT_EQ(200, result);
+  EXPECT_EQ(9, test.Size());
+
+  // delete test
+  EXPECT_TRUE(test.Remove(8));
+  EXPECT_TRUE(test.Remove(4));
+  EXPECT_FALSE(test.Remove(4));
+  EXPECT_FALSE(test.Remove(20));
+  EXPECT_FALSE(test.Find(8, result));
+  EXPECT_EQ(7, test.Size());
+}
+
+// the table grows past its initial capacity and keeps at least twice as
+// many slots as entries
+TEST(ConcurrentHashTest, GrowTest) {
+  ConcurrentHash<int, int> test(8);
+  EXPECT_EQ(16, test.GetNumSlots());
+
+  for (int i = 0; i < 1000; ++i) {
+    test.Insert(i, -i);
+  }
+  EXPECT_EQ(1000, test.Size());
+  EXPECT_LE(2000, test.GetNumSlots());
+  for (int i = 0; i < 1000; ++i) {
+    int result;
+    EXPECT_TRUE(test.Find(i, result));
+    EXPECT_EQ(-i, result);
+  }
+}
+
+// all keys hash to few groups: removing from full groups must shift later
+// entries back, every remaining key is still found
+TEST(ConcurrentHashTest, ShiftBackTest) {
+  const int num_keys = 512;
+  ConcurrentHash<int, int> test(num_keys);
+  std::mt19937 gen(0);
+
+  std::vector<bool> present(num_keys * 4, false);
+  std::uniform_int_distribution<int> dist(0, num_keys * 4 - 1);
+  for (int round = 0; round < 20000; ++round) {
+    int key = dist(gen);
+    if (present[key]) {
+      EXPECT_TRUE(test.Remove(key));
+    } else if (test.Size() < num_keys) {
+      test.Insert(key, key + 1);
+    } else {
+      continue;
+    }
+    present[key] = !present[key];
+  }
+
+  size_t size = 0;
+  for (int key = 0; key < num_keys * 4; ++key) {
+    int result;
+    EXPECT_EQ(present[key], test.Find(key, result)) << key;
+    if (present[key]) {
+      EXPECT_EQ(key + 1, result);
+      ++size;
+    }
+  }
+  EXPECT_EQ(size, test.Size());
+}
+
+// lock-free readers next to a writer churning other keys: keys that stay in
+// the table are always found with a consistent value
+TEST(ConcurrentHashTest, ConcurrentReadTest) {
+  const int num_stable = 200;
+  const int num_churn = 2000;
+  ConcurrentHash<int, int> test(64);
+  for (int i = 0; i < num_stable; ++i) {
+    test.Insert(i, i * 3);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> errors(0);
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 3; ++tid) {
+    readers.push_back(std::thread([&, tid]() {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<int> dist(0, num_stable - 1);
+      while (!done) {
+        int key = dist(gen);
+        int result;
+        if (!test.Find(key, result) || result != key * 3) {
+          ++errors;
+        }
+        // churned keys are either missing or carry their own value
+        key = num_stable + dist(gen);
+        if (test.Find(key, result) && result != key * 3) {
+          ++errors;
+        }
+      }
+    }));
+  }
+
+  for (int round = 0; round < 5; ++round) {
+    for (int i = num_stable; i < num_stable + num_churn; ++i) {
+      test.Insert(i, i * 3);
+    }
+    for (int i = num_stable; i < num_stable + num_churn; ++i) {
+      EXPECT_TRUE(test.Remove(i));
+    }
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, errors);
+  EXPECT_EQ(num_stable, test.Size());
+}
+
+} // namespace cmudb
@@ -1,6 +1,7 @@
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <unistd.h>
 
 #include "logging/common.h"
 #include "logging/log_recovery.h"
@@ -124,4 +125,86 @@ TEST(LogManagerTest, RedoTestWithOneTxn) {
   remove("test.log");
 }
 
+// the log buffers follow the page size of the db file, an existing file keeps
+// its own, and can not be smaller than the largest log record
+TEST(LogManagerTest, LogBufferSizeTest) {
+  StorageEngineOptions options;
+  options.page_size = MAX_PAGE_SIZE;
+  StorageEngine *storage_engine = new StorageEngine("test.db", options);
+  EXPECT_EQ(LogManager::DefaultLogBufferSize(MAX_PAGE_SIZE),
+            storage_engine->log_manager_->GetLogBufferSize());
+  delete storage_engine;
+
+  storage_engine = new StorageEngine("test.db");
+  EXPECT_EQ(LogManager::DefaultLogBufferSize(MAX_PAGE_SIZE),
+            storage_engine->log_manager_->GetLogBufferSize());
+  delete storage_engine;
+
+  options.log_buffer_size = LOG_BUFFER_SIZE;
+  EXPECT_THROW(StorageEngine("test.db", options), Exception);
+  options.log_buffer_size = LogManager::MinLogBufferSize(MAX_PAGE_SIZE);
+  storage_engine = new StorageEngine("test.db", options);
+  EXPECT_EQ(options.log_buffer_size,
+            storage_engine->log_manager_->GetLogBufferSize());
+  delete storage_engine;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// a failed log write does not make any record persistent, the commits
+// waiting for it fail instead of being taken as durable
+TEST(LogManagerTest, FailedLogWriteTest) {
+  remove("full.log");
+  ASSERT_EQ(0, symlink("/dev/full", "full.log"));
+  StorageEngine *storage_engine = new StorageEngine("full.db");
+  storage_engine->log_manager_->RunFlushThread();
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  Schema *schema =
+      ParseCreateStatement("a varchar, b smallint, c bigint, d bool");
+  RID rid;
+  Tuple tuple = ConstructTuple(schema);
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  EXPECT_FALSE(storage_engine->transaction_manager_->Commit(txn));
+  EXPECT_TRUE(storage_engine->log_manager_->HasFailed());
+  EXPECT_EQ(INVALID_LSN, storage_engine->log_manager_->GetPersistentLSN());
+
+  // the table page newer than the log is neither written back nor dropped by
+  // an eviction, the pool fails to pin instead
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+  page_id_t page_id;
+  Page *page = nullptr;
+  for (int i = 0; i <= BUFFER_POOL_SIZE; ++i) {
+    if ((page = bpm->NewPage(page_id)) == nullptr) {
+      break;
+    }
+    bpm->UnpinPage(page_id, false);
+  }
+  EXPECT_EQ(nullptr, page);
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(0, stats.dirty_evictions);
+  EXPECT_NE(nullptr, bpm->FetchPage(rid.GetPageId()));
+  EXPECT_EQ(stats.fetch_misses, bpm->GetStats().fetch_misses);
+  bpm->UnpinPage(rid.GetPageId(), false);
+
+  // pages newer than the log are not written back either, they stay dirty
+  for (int i = 0; i < 2; ++i) {
+    size_t written;
+    EXPECT_FALSE(storage_engine->buffer_pool_manager_->FlushAllPages(&written));
+    EXPECT_EQ(0, written);
+  }
+
+  storage_engine->log_manager_->StopFlushThread();
+  delete txn;
+  delete test_table;
+  delete schema;
+  delete storage_engine;
+  remove("full.db");
+  remove("full.log");
+}
+
 } // namespace cmudb